@@ -0,0 +1,342 @@
+#include "../src/chip8.h"
+#include "../src/headless.h"
+#include "../src/scheduler.h"
+#include "../src/text.h"
+#include <dirent.h>
+
+// Commit the benchmark was built from, passed in by the makefile
+#ifndef BENCH_COMMIT
+#define BENCH_COMMIT "unknown"
+#endif
+
+// Defaults, overridden on the command line
+#define DEFAULT_REPEATS 5
+#define DEFAULT_MICRO_CYCLES 10000000ull
+#define DEFAULT_MACRO_CYCLES 10000000ull
+// Instructions executed per cycle_cpu call in a microbenchmark
+#define MICRO_CHUNK 1000000
+// Copies of the instruction under test in a kernel's loop body
+#define KERNEL_COPIES 32
+
+/*
+ * A microbenchmark kernel: setup instructions, then a loop of an optional
+ * head instruction and KERNEL_COPIES copies of the body closed by a jump
+ * back, so all but a few percent of the instructions executed are the ones
+ * under test.
+ */
+typedef struct {
+  const char *name;
+  uint16_t setup[3];
+  int setup_length;
+  uint16_t head; // 0 -> none
+  uint16_t body[2];
+  int body_length;
+} Kernel;
+
+static const Kernel KERNELS[] = {
+    // 8XY4, 8XY5, 8XY1, 8XY2, 8XY3, 8XY6, 8XYE and 7XKK, two at a time
+    {"alu_add_sub", {0x6011, 0x6122}, 2, 0, {0x8014, 0x8125}, 2},
+    {"alu_logic", {0x6011, 0x6122}, 2, 0, {0x8011, 0x8122}, 2},
+    {"alu_xor_shift", {0x6011, 0x6122}, 2, 0, {0x8013, 0x8126}, 2},
+    {"alu_imm_shl", {0x6011, 0x6122}, 2, 0, {0x7003, 0x811E}, 2},
+    // SE V0, 00 skips the instruction after it, which never runs
+    {"skip_taken", {0x6000}, 1, 0, {0x3000, 0x0000}, 2},
+    {"skip_not_taken", {0x6000}, 1, 0, {0x3001}, 1},
+    // The first font glyph, redrawn in place
+    {"dxyn_1", {0x6008, 0x6104, 0xA000}, 3, 0, {0xD011}, 1},
+    {"dxyn_5", {0x6008, 0x6104, 0xA000}, 3, 0, {0xD015}, 1},
+    {"dxyn_15", {0x6008, 0x6104, 0xA000}, 3, 0, {0xD01F}, 1},
+    // Straddling the right edge, so each row wraps around or is clipped
+    // as the profile's clip quirk says (default wraps, vip and schip clip)
+    {"dxyn_8_edge", {0x603C, 0x6104, 0xA000}, 3, 0, {0xD018}, 1},
+    // FX55 and FX65 advance I by 16, so it is reset once per loop
+    {"fx55", {0}, 0, 0xA800, {0xFF55}, 1},
+    {"fx65", {0}, 0, 0xA800, {0xFF65}, 1},
+};
+
+typedef struct {
+  int repeats;
+  uint64_t micro_cycles;
+  uint64_t macro_cycles;
+  const char *roms;
+  const char *filter; // Only benchmarks whose name contains it, NULL -> all
+  CpuMode mode;
+  const char *mode_name;
+  QuirkProfile quirks;
+  FILE *out;
+} BenchOptions;
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-o results.jsonl] [--repeats N] [--micro-cycles N] "
+          "[--macro-cycles N] [--roms DIR] [--filter TEXT] "
+          "[--cpu interpreter|cached|jit] "
+          "[--quirks default|vip|chip48|schip|xochip]\n",
+          prog);
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double da = *(const double *)a, db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+/**
+ * @brief Writes the result of a benchmark as one JSON line, and a summary
+ * to stderr.
+ *
+ * @param options The options of the run.
+ * @param suite "micro" or "macro".
+ * @param name The name of the benchmark.
+ * @param instructions The instructions executed per run.
+ * @param frames The emulated frames per run, 0 for microbenchmarks.
+ * @param seconds The time of each run, sorted in place.
+ */
+static void report(const BenchOptions *options, const char *suite,
+                   const char *name, uint64_t instructions, uint64_t frames,
+                   double *seconds) {
+  int repeats = options->repeats;
+  qsort(seconds, repeats, sizeof(double), compare_doubles);
+  double median = seconds[repeats / 2];
+  double ns = median * 1e9 / instructions;
+
+  fprintf(options->out, "{\"commit\":\"%s\",\"suite\":\"%s\",\"name\":",
+          BENCH_COMMIT, suite);
+  write_json_string(options->out, name);
+  fprintf(options->out,
+          ",\"cpu\":\"%s\",\"quirks\":\"%s\",\"instructions\":%llu,"
+          "\"repeats\":%d,\"seconds_median\":%.6f,\"seconds_min\":%.6f,"
+          "\"seconds_max\":%.6f,\"ns_per_instruction\":%.3f,\"mips\":%.2f",
+          options->mode_name, quirk_profiles[options->quirks].name,
+          (unsigned long long)instructions, repeats, median, seconds[0],
+          seconds[repeats - 1], ns, instructions / median / 1e6);
+  if (frames > 0)
+    fprintf(options->out, ",\"frames\":%llu,\"frames_per_second\":%.0f",
+            (unsigned long long)frames, frames / median);
+  fprintf(options->out, "}\n");
+  fflush(options->out);
+
+  fprintf(stderr, "%-6s %-44s %8.2f MIPS %8.3f ns/instr", suite, name,
+          instructions / median / 1e6, ns);
+  if (frames > 0)
+    fprintf(stderr, " %10.0f frames/s", frames / median);
+  fprintf(stderr, "\n");
+}
+
+/**
+ * @brief Writes a kernel into a Chip8 instance as its program.
+ *
+ * @param c8 The Chip8 instance.
+ * @param kernel The kernel.
+ */
+static void load_kernel(Chip8 *c8, const Kernel *kernel) {
+  uint8_t program[2 * (3 + 1 + 2 * KERNEL_COPIES + 1)];
+  int length = 0;
+
+#define EMIT(op)                                                               \
+  do {                                                                         \
+    program[length++] = (op) >> 8;                                             \
+    program[length++] = (op) & 0xFF;                                           \
+  } while (0)
+
+  for (int i = 0; i < kernel->setup_length; i++)
+    EMIT(kernel->setup[i]);
+  uint16_t loop = PROGRAM_MEM + length;
+  if (kernel->head != 0)
+    EMIT(kernel->head);
+  for (int copy = 0; copy < KERNEL_COPIES; copy++)
+    for (int i = 0; i < kernel->body_length; i++)
+      EMIT(kernel->body[i]);
+  EMIT(0x1000 | loop);
+#undef EMIT
+
+  load_rom_data(c8, program, length);
+}
+
+/**
+ * @brief Times a kernel, after a warmup run.
+ *
+ * @param options The options of the run.
+ * @param kernel The kernel.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int bench_kernel(const BenchOptions *options, const Kernel *kernel) {
+  double seconds[options->repeats];
+  Chip8 *c8 = initialize();
+  if (c8 == NULL || set_cpu_mode(c8, options->mode) != SUCCESS ||
+      set_quirks(c8, options->quirks) != SUCCESS) {
+    destroy(c8);
+    return ERR;
+  }
+
+  for (int run = -1; run < options->repeats; run++) {
+    reset(c8);
+    load_kernel(c8, kernel);
+
+    double start = scheduler_clock();
+    for (uint64_t done = 0; done < options->micro_cycles;
+         done += MICRO_CHUNK)
+      cycle_cpu(c8, MICRO_CHUNK);
+    if (run >= 0)
+      seconds[run] = scheduler_clock() - start;
+  }
+
+  // Cycles are counted in whole chunks
+  uint64_t instructions =
+      (options->micro_cycles + MICRO_CHUNK - 1) / MICRO_CHUNK * MICRO_CHUNK;
+  report(options, "micro", kernel->name, instructions, 0, seconds);
+  destroy(c8);
+  return SUCCESS;
+}
+
+/**
+ * @brief Times a ROM run headless at the default instruction rate, after a
+ * warmup run. Every run starts from the ROM just loaded.
+ *
+ * @param options The options of the run.
+ * @param path The ROM file.
+ * @param name The name of the ROM.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int bench_rom(const BenchOptions *options, const char *path,
+                     const char *name) {
+  double seconds[options->repeats];
+  RunStats stats = {0};
+
+  for (int run = -1; run < options->repeats; run++) {
+    Chip8 *c8 = initialize();
+    if (c8 == NULL || set_cpu_mode(c8, options->mode) != SUCCESS ||
+        set_quirks(c8, options->quirks) != SUCCESS ||
+        load_rom(c8, path) != SUCCESS) {
+      destroy(c8);
+      return ERR;
+    }
+
+    run_headless(c8, DEFAULT_IPS, options->macro_cycles, 0, NULL, &stats);
+    if (run >= 0)
+      seconds[run] = stats.seconds;
+    destroy(c8);
+  }
+
+  report(options, "macro", name, stats.cycles, stats.frames, seconds);
+  return SUCCESS;
+}
+
+static int compare_names(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Times every .ch8 ROM in a directory, in name order.
+ *
+ * @param options The options of the run.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int bench_roms(const BenchOptions *options) {
+  DIR *dir = opendir(options->roms);
+  if (dir == NULL) {
+    fprintf(stderr, "Could not open ROM directory: %s\n", options->roms);
+    return ERR;
+  }
+
+  char **names = NULL;
+  size_t count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    size_t len = strlen(entry->d_name);
+    if (len < 4 || strcmp(entry->d_name + len - 4, ".ch8") != 0)
+      continue;
+    char **grown = realloc(names, (count + 1) * sizeof(char *));
+    if (grown == NULL)
+      break;
+    names = grown;
+    names[count] = strdup(entry->d_name);
+    if (names[count] != NULL)
+      count++;
+  }
+  closedir(dir);
+  qsort(names, count, sizeof(char *), compare_names);
+
+  int status = SUCCESS;
+  for (size_t i = 0; i < count; i++) {
+    char path[4096];
+    if (options->filter == NULL || strstr(names[i], options->filter)) {
+      snprintf(path, sizeof(path), "%s/%s", options->roms, names[i]);
+      if (bench_rom(options, path, names[i]) != SUCCESS)
+        status = ERR;
+    }
+    free(names[i]);
+  }
+  free(names);
+  return status;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = {DEFAULT_REPEATS, DEFAULT_MICRO_CYCLES,
+                          DEFAULT_MACRO_CYCLES, "roms", NULL,
+                          CPU_INTERPRETER, "interpreter", QUIRKS_DEFAULT,
+                          stdout};
+  const char *output = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+      options.repeats = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--micro-cycles") == 0 && i + 1 < argc) {
+      options.micro_cycles = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--macro-cycles") == 0 && i + 1 < argc) {
+      options.macro_cycles = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--roms") == 0 && i + 1 < argc) {
+      options.roms = argv[++i];
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      options.filter = argv[++i];
+    } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      if (parse_quirks(argv[++i], &options.quirks) != SUCCESS) {
+        usage(argv[0]);
+        return ERR;
+      }
+    } else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+      options.mode_name = argv[++i];
+      if (strcmp(options.mode_name, "interpreter") == 0) {
+        options.mode = CPU_INTERPRETER;
+      } else if (strcmp(options.mode_name, "cached") == 0) {
+        options.mode = CPU_CACHED;
+      } else if (strcmp(options.mode_name, "jit") == 0) {
+        options.mode = CPU_JIT;
+      } else {
+        usage(argv[0]);
+        return ERR;
+      }
+    } else {
+      usage(argv[0]);
+      return ERR;
+    }
+  }
+
+  if (options.repeats < 1 || options.micro_cycles == 0 ||
+      options.macro_cycles == 0) {
+    usage(argv[0]);
+    return ERR;
+  }
+  if (output != NULL) {
+    options.out = fopen(output, "w");
+    if (options.out == NULL) {
+      fprintf(stderr, "Could not open output file: %s\n", output);
+      return ERR;
+    }
+  }
+
+  int status = SUCCESS;
+  for (size_t k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]); k++) {
+    if (options.filter != NULL && !strstr(KERNELS[k].name, options.filter))
+      continue;
+    if (bench_kernel(&options, &KERNELS[k]) != SUCCESS)
+      status = ERR;
+  }
+  if (bench_roms(&options) != SUCCESS)
+    status = ERR;
+
+  if (options.out != stdout)
+    fclose(options.out);
+  return status;
+}
\ No newline at end of file
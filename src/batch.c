@@ -0,0 +1,465 @@
+#include "chip8.h"
+#include "headless.h"
+#include "input_script.h"
+#include "lockstep.h"
+#include "savestate.h"
+#include "text.h"
+#include "thread_pool.h"
+
+// One line of the manifest: run `rom` for `frames` frames with `script`
+typedef struct {
+  char *rom;
+  char *script; // NULL -> no input
+  uint32_t frames;
+  int line;
+} BatchJob;
+
+// Result record of a job
+typedef struct {
+  bool ok;
+  uint32_t frames; // Frames run, fewer than the job's if 00FD stopped it
+  uint64_t cycles;
+  uint64_t framebuffer_hash;
+  uint64_t state_hash;
+} BatchResult;
+
+// A ROM image, or a save state to resume from, shared by every job that
+// runs it
+typedef struct {
+  char *path;
+  uint8_t *data;
+  size_t size;
+  bool state;
+} RomImage;
+
+typedef struct {
+  BatchJob *jobs;
+  BatchResult *results;
+  size_t job_count;
+  RomImage *roms;
+  size_t rom_count;
+  CpuMode mode;
+  QuirkProfile quirks;
+  const char *state_dir; // Where final states are saved, NULL -> nowhere
+
+  // Lockstep groups: jobs group_jobs[group_start[g]..group_start[g + 1]]
+  bool lockstep;
+  size_t *group_jobs;
+  size_t *group_start;
+  size_t group_count;
+} Batch;
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s <manifest> [-j threads] [-o results.jsonl] "
+          "[--cpu interpreter|cached|jit] "
+          "[--quirks default|vip|chip48|schip|xochip] "
+          "[--lockstep] [--save-states dir]\n"
+          "Manifest lines: <rom | save state> <input script | -> <frames>, "
+          "paths with spaces in double quotes, # starts a comment\n",
+          prog);
+}
+
+/**
+ * @brief Parses the manifest into a list of jobs.
+ *
+ * @param batch The batch to fill in.
+ * @param filename The manifest file.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int load_manifest(Batch *batch, const char *filename) {
+  FILE *fp = fopen(filename, "r");
+  char line[1024];
+  size_t capacity = 0;
+  int line_number = 0;
+
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open manifest: %s\n", filename);
+    return ERR;
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    char *cursor = line;
+    char *rom = next_field(&cursor);
+    char *script = next_field(&cursor);
+    char *frames = next_field(&cursor);
+
+    line_number++;
+    if (rom == NULL)
+      continue;
+    if (script == NULL || frames == NULL || atol(frames) <= 0) {
+      fprintf(stderr, "Invalid manifest line %s:%d\n", filename, line_number);
+      fclose(fp);
+      return ERR;
+    }
+
+    if (batch->job_count == capacity) {
+      // The old array stays in batch->jobs for free_batch if this fails
+      size_t grown = capacity ? capacity * 2 : 64;
+      BatchJob *jobs = realloc(batch->jobs, grown * sizeof(BatchJob));
+      if (jobs == NULL) {
+        fprintf(stderr, "Out of memory reading manifest: %s\n", filename);
+        fclose(fp);
+        return ERR;
+      }
+      batch->jobs = jobs;
+      capacity = grown;
+    }
+
+    bool no_script = strcmp(script, "-") == 0;
+    BatchJob *job = &batch->jobs[batch->job_count];
+    job->rom = strdup(rom);
+    job->script = no_script ? NULL : strdup(script);
+    if (job->rom == NULL || (job->script == NULL && !no_script)) {
+      fprintf(stderr, "Out of memory reading manifest: %s\n", filename);
+      free(job->rom);
+      free(job->script);
+      fclose(fp);
+      return ERR;
+    }
+    job->frames = atol(frames);
+    job->line = line_number;
+    batch->job_count++;
+  }
+
+  fclose(fp);
+  return SUCCESS;
+}
+
+/**
+ * @brief Reads every distinct ROM or save state of the manifest once, up
+ * front, so the workers only copy images from memory.
+ *
+ * @param batch The batch whose ROMs to load.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int load_roms(Batch *batch) {
+  batch->roms = calloc(batch->job_count, sizeof(RomImage));
+  if (batch->roms == NULL)
+    return ERR;
+
+  for (size_t i = 0; i < batch->job_count; i++) {
+    size_t r = 0;
+    while (r < batch->rom_count && strcmp(batch->roms[r].path,
+                                          batch->jobs[i].rom) != 0)
+      r++;
+    if (r < batch->rom_count)
+      continue;
+
+    RomImage *image = &batch->roms[batch->rom_count];
+    image->state = is_state_file(batch->jobs[i].rom);
+    if (image->state)
+      image->data = read_state_file(batch->jobs[i].rom, &image->size);
+    else
+      image->data = read_rom(batch->jobs[i].rom, &image->size);
+    if (image->data == NULL)
+      return ERR;
+    image->path = batch->jobs[i].rom;
+    batch->rom_count++;
+  }
+
+  return SUCCESS;
+}
+
+static const RomImage *find_rom(const Batch *batch, const char *path) {
+  for (size_t r = 0; r < batch->rom_count; r++) {
+    if (strcmp(batch->roms[r].path, path) == 0)
+      return &batch->roms[r];
+  }
+  return NULL;
+}
+
+/**
+ * @brief Saves the final state of a job as <state_dir>/job-<index>.c8s, so
+ * a later batch can resume from it.
+ *
+ * @param batch The batch.
+ * @param index The index of the job.
+ * @param c8 The finished instance.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int save_job_state(const Batch *batch, size_t index, const Chip8 *c8) {
+  char path[4096];
+
+  if (batch->state_dir == NULL)
+    return SUCCESS;
+  snprintf(path, sizeof(path), "%s/job-%zu.c8s", batch->state_dir, index);
+  return save_state_file(c8, path);
+}
+
+/**
+ * @brief Runs one job on a fresh Chip8 instance.
+ *
+ * Instances share nothing but the read-only ROM images and dispatch table,
+ * so any number of jobs can run at once.
+ *
+ * @param index The index of the job.
+ * @param ctx The Batch.
+ */
+static void run_job(size_t index, void *ctx) {
+  Batch *batch = ctx;
+  BatchJob *job = &batch->jobs[index];
+  BatchResult *result = &batch->results[index];
+  const RomImage *rom = find_rom(batch, job->rom);
+  InputScript script = {0};
+
+  result->ok = false;
+  Chip8 *c8 = initialize();
+  if (c8 == NULL)
+    return;
+
+  if (set_quirks(c8, batch->quirks) != SUCCESS ||
+      set_cpu_mode(c8, batch->mode) != SUCCESS ||
+      (rom->state ? load_state(c8, rom->data, rom->size)
+                  : load_rom_data(c8, rom->data, rom->size)) != SUCCESS ||
+      (job->script != NULL &&
+       load_input_script(&script, job->script) != SUCCESS)) {
+    destroy(c8);
+    return;
+  }
+
+  for (uint32_t frame = 0; frame < job->frames && c8->running; frame++) {
+    apply_input_script(&script, c8, frame);
+    result->cycles += run_frame(c8, CYCLES_PER_FRAME);
+    result->frames++;
+  }
+
+  result->framebuffer_hash = framebuffer_hash(c8);
+  result->state_hash = state_hash(c8);
+  result->ok = save_job_state(batch, index, c8) == SUCCESS;
+
+  free_input_script(&script);
+  destroy(c8);
+}
+
+/**
+ * @brief Groups jobs that run the same ROM for the same number of frames,
+ * in manifest order, up to LOCKSTEP_LANES jobs per group.
+ *
+ * @param batch The batch to group.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int group_jobs(Batch *batch) {
+  bool *grouped = calloc(batch->job_count, sizeof(bool));
+  batch->group_jobs = calloc(batch->job_count, sizeof(size_t));
+  batch->group_start = calloc(batch->job_count + 1, sizeof(size_t));
+  if (grouped == NULL || batch->group_jobs == NULL ||
+      batch->group_start == NULL) {
+    free(grouped);
+    return ERR;
+  }
+
+  size_t n = 0;
+  for (size_t i = 0; i < batch->job_count; i++) {
+    if (grouped[i])
+      continue;
+
+    int lanes = 0;
+    batch->group_start[batch->group_count++] = n;
+    for (size_t j = i; j < batch->job_count && lanes < LOCKSTEP_LANES; j++) {
+      if (grouped[j] || batch->jobs[j].frames != batch->jobs[i].frames ||
+          strcmp(batch->jobs[j].rom, batch->jobs[i].rom) != 0)
+        continue;
+      grouped[j] = true;
+      batch->group_jobs[n++] = j;
+      lanes++;
+    }
+  }
+  batch->group_start[batch->group_count] = n;
+
+  free(grouped);
+  return SUCCESS;
+}
+
+/**
+ * @brief Runs a group of jobs as the lanes of one Lockstep.
+ *
+ * Lanes start from the same seed as the instances run_job creates, so the
+ * results match running each job on its own.
+ *
+ * @param index The index of the group.
+ * @param ctx The Batch.
+ */
+static void run_group(size_t index, void *ctx) {
+  Batch *batch = ctx;
+  const size_t *jobs = &batch->group_jobs[batch->group_start[index]];
+  int lanes = batch->group_start[index + 1] - batch->group_start[index];
+  const BatchJob *first = &batch->jobs[jobs[0]];
+  const RomImage *rom = find_rom(batch, first->rom);
+  InputScript scripts[LOCKSTEP_LANES] = {0};
+  int status = SUCCESS;
+
+  Lockstep *ls = lockstep_create(lanes, false);
+  if (ls == NULL)
+    return;
+
+  status = lockstep_set_quirks(ls, batch->quirks);
+  if (status == SUCCESS)
+    status = rom->state ? lockstep_load_state(ls, rom->data, rom->size)
+                        : lockstep_load_rom(ls, rom->data, rom->size);
+  for (int l = 0; l < lanes && status == SUCCESS; l++) {
+    if (batch->jobs[jobs[l]].script != NULL)
+      status = load_input_script(&scripts[l], batch->jobs[jobs[l]].script);
+  }
+
+  for (uint32_t frame = 0; frame < first->frames && status == SUCCESS;
+       frame++) {
+    // Like run_job, a lane that stopped takes no more input
+    for (int l = 0; l < lanes; l++) {
+      Chip8 *c8 = lockstep_lane(ls, l);
+      if (c8->running) {
+        apply_input_script(&scripts[l], c8, frame);
+        batch->results[jobs[l]].frames++;
+      }
+    }
+    status = lockstep_run_frame(ls, CYCLES_PER_FRAME);
+  }
+
+  for (int l = 0; l < lanes; l++) {
+    BatchResult *result = &batch->results[jobs[l]];
+    const Chip8 *c8 = lockstep_lane(ls, l);
+    result->ok = status == SUCCESS;
+    if (result->ok) {
+      result->cycles = ls->cycles[l];
+      result->framebuffer_hash = framebuffer_hash(c8);
+      result->state_hash = state_hash(c8);
+      result->ok = save_job_state(batch, jobs[l], c8) == SUCCESS;
+    }
+    free_input_script(&scripts[l]);
+  }
+
+  lockstep_destroy(ls);
+}
+
+/**
+ * @brief Writes one JSON result record per job, in manifest order.
+ *
+ * @param batch The finished batch.
+ * @param out The stream to write to.
+ */
+static void write_results(const Batch *batch, FILE *out) {
+  for (size_t i = 0; i < batch->job_count; i++) {
+    const BatchJob *job = &batch->jobs[i];
+    const BatchResult *result = &batch->results[i];
+
+    fprintf(out, "{\"job\":%zu,\"line\":%d,\"rom\":", i, job->line);
+    write_json_string(out, job->rom);
+    fprintf(out, ",\"script\":");
+    if (job->script != NULL)
+      write_json_string(out, job->script);
+    else
+      fprintf(out, "null");
+    fprintf(out,
+            ",\"frames\":%u,\"status\":\"%s\",\"cycles\":%llu,"
+            "\"framebuffer_hash\":\"%016llx\",\"state_hash\":\"%016llx\"}\n",
+            job->frames, result->ok ? "ok" : "error",
+            (unsigned long long)result->cycles,
+            (unsigned long long)result->framebuffer_hash,
+            (unsigned long long)result->state_hash);
+  }
+}
+
+static void free_batch(Batch *batch) {
+  for (size_t i = 0; i < batch->job_count; i++) {
+    free(batch->jobs[i].rom);
+    free(batch->jobs[i].script);
+  }
+  for (size_t r = 0; r < batch->rom_count; r++)
+    free(batch->roms[r].data);
+  free(batch->jobs);
+  free(batch->results);
+  free(batch->roms);
+  free(batch->group_jobs);
+  free(batch->group_start);
+}
+
+int main(int argc, char **argv) {
+  Batch batch = {0};
+  const char *output = NULL;
+  int threads = default_thread_count();
+  int status = SUCCESS;
+  batch.mode = CPU_INTERPRETER;
+
+  if (argc < 2) {
+    usage(argv[0]);
+    return ERR;
+  }
+
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "--save-states") == 0 && i + 1 < argc) {
+      batch.state_dir = argv[++i];
+    } else if (strcmp(argv[i], "--lockstep") == 0) {
+      batch.lockstep = true;
+    } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      if (parse_quirks(argv[++i], &batch.quirks) != SUCCESS) {
+        usage(argv[0]);
+        return ERR;
+      }
+    } else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "interpreter") == 0) {
+        batch.mode = CPU_INTERPRETER;
+      } else if (strcmp(argv[i], "cached") == 0) {
+        batch.mode = CPU_CACHED;
+      } else if (strcmp(argv[i], "jit") == 0) {
+        batch.mode = CPU_JIT;
+      } else {
+        usage(argv[0]);
+        return ERR;
+      }
+    } else {
+      usage(argv[0]);
+      return ERR;
+    }
+  }
+
+  if (load_manifest(&batch, argv[1]) != SUCCESS ||
+      load_roms(&batch) != SUCCESS ||
+      (batch.lockstep && group_jobs(&batch) != SUCCESS)) {
+    free_batch(&batch);
+    return ERR;
+  }
+
+  batch.results = calloc(batch.job_count, sizeof(BatchResult));
+  if (batch.results == NULL) {
+    free_batch(&batch);
+    return ERR;
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (batch.lockstep)
+    run_jobs(batch.group_count, threads, run_group, &batch);
+  else
+    run_jobs(batch.job_count, threads, run_job, &batch);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  FILE *out = output != NULL ? fopen(output, "w") : stdout;
+  if (out == NULL) {
+    fprintf(stderr, "Failed to open output file: %s\n", output);
+    free_batch(&batch);
+    return ERR;
+  }
+  write_results(&batch, out);
+  if (out != stdout)
+    fclose(out);
+
+  RunStats stats = {0};
+  for (size_t i = 0; i < batch.job_count; i++) {
+    stats.cycles += batch.results[i].cycles;
+    stats.frames += batch.results[i].frames;
+    if (!batch.results[i].ok)
+      status = ERR;
+  }
+  stats.seconds =
+      (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  fprintf(stderr, "Jobs: %zu on %d threads\n", batch.job_count, threads);
+  print_run_stats(&stats);
+
+  free_batch(&batch);
+  return status;
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "block_cache.h"
+#include "chip8.h"
+
+BlockCache *block_cache_create(void) {
+  BlockCache *cache = calloc(1, sizeof(BlockCache));
+  if (cache == NULL)
+    log_error("Error: Failed to allocate memory for the block cache.");
+  return cache;
+}
+
+/**
+ * @brief Removes a block from the cache and releases its memory.
+ *
+ * @param cache The cache holding the block.
+ * @param start The address the block starts at.
+ */
+static void drop_block(BlockCache *cache, uint32_t start) {
+  Block *block = cache->blocks[start];
+  uint32_t end = start + block->length * 2;
+
+  for (uint32_t addr = start; addr < end; addr++)
+    cache->coverage[addr]--;
+
+  cache->blocks[start] = NULL;
+  free(block);
+}
+
+void block_cache_destroy(BlockCache *cache) {
+  if (cache == NULL)
+    return;
+
+  for (uint32_t addr = 0; addr < MEMORY_SIZE; addr++) {
+    if (cache->blocks[addr] != NULL)
+      free(cache->blocks[addr]);
+  }
+  free(cache);
+}
+
+/**
+ * @brief Drops every block overlapping the written range.
+ *
+ * Writes to memory no block covers, which is the common case for data,
+ * only cost a scan of the coverage counters.
+ *
+ * @param cache The cache to update.
+ * @param addr The first address written.
+ * @param len The number of bytes written.
+ */
+void block_cache_invalidate(BlockCache *cache, uint32_t addr, uint32_t len) {
+  uint32_t end = addr + len;
+  bool covered = false;
+
+  if (end > MEMORY_SIZE)
+    end = MEMORY_SIZE;
+
+  for (uint32_t a = addr; a < end; a++) {
+    if (cache->coverage[a]) {
+      covered = true;
+      break;
+    }
+  }
+  if (!covered)
+    return;
+
+  // A block overlapping the range starts at most one block length before it
+  uint32_t first = addr >= MAX_BLOCK_OPS * 2 ? addr - MAX_BLOCK_OPS * 2 + 1 : 0;
+  for (uint32_t start = first; start < end; start++) {
+    Block *block = cache->blocks[start];
+    if (block != NULL && start + block->length * 2 > addr)
+      drop_block(cache, start);
+  }
+}
+
+/**
+ * @brief Decodes the straight-line run of instructions starting at pc.
+ *
+ * @param c8 The Chip8 instance whose memory holds the code.
+ * @param pc The address of the first instruction.
+ * @return The decoded block, or NULL if allocation fails.
+ */
+static Block *compile_block(Chip8 *c8, uint16_t pc) {
+  MicroOp ops[MAX_BLOCK_OPS];
+  uint16_t length = 0;
+  uint32_t addr = pc;
+
+  while (length < MAX_BLOCK_OPS && addr + 1 < MEMORY_SIZE) {
+    uint16_t opcode = (c8->memory[addr] << 8) | c8->memory[addr + 1];
+    Op op = op_decode_table[opcode];
+
+    ops[length].handler = c8->handlers[op];
+    ops[length].opcode = opcode;
+    length++;
+    addr += 2;
+
+    if (op_ends_block(op))
+      break;
+  }
+
+  Block *block = malloc(sizeof(Block) + length * sizeof(MicroOp));
+  if (block == NULL)
+    return NULL;
+
+  block->start = pc;
+  block->length = length;
+  memcpy(block->ops, ops, length * sizeof(MicroOp));
+
+  BlockCache *cache = c8->block_cache;
+  for (uint32_t a = pc; a < addr; a++)
+    cache->coverage[a]++;
+  cache->blocks[pc] = block;
+  return block;
+}
+
+/**
+ * @brief Executes up to max_cycles instructions from cached blocks.
+ *
+ * Every instruction in a block except the last is known to fall through to
+ * the next one, so a block runs without fetching or decoding. A block is
+ * cut short when the cycle budget runs out; execution then resumes from
+ * the block starting at the interrupted PC.
+ *
+ * @param c8 The Chip8 instance to run.
+ * @param max_cycles The maximum number of instructions to execute.
+ * @return The number of instructions executed, fewer if the instance stops.
+ */
+int block_cache_run(Chip8 *c8, int max_cycles) {
+  BlockCache *cache = c8->block_cache;
+  int cycle = 0;
+
+  while ((cycle < max_cycles) && c8->running) {
+    Block *block = NULL;
+
+    if (c8->pc + 1 < MEMORY_SIZE) {
+      block = cache->blocks[c8->pc];
+      if (block == NULL)
+        block = compile_block(c8, c8->pc);
+    }
+
+    // No block for this PC, fall back to a single interpreted step
+    if (block == NULL) {
+      fetch_opcode(c8);
+      execute_instruction(c8);
+      cycle++;
+      continue;
+    }
+
+    int count = block->length;
+    if (count > max_cycles - cycle)
+      count = max_cycles - cycle;
+
+    for (int i = 0; i < count; i++) {
+      c8->opcode = block->ops[i].opcode;
+      block->ops[i].handler(c8);
+    }
+    cycle += count;
+  }
+  return cycle;
+}
\ No newline at end of file
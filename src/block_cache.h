@@ -0,0 +1,48 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include "dispatch.h"
+
+// Longest straight-line run decoded into a single block
+#define MAX_BLOCK_OPS 32
+
+// A pre-decoded instruction
+typedef struct {
+  OpHandler handler;
+  uint16_t opcode;
+} MicroOp;
+
+// A straight-line run of instructions starting at `start`
+typedef struct {
+  uint16_t start;
+  uint16_t length;
+  MicroOp ops[];
+} Block;
+
+// Decoded blocks of one Chip8 instance, keyed by PC
+typedef struct BlockCache {
+  Block *blocks[MEMORY_SIZE];
+  uint8_t coverage[MEMORY_SIZE]; // Number of cached blocks covering a byte
+} BlockCache;
+
+/// @brief Allocates an empty block cache
+/// @return The cache, or NULL if allocation fails
+BlockCache *block_cache_create(void);
+
+/// @brief Frees a block cache and all of its blocks
+/// @param cache The cache to free
+void block_cache_destroy(BlockCache *cache);
+
+/// @brief Drops every cached block overlapping a range of memory
+/// @param cache The cache to update
+/// @param addr The first address that was written
+/// @param len The number of bytes written
+void block_cache_invalidate(BlockCache *cache, uint32_t addr, uint32_t len);
+
+/// @brief Executes instructions from cached blocks, decoding blocks as needed
+/// @param c8 The Chip8 instance, its block cache must be allocated
+/// @param max_cycles The maximum number of instructions to execute
+/// @return The number of instructions executed, fewer if the instance stops
+int block_cache_run(Chip8 *c8, int max_cycles);
+
+#endif
\ No newline at end of file
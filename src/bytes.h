@@ -0,0 +1,46 @@
+#ifndef BYTES_H
+#define BYTES_H
+
+#include <stdint.h>
+
+/*
+ * Little-endian values read from and written to a byte buffer, for the
+ * file formats that must not depend on the byte order of the host. Each
+ * call advances the pointer past the value.
+ */
+
+static inline void put8(uint8_t **p, uint8_t value) { *(*p)++ = value; }
+
+static inline void put16(uint8_t **p, uint16_t value) {
+  put8(p, value);
+  put8(p, value >> 8);
+}
+
+static inline void put32(uint8_t **p, uint32_t value) {
+  put16(p, value);
+  put16(p, value >> 16);
+}
+
+static inline void put64(uint8_t **p, uint64_t value) {
+  put32(p, value);
+  put32(p, value >> 32);
+}
+
+static inline uint8_t get8(const uint8_t **p) { return *(*p)++; }
+
+static inline uint16_t get16(const uint8_t **p) {
+  uint16_t low = get8(p);
+  return low | get8(p) << 8;
+}
+
+static inline uint32_t get32(const uint8_t **p) {
+  uint32_t low = get16(p);
+  return low | (uint32_t)get16(p) << 16;
+}
+
+static inline uint64_t get64(const uint8_t **p) {
+  uint64_t low = get32(p);
+  return low | (uint64_t)get32(p) << 32;
+}
+
+#endif
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "chip8.h"
-#include "keypad.h"
+#include "block_cache.h"
+#include "dispatch.h"
+#include "jit.h"
+#include "profile.h"
+#include "trace.h"
 
 /**
  * @brief Allocate memory for a new Chip8 instance and initialize its state.
@@ -10,19 +14,171 @@
 Chip8 *initialize() {
   Chip8 *c8 = NULL;
 
-  c8 = malloc(sizeof(Chip8));
+  c8 = calloc(1, sizeof(Chip8));
   if (c8 == NULL) {
     log_error("Error: Failed to allocate memory for Chip8 instance.");
     return NULL;
   }
 
+  init_dispatch_table();
+  c8->memory = c8->classic_memory;
+  c8->memory_size = MEMORY_SIZE;
+  c8->mode = CPU_INTERPRETER;
+  c8->block_cache = NULL;
+  c8->jit = NULL;
+  c8->trace = NULL;
+  c8->profile = NULL;
+  set_quirks(c8, QUIRKS_DEFAULT);
+#ifdef CHIP8_PROFILE
+  c8->profile = profile_create();
+  if (c8->profile == NULL) {
+    free(c8);
+    return NULL;
+  }
+#endif
+  seed_random(c8, 1);
   reset(c8);
-  for (int i = 0; i < 0x80; i++) { // Load sprite data into memory
+  for (int i = 0; i < FONTSIZE; i++) { // Load sprite data into memory
     c8->memory[0x0 + i] = sprite_data[i];
   }
+  rehash(c8);
   return c8;
 }
 
+/**
+ * @brief Free a Chip8 instance along with the state of its execution engine.
+ *
+ * @param c8 A pointer to the Chip8 instance to free.
+ */
+void destroy(Chip8 *c8) {
+  if (c8 == NULL)
+    return;
+
+  trace_stop(c8);
+  profile_destroy(c8->profile);
+  block_cache_destroy(c8->block_cache);
+  jit_destroy(c8->jit);
+  if (c8->memory != c8->classic_memory)
+    free(c8->memory);
+  free(c8);
+}
+
+/**
+ * @brief Select the engine that cycle_cpu uses to execute instructions.
+ *
+ * Engine state is allocated on first use and kept until the instance is
+ * destroyed, so switching back and forth is cheap.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param mode The engine to switch to.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int set_cpu_mode(Chip8 *c8, CpuMode mode) {
+  if (mode == CPU_CACHED && c8->block_cache == NULL) {
+    c8->block_cache = block_cache_create();
+    if (c8->block_cache == NULL)
+      return ERR;
+  }
+
+  if (mode == CPU_JIT && c8->jit == NULL) {
+    c8->jit = jit_create();
+    if (c8->jit == NULL)
+      return ERR;
+  }
+
+  c8->mode = mode;
+  return SUCCESS;
+}
+
+/**
+ * @brief Moves memory to a 64 KB block of its own for XO-CHIP, or back into
+ * the instance for the other profiles. What does not fit in 4 KB, the
+ * second display plane and the extra user flags are dropped on the way
+ * back.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param xochip true for XO-CHIP memory.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int resize_memory(Chip8 *c8, bool xochip) {
+  if (xochip == (c8->memory != c8->classic_memory))
+    return SUCCESS;
+
+  if (xochip) {
+    uint8_t *memory = calloc(1, XO_MEMORY_SIZE);
+    if (memory == NULL) {
+      log_error("Error: Failed to allocate memory for XO-CHIP.");
+      return ERR;
+    }
+    memcpy(memory, c8->classic_memory, MEMORY_SIZE);
+    c8->memory = memory;
+    c8->memory_size = XO_MEMORY_SIZE;
+    return SUCCESS;
+  }
+
+  memcpy(c8->classic_memory, c8->memory, MEMORY_SIZE);
+  free(c8->memory);
+  c8->memory = c8->classic_memory;
+  c8->memory_size = MEMORY_SIZE;
+  memset(&c8->buffer[DISPLAY_WORDS], 0,
+         (DISPLAY_PLANES - 1) * DISPLAY_WORDS * sizeof(uint64_t));
+  memset(&c8->rpl[RPL_FLAGS], 0, XO_RPL_FLAGS - RPL_FLAGS);
+  c8->planes = 1;
+  rehash(c8);
+  return SUCCESS;
+}
+
+/**
+ * @brief Selects the quirk profile instructions execute with.
+ *
+ * Every profile has a handler table of its own, so the profile is looked
+ * at here and when code is translated, never while an instruction runs.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param profile The quirk profile.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int set_quirks(Chip8 *c8, QuirkProfile profile) {
+  const Quirks *quirks = &quirk_profiles[profile];
+
+  if (resize_memory(c8, quirks->xochip) != SUCCESS)
+    return ERR;
+  c8->quirks = profile;
+  c8->handlers = op_handlers[profile];
+
+  // Only SUPER-CHIP has the large font and only XO-CHIP its letters, other
+  // profiles keep the memory they always had
+  int font = quirks->xochip  ? XO_LARGE_FONTSIZE
+             : quirks->schip ? LARGE_FONTSIZE
+                             : 0;
+  for (int i = 0; i < XO_LARGE_FONTSIZE; i++)
+    write_memory(c8, LARGE_FONT_MEM + i, i < font ? large_sprite_data[i] : 0);
+  memory_written(c8, 0, MEMORY_SIZE);
+  return SUCCESS;
+}
+
+/**
+ * @brief Notify the execution engines that a range of memory was written, so
+ * any code decoded from it is thrown away.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param addr The first address written.
+ * @param len The number of bytes written.
+ */
+void memory_written(Chip8 *c8, uint32_t addr, uint32_t len) {
+  // Addresses wrap like write_memory, a range past the end continues at 0
+  addr &= c8->memory_size - 1;
+  if (len > c8->memory_size - addr) {
+    memory_written(c8, 0, len - (c8->memory_size - addr));
+    len = c8->memory_size - addr;
+  }
+
+  if (c8->block_cache != NULL)
+    block_cache_invalidate(c8->block_cache, addr, len);
+  if (c8->jit != NULL)
+    jit_invalidate(c8->jit, addr, len);
+}
+
 /**
  * @brief Resets the Chip8 instance to its initial state.
  *
@@ -37,7 +193,14 @@ void reset(Chip8 *c8) {
   memset(c8->stack, 0, sizeof(c8->stack));
   memset(c8->registers, 0, sizeof(c8->registers));
   memset(c8->keypad, 0, sizeof(c8->keypad));
+  c8->awaited_key = -1;
   memset(c8->buffer, 0, sizeof(c8->buffer));
+  c8->hires = false;
+  c8->display_zobrist = 0;
+  mark_display_dirty(c8);
+  c8->planes = 1;
+  memset(c8->audio_pattern, DEFAULT_AUDIO_PATTERN, sizeof(c8->audio_pattern));
+  c8->pitch = DEFAULT_PITCH;
 
   c8->pc = PROGRAM_MEM;
   c8->IRegister = 0;
@@ -48,6 +211,7 @@ void reset(Chip8 *c8) {
   c8->running = true;
   c8->paused = false;
   c8->reset = false;
+  c8->rewinding = false;
   c8->draw = false;
 
   // Timers
@@ -55,6 +219,63 @@ void reset(Chip8 *c8) {
   c8->sound_timer = 0;
 }
 
+/**
+ * @brief Read a ROM file into a newly allocated buffer.
+ *
+ * @param rom_filename The name of the ROM file to read.
+ * @param size Set to the size of the ROM in bytes.
+ * @return The ROM image, or NULL if the file cannot be read or does not fit
+ * in the program space of XO-CHIP memory.
+ */
+uint8_t *read_rom(const char *rom_filename, size_t *size) {
+  FILE *fp = NULL;
+  uint8_t *data = NULL;
+
+  fp = fopen(rom_filename, "rb");
+  if (fp == NULL) {
+    log_error("Failed to open ROM file: %s", rom_filename);
+    return NULL;
+  }
+
+  data = malloc(XO_MEMORY_SIZE - PROGRAM_MEM + 1);
+  if (data == NULL) {
+    log_error("Error: Failed to allocate memory for ROM.");
+    fclose(fp);
+    return NULL;
+  }
+
+  // Read one byte more than fits, to detect oversized ROMs
+  *size = fread(data, 1, XO_MEMORY_SIZE - PROGRAM_MEM + 1, fp);
+  fclose(fp);
+  if (*size > XO_MEMORY_SIZE - PROGRAM_MEM) {
+    log_error("ROM does not fit in memory: %s", rom_filename);
+    free(data);
+    return NULL;
+  }
+
+  return data;
+}
+
+/**
+ * @brief Copy a ROM image into Chip8 memory starting at address 0x200.
+ *
+ * @param c8 The Chip8 instance to load the ROM into.
+ * @param data The ROM image.
+ * @param size The size of the ROM image in bytes.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int load_rom_data(Chip8 *c8, const uint8_t *data, size_t size) {
+  if (size > c8->memory_size - PROGRAM_MEM) {
+    log_error("ROM does not fit in memory, larger ROMs need XO-CHIP.");
+    return ERR;
+  }
+
+  memcpy(&c8->memory[PROGRAM_MEM], data, size);
+  memory_written(c8, PROGRAM_MEM, size);
+  rehash(c8);
+  return SUCCESS;
+}
+
 /**
  * @brief Load ROM into Chip8 memory starting at address 0x200.
  *
@@ -63,25 +284,237 @@ void reset(Chip8 *c8) {
  * @return Status of the operation (0 -> Success, 1 -> Error).
  */
 int load_rom(Chip8 *c8, const char *rom_filename) {
-  FILE *fp = NULL;
-  char ch;
+  size_t size;
 
-  log_info(fmt("Loading ROM: %s", rom_filename));
-  fp = fopen(rom_filename, "r");
-  if (fp == NULL) {
-    log_error(fmt("Failed to open ROM file: %s", rom_filename));
+  log_info("Loading ROM: %s", rom_filename);
+  uint8_t *data = read_rom(rom_filename, &size);
+  if (data == NULL)
     return ERR;
+
+  int status = load_rom_data(c8, data, size);
+  free(data);
+  if (status == SUCCESS)
+    log_info("Loaded ROM: %s", rom_filename);
+  return status;
+}
+
+/**
+ * @brief Seed the random number generator used by RND.
+ *
+ * Every instance has its own generator, so instances running on different
+ * threads neither share state nor affect each other's sequences.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param seed The seed.
+ */
+void seed_random(Chip8 *c8, uint32_t seed) {
+  // xorshift gets stuck on 0, so mix the seed into a non-zero state
+  c8->rng_state = (seed * 2654435761u) ^ 0x9E3779B9u;
+  if (c8->rng_state == 0)
+    c8->rng_state = 0x9E3779B9u;
+}
+
+/**
+ * @brief Advance the instance's xorshift32 generator.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @return The top byte of the new state.
+ */
+uint8_t next_random(Chip8 *c8) {
+  uint32_t x = c8->rng_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  c8->rng_state = x;
+  return x >> 24;
+}
+
+void set_keypad_mask(Chip8 *c8, uint16_t keys) {
+  for (int i = 0x0; i <= 0xF; i++)
+    c8->keypad[i] = (keys >> i) & 1;
+}
+
+uint16_t get_keypad_mask(const Chip8 *c8) {
+  uint16_t keys = 0;
+  for (int i = 0x0; i <= 0xF; i++)
+    keys |= c8->keypad[i] << i;
+  return keys;
+}
+
+/**
+ * @brief 64-bit FNV-1a over a block of bytes.
+ *
+ * @param hash The hash to continue from, FNV_OFFSET to start a new one.
+ * @param data The bytes to hash.
+ * @param len The number of bytes.
+ * @return The updated hash.
+ */
+uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+  const uint8_t *bytes = data;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ULL;
   }
+  return hash;
+}
+
+/**
+ * @brief Hash the display contents.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @return The hash of the framebuffer.
+ */
+uint64_t framebuffer_hash(const Chip8 *c8) {
+  uint64_t hash = FNV_OFFSET;
+  for (int p = 0; p < display_planes(c8); p++)
+    hash = fnv1a(hash, &c8->buffer[p * DISPLAY_WORDS],
+                 display_words(c8) * sizeof(uint64_t));
+  return hash;
+}
 
-  int index = 0x200;
-  while (!feof(fp)) {
-    ch = getc(fp);
-    c8->memory[index++] = ch;
+// Number of RPL user flags the quirk profile has
+static int rpl_flags(const Chip8 *c8) {
+  return quirk_profiles[c8->quirks].xochip ? XO_RPL_FLAGS : RPL_FLAGS;
+}
+
+// Checks if any RPL user flag is set
+static bool rpl_used(const Chip8 *c8) {
+  for (int i = 0; i < XO_RPL_FLAGS; i++) {
+    if (c8->rpl[i])
+      return true;
   }
+  return false;
+}
 
-  fclose(fp);
-  log_info(fmt("Loaded ROM: %s", rom_filename));
-  return SUCCESS;
+/**
+ * @brief Hash everything that determines how the machine continues.
+ *
+ * Fields are hashed one by one so struct padding never leaks into the hash.
+ * Only the words of the display the resolution uses are hashed, the key
+ * FX0A waits on only while it waits, the RPL flags only once one is set
+ * and the XO-CHIP state only under XO-CHIP, so
+ * machines that never use the extensions hash as they did before they were
+ * added (movies store these hashes).
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @return The hash of the machine state.
+ */
+uint64_t state_hash(const Chip8 *c8) {
+  uint64_t hash = FNV_OFFSET;
+  uint16_t keys = get_keypad_mask(c8);
+
+  hash = fnv1a(hash, c8->memory, c8->memory_size);
+  hash = fnv1a(hash, c8->registers, sizeof(c8->registers));
+  hash = fnv1a(hash, c8->stack, sizeof(c8->stack));
+  hash = fnv1a(hash, &c8->IRegister, sizeof(c8->IRegister));
+  hash = fnv1a(hash, &c8->pc, sizeof(c8->pc));
+  hash = fnv1a(hash, &c8->sp, sizeof(c8->sp));
+  hash = fnv1a(hash, &c8->delay_timer, sizeof(c8->delay_timer));
+  hash = fnv1a(hash, &c8->sound_timer, sizeof(c8->sound_timer));
+  hash = fnv1a(hash, &keys, sizeof(keys));
+  hash = fnv1a(hash, &c8->rng_state, sizeof(c8->rng_state));
+  if (c8->awaited_key >= 0)
+    hash = fnv1a(hash, &c8->awaited_key, sizeof(c8->awaited_key));
+  if (rpl_used(c8))
+    hash = fnv1a(hash, c8->rpl, rpl_flags(c8));
+  if (quirk_profiles[c8->quirks].xochip) {
+    hash = fnv1a(hash, &c8->planes, sizeof(c8->planes));
+    hash = fnv1a(hash, c8->audio_pattern, sizeof(c8->audio_pattern));
+    hash = fnv1a(hash, &c8->pitch, sizeof(c8->pitch));
+  }
+  for (int p = 0; p < display_planes(c8); p++)
+    hash = fnv1a(hash, &c8->buffer[p * DISPLAY_WORDS],
+                 display_words(c8) * sizeof(uint64_t));
+  return hash;
+}
+
+/**
+ * @brief Recompute the running hashes from every row and byte.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ */
+void rehash(Chip8 *c8) {
+  uint64_t memory = 0;
+  for (uint32_t addr = 0; addr < c8->memory_size; addr++)
+    memory ^= zobrist_key(addr, c8->memory[addr]);
+  c8->memory_zobrist = memory;
+  c8->display_zobrist = display_hash_full(c8);
+}
+
+uint64_t display_hash_full(const Chip8 *c8) {
+  uint64_t hash = c8->hires ? ZOBRIST_HIRES : 0;
+  for (int y = 0; y < DISPLAY_PLANES * DISPLAY_WORDS; y++)
+    hash ^= zobrist_key(ZOBRIST_ROW(y), c8->buffer[y]);
+  return hash;
+}
+
+/**
+ * @brief Hashes the small part of the machine state onto the hashes of
+ * memory and the display.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param memory The hash of memory.
+ * @param display The hash of the display.
+ * @return The hash of the machine state.
+ */
+static uint64_t hash_machine(const Chip8 *c8, uint64_t memory,
+                             uint64_t display) {
+  uint64_t hash = FNV_OFFSET ^ memory ^ display;
+  uint16_t keys = get_keypad_mask(c8);
+
+  hash = fnv1a(hash, c8->registers, sizeof(c8->registers));
+  hash = fnv1a(hash, c8->stack, sizeof(c8->stack));
+  hash = fnv1a(hash, &c8->IRegister, sizeof(c8->IRegister));
+  hash = fnv1a(hash, &c8->pc, sizeof(c8->pc));
+  hash = fnv1a(hash, &c8->sp, sizeof(c8->sp));
+  hash = fnv1a(hash, &c8->delay_timer, sizeof(c8->delay_timer));
+  hash = fnv1a(hash, &c8->sound_timer, sizeof(c8->sound_timer));
+  hash = fnv1a(hash, &keys, sizeof(keys));
+  hash = fnv1a(hash, &c8->awaited_key, sizeof(c8->awaited_key));
+  hash = fnv1a(hash, c8->rpl, sizeof(c8->rpl));
+  hash = fnv1a(hash, &c8->planes, sizeof(c8->planes));
+  hash = fnv1a(hash, c8->audio_pattern, sizeof(c8->audio_pattern));
+  hash = fnv1a(hash, &c8->pitch, sizeof(c8->pitch));
+  return fnv1a(hash, &c8->rng_state, sizeof(c8->rng_state));
+}
+
+uint64_t machine_hash_full(const Chip8 *c8) {
+  uint64_t memory = 0;
+  for (uint32_t addr = 0; addr < c8->memory_size; addr++)
+    memory ^= zobrist_key(addr, c8->memory[addr]);
+  return hash_machine(c8, memory, display_hash_full(c8));
+}
+
+/**
+ * @brief Stops the program if a running hash no longer matches a full
+ * recompute, which means a write bypassed write_memory or write_row.
+ * Only compiled in with -DCHIP8_HASH_CHECK.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ */
+static void check_hashes(const Chip8 *c8) {
+#ifdef CHIP8_HASH_CHECK
+  if (display_hash_full(c8) != c8->display_zobrist ||
+      machine_hash_full(c8) !=
+          hash_machine(c8, c8->memory_zobrist, c8->display_zobrist)) {
+    log_error("Running hash out of date at PC %03X, opcode %04X", c8->pc,
+              c8->opcode);
+    log_flush();
+    abort();
+  }
+#else
+  (void)c8;
+#endif
+}
+
+uint64_t display_hash(const Chip8 *c8) {
+  check_hashes(c8);
+  return c8->display_zobrist;
+}
+
+uint64_t machine_hash(const Chip8 *c8) {
+  check_hashes(c8);
+  return hash_machine(c8, c8->memory_zobrist, c8->display_zobrist);
 }
 
 /**
@@ -91,168 +524,125 @@ int load_rom(Chip8 *c8, const char *rom_filename) {
  * @param c8 A pointer to the Chip8 instance.
  */
 void fetch_opcode(Chip8 *c8) {
-  c8->opcode = (c8->memory[c8->pc] << 8) | c8->memory[c8->pc + 1];
+  c8->opcode = (read_memory(c8, c8->pc) << 8) | read_memory(c8, c8->pc + 1);
 }
 
 /**
  * Executes the current opcode that the program counter is pointing to.
  *
+ * The opcode is looked up in the precomputed dispatch table, which maps it
+ * straight to its handler in the table of the instance's quirk profile (or
+ * to an error handler for unknown opcodes).
+ *
  * @param c8 A pointer to the Chip8 instance containing the opcode
  *           and system state.
  * @return SUCCESS if the instruction was executed successfully,
  *         ERR if an error occurred (e.g., stack overflow/underflow).
  */
 int execute_instruction(Chip8 *c8) {
-  switch (c8->opcode & 0xF000) {
-  case 0x0000:
-    if (c8->opcode == 0x00E0) {
-      cls(c8);
-    } else if (c8->opcode == 0x00EE) {
-      ret(c8);
-    } else {
-      sys_addr(c8);
-    }
-    break;
-
-  case 0x1000:
-    jmp_addr(c8);
-    break;
-  case 0x2000:
-    call_addr(c8);
-    break;
-  case 0x3000:
-    se_vx_byte(c8);
-    break;
-  case 0x4000:
-    sne_vx_byte(c8);
-    break;
-  case 0x5000:
-    se_vx_vy(c8);
-    break;
-  case 0x6000:
-    ld_vx_byte(c8);
-    break;
-  case 0x7000:
-    add_vx_byte(c8);
-    break;
-
-  case 0x8000:
-    switch (c8->opcode & 0x000F) {
-    case 0x0:
-      ld_vx_vy(c8);
-      break;
-    case 0x1:
-      or_vx_vy(c8);
-      break;
-    case 0x2:
-      and_vx_vy(c8);
-      break;
-    case 0x3:
-      xor_vx_vy(c8);
-      break;
-    case 0x4:
-      add_vx_vy(c8);
-      break;
-    case 0x5:
-      sub_vx_vy(c8);
-      break;
-    case 0x6:
-      shr_vx(c8);
-      break;
-    case 0x7:
-      subn_vx_vy(c8);
-      break;
-    case 0xE:
-      shl_vx(c8);
-      break;
-    default:
-      log_error(fmt("Unknown opcode: %04X\n", c8->opcode));
-      return ERR;
-    }
-    break;
-
-  case 0x9000:
-    sne_vx_vy(c8);
-    break;
-  case 0xA000:
-    ld_i_addr(c8);
-    break;
-  case 0xB000:
-    jp_v0_addr(c8);
-    break;
-  case 0xC000:
-    rnd_vx_kk(c8);
-    break;
-  case 0xD000:
-    drw_vx_vy_nibble(c8);
-    break;
-
-  case 0xE000:
-    switch (c8->opcode & 0x00FF) {
-    case 0x9E:
-      skp_vx(c8);
-      break;
-    case 0xA1:
-      sknp_vx(c8);
-      break;
-    default:
-      return ERR;
-    }
-    break;
-
-  case 0xF000:
-    switch (c8->opcode & 0x00FF) {
-    case 0x07:
-      ld_vx_dt(c8);
-      break;
-    case 0x0A:
-      int key = wait_for_key(c8);
-      ld_vx_k(c8, key);
-      break;
-    case 0x15:
-      ld_dt_vx(c8);
-      break;
-    case 0x18:
-      ld_st_vx(c8);
-      break;
-    case 0x1E:
-      add_i_vx(c8);
-      break;
-    case 0x29:
-      ld_f_vx(c8);
-      break;
-    case 0x33:
-      ld_b_vx(c8);
-      break;
-    case 0x55:
-      ld_i_vx(c8);
-      break;
-    case 0x65:
-      ld_vx_i(c8);
-      break;
-    default:
-      log_error(fmt("Unknown opcode: %04X\n", c8->opcode));
-      return ERR;
-    }
-    break;
+  return c8->handlers[op_decode_table[c8->opcode]](c8);
+}
 
-  default:
-    log_error(fmt("Unknown opcode: %04X\n", c8->opcode));
-    return ERR;
+/**
+ * @brief Switches the display resolution.
+ *
+ * Every plane of the display is cleared, as on modern SUPER-CHIP and
+ * XO-CHIP interpreters, so no pixels have to be converted between the two
+ * layouts of the framebuffer.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param hires true for the 128x64 display, false for 64x32.
+ */
+void set_resolution(Chip8 *c8, bool hires) {
+  memset(c8->buffer, 0, sizeof(c8->buffer));
+  c8->hires = hires;
+  c8->display_zobrist = hires ? ZOBRIST_HIRES : 0;
+  mark_display_dirty(c8);
+  c8->draw = true;
+}
+
+/**
+ * @brief Collect the rows that changed since the last call.
+ *
+ * Rows are marked dirty by the instructions that draw. A dirty row whose
+ * contents match what was last collected, e.g. a sprite drawn and erased
+ * within the same frame, is dropped, so a result of 0 means presenting can
+ * be skipped. A row is dirty if it changed in any plane.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @return A mask with bit y set if row y changed.
+ */
+uint64_t take_dirty_rows(Chip8 *c8) {
+  int rows = c8->hires ? HIRES_HEIGHT : SCREEN_HEIGHT;
+  int stride = display_words(c8) / rows;
+  uint64_t dirty = c8->dirty_rows & (~0ull >> (64 - rows));
+
+  // Nothing can be dropped when the display was replaced as a whole
+  if (c8->redraw) {
+    memcpy(c8->presented, c8->buffer, sizeof(c8->presented));
+    c8->redraw = false;
+    c8->dirty_rows = 0;
+    return dirty;
   }
 
-  return SUCCESS;
+  for (int y = 0; y < rows; y++) {
+    if (!(dirty & (1ull << y)))
+      continue;
+
+    bool changed = false;
+    for (int p = 0; p < display_planes(c8); p++) {
+      int word = p * DISPLAY_WORDS + y * stride;
+      if (memcmp(&c8->buffer[word], &c8->presented[word], stride * 8) != 0) {
+        memcpy(&c8->presented[word], &c8->buffer[word], stride * 8);
+        changed = true;
+      }
+    }
+    if (!changed)
+      dirty &= ~(1ull << y);
+  }
+
+  c8->dirty_rows = 0;
+  return dirty;
+}
+
+void mark_display_dirty(Chip8 *c8) {
+  c8->dirty_rows = ~0ull;
+  c8->redraw = true;
 }
 
-void cycle_cpu(Chip8 *c8, int max_cycles) {
+/**
+ * @brief Executes up to max_cycles instructions.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param max_cycles The maximum number of instructions to execute.
+ * @return The number of instructions executed, fewer if the instance stops.
+ */
+int cycle_cpu(Chip8 *c8, int max_cycles) {
+  if (c8->trace != NULL)
+    return trace_run(c8, max_cycles);
+#ifdef CHIP8_PROFILE
+  if (c8->profile != NULL)
+    return profile_run(c8, max_cycles);
+#endif
+  if (c8->mode == CPU_CACHED)
+    return block_cache_run(c8, max_cycles);
+  if (c8->mode == CPU_JIT)
+    return jit_run(c8, max_cycles);
+
   int cycle = 0;
   while ((cycle < max_cycles) && c8->running) {
     fetch_opcode(c8);
     execute_instruction(c8);
     cycle++;
   };
+  return cycle;
 }
 
+/**
+ * @brief Decrements the delay and sound timers, called at 60 Hz.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ */
 void update_timers(Chip8 *c8) {
   if (c8->delay_timer > 0) {
     c8->delay_timer--;
@@ -262,3 +652,18 @@ void update_timers(Chip8 *c8) {
     c8->sound_timer--;
   }
 }
+
+/**
+ * @brief Emulates one 60 Hz frame: a batch of instructions followed by a
+ * timer tick.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param max_cycles The number of instructions to execute in the frame.
+ * @return The number of instructions executed, fewer if the instance stops.
+ */
+int run_frame(Chip8 *c8, int max_cycles) {
+  int cycles = cycle_cpu(c8, max_cycles);
+  update_timers(c8);
+  check_hashes(c8);
+  return cycles;
+}
\ No newline at end of file
@@ -9,6 +9,31 @@
 /// @return A chip 8 instance
 Chip8 *initialize();
 
+/// @brief Free a Chip8 instance and everything it owns
+/// @param c8 The chip 8 instance to free
+void destroy(Chip8 *c8);
+
+/// @brief Select the engine that executes instructions
+/// @param c8 The Chip8 instance
+/// @param mode The engine to use
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int set_cpu_mode(Chip8 *c8, CpuMode mode);
+
+/// @brief Select the quirk profile instructions execute with
+/// Best done once before the ROM is loaded: code already decoded by the
+/// cached and JIT engines is thrown away, and memory is resized when
+/// switching to or from XO-CHIP.
+/// @param c8 The Chip8 instance
+/// @param profile The quirk profile
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int set_quirks(Chip8 *c8, QuirkProfile profile);
+
+/// @brief Notify the execution engines that memory was written
+/// @param c8 The Chip8 instance whose memory changed
+/// @param addr The first address written, wrapped around at memory_size
+/// @param len The number of bytes written, continuing at 0 past the end
+void memory_written(Chip8 *c8, uint32_t addr, uint32_t len);
+
 /// @brief Reset the Chip8 instance
 /// @param c8 A chip 8 instance to reset
 void reset(Chip8 *c8);
@@ -19,6 +44,146 @@ void reset(Chip8 *c8);
 /// @return Status of the operation (0 -> Success, 1 -> Error)
 int load_rom(Chip8 *c8, const char *rom_filename);
 
+/// @brief Load a ROM image that is already in memory into Chip8 RAM
+/// @param c8 The Chip8 to load ROM into
+/// @param data The ROM image
+/// @param size The size of the ROM image in bytes
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int load_rom_data(Chip8 *c8, const uint8_t *data, size_t size);
+
+/// @brief Read a ROM file into a newly allocated buffer
+/// @param rom_filename The name of the ROM file
+/// @param size Set to the size of the ROM in bytes
+/// @return The ROM image (free with free()), or NULL on error
+uint8_t *read_rom(const char *rom_filename, size_t *size);
+
+/// @brief Seed the random number generator used by RND
+/// @param c8 The Chip8 instance
+/// @param seed The seed, any value is valid
+void seed_random(Chip8 *c8, uint32_t seed);
+
+/// @brief Draw the next byte from the instance's random number generator
+/// @param c8 The Chip8 instance
+/// @return A random byte
+uint8_t next_random(Chip8 *c8);
+
+/// @brief Set the keypad from a mask with bit k set if key k is pressed
+/// @param c8 The Chip8 instance
+/// @param keys The mask of pressed keys
+void set_keypad_mask(Chip8 *c8, uint16_t keys);
+
+/// @brief Get the keypad as a mask with bit k set if key k is pressed
+/// @param c8 The Chip8 instance
+/// @return The mask of pressed keys
+uint16_t get_keypad_mask(const Chip8 *c8);
+
+// Starting value of an FNV-1a hash
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+
+/// @brief Continue a 64-bit FNV-1a hash over a block of bytes
+/// @param hash The hash so far, FNV_OFFSET for a new hash
+/// @param data The bytes to hash
+/// @param len The number of bytes
+/// @return The updated hash
+uint64_t fnv1a(uint64_t hash, const void *data, size_t len);
+
+/// @brief Hash the display contents
+/// @param c8 The Chip8 instance
+/// @return A 64-bit FNV-1a hash of the framebuffer
+uint64_t framebuffer_hash(const Chip8 *c8);
+
+/// @brief Hash the full machine state (memory, registers, stack, timers,
+///        keypad, random state and display)
+/// @param c8 The Chip8 instance
+/// @return A 64-bit FNV-1a hash of the machine state
+uint64_t state_hash(const Chip8 *c8);
+
+/*
+ * Running hashes: the display and memory hashes are the XOR of a key for
+ * every row and byte that is not zero, so a write updates them by XORing
+ * out the key of the old value and XORing in the key of the new one. They
+ * are independent of framebuffer_hash and state_hash, which hash the bytes
+ * in order and are stored in movies.
+ */
+
+/// @brief Key of a value at a position, 0 for a value of 0
+/// Multiplying by an odd constant per position keeps 0 at 0 without a
+/// branch, and the shift folds the well mixed high bits into the low ones.
+/// Both steps are invertible, so different values never share a key.
+/// @param position The row or address, salted by what it is the key for
+/// @param value The row or byte
+/// @return A 64-bit key
+static inline uint64_t zobrist_key(uint64_t position, uint64_t value) {
+  uint64_t z = value * ((position * 0x9E3779B97F4A7C15ULL) | 1);
+  return z ^ (z >> 29);
+}
+
+// Positions of display words, after every XO-CHIP memory address
+#define ZOBRIST_ROW(y) (XO_MEMORY_SIZE + 1 + (y))
+// Key of high resolution mode, so a blank 128x64 display does not hash like
+// a blank 64x32 one
+#define ZOBRIST_HIRES                                                          \
+  zobrist_key(ZOBRIST_ROW(DISPLAY_PLANES * DISPLAY_WORDS), 1)
+
+/// @brief Read a byte of memory
+/// @param c8 The Chip8 instance
+/// @param addr The address, wrapped around at memory_size
+/// @return The byte
+static inline uint8_t read_memory(const Chip8 *c8, uint16_t addr) {
+  return c8->memory[addr & (c8->memory_size - 1)];
+}
+
+/// @brief Write a byte of memory, keeping the memory hash up to date
+/// memory_written must still be called for the range written.
+/// @param c8 The Chip8 instance
+/// @param addr The address, wrapped around at memory_size
+/// @param value The byte to write
+static inline void write_memory(Chip8 *c8, uint16_t addr, uint8_t value) {
+  addr &= c8->memory_size - 1;
+  c8->memory_zobrist ^=
+      zobrist_key(addr, c8->memory[addr]) ^ zobrist_key(addr, value);
+  c8->memory[addr] = value;
+}
+
+/// @brief Replace a word of the display, keeping the display hash up to date
+/// @param c8 The Chip8 instance
+/// @param y The word, the row of the first plane in low resolution (see
+///          Chip8.buffer)
+/// @param row The new pixels of the word
+static inline void write_row(Chip8 *c8, int y, uint64_t row) {
+  c8->display_zobrist ^= zobrist_key(ZOBRIST_ROW(y), c8->buffer[y]) ^
+                         zobrist_key(ZOBRIST_ROW(y), row);
+  c8->buffer[y] = row;
+}
+
+/// @brief Recompute the running hashes from scratch
+/// Needed after memory or the display is written directly, e.g. by loading
+/// a ROM or a save state.
+/// @param c8 The Chip8 instance
+void rehash(Chip8 *c8);
+
+/// @brief Hash the display from scratch, as display_hash should return
+/// @param c8 The Chip8 instance
+/// @return The hash of the display
+uint64_t display_hash_full(const Chip8 *c8);
+
+/// @brief Hash the machine state from scratch, as machine_hash should return
+/// @param c8 The Chip8 instance
+/// @return The hash of the machine state
+uint64_t machine_hash_full(const Chip8 *c8);
+
+/// @brief Get the running hash of the display
+/// @param c8 The Chip8 instance
+/// @return The hash of the display, without rereading it
+uint64_t display_hash(const Chip8 *c8);
+
+/// @brief Get the running hash of the full machine state
+/// Memory and the display come from their running hashes, only the
+/// registers, stack, timers, keypad and random state are read.
+/// @param c8 The Chip8 instance
+/// @return The hash of the machine state
+uint64_t machine_hash(const Chip8 *c8);
+
 // Fetch opcode from memory and store it in the Chip8 instance
 void fetch_opcode(Chip8 *c8);
 
@@ -28,7 +193,54 @@ int execute_instruction(Chip8 *c8);
 // Update the timers of the Chip8 instance
 void update_timers(Chip8 *c8);
 
-// Execute instructions for one CPU cycle
-void cycle_cpu(Chip8 *c8, int max_cycles);
+/// @brief Get the number of words of a plane the resolution uses
+/// @param c8 The Chip8 instance
+/// @return SCREEN_HEIGHT in low resolution, DISPLAY_WORDS in high resolution
+static inline int display_words(const Chip8 *c8) {
+  return c8->hires ? DISPLAY_WORDS : SCREEN_HEIGHT;
+}
+
+/// @brief Get the number of display planes the quirk profile draws to
+/// @param c8 The Chip8 instance
+/// @return DISPLAY_PLANES for XO-CHIP, 1 otherwise
+static inline int display_planes(const Chip8 *c8) {
+  return quirk_profiles[c8->quirks].xochip ? DISPLAY_PLANES : 1;
+}
+
+/// @brief Read a pixel of the first display plane
+/// @param c8 The Chip8 instance
+/// @param x The column, 0 to SCREEN_WIDTH - 1 (HIRES_WIDTH - 1 in high
+///          resolution)
+/// @param y The row, 0 to SCREEN_HEIGHT - 1 (HIRES_HEIGHT - 1)
+/// @return true if the pixel is lit
+static inline bool get_pixel(const Chip8 *c8, int x, int y) {
+  if (c8->hires)
+    return (c8->buffer[2 * y + x / 64] >> (63 - x % 64)) & 1;
+  return (c8->buffer[y] >> (SCREEN_WIDTH - 1 - x)) & 1;
+}
+
+/// @brief Switch between the 64x32 and the 128x64 display, clearing it
+/// @param c8 The Chip8 instance
+/// @param hires true for 128x64
+void set_resolution(Chip8 *c8, bool hires);
+
+/// @brief Collect the rows that changed since the last call
+/// @param c8 The Chip8 instance
+/// @return A mask with bit y set if row y differs from the last collected
+///         frame (0 -> nothing to present)
+uint64_t take_dirty_rows(Chip8 *c8);
+
+/// @brief Report every row at the next take_dirty_rows, changed or not
+/// Needed when the display is replaced as a whole, e.g. by a resolution
+/// switch, as the last collected frame no longer says what is shown.
+/// @param c8 The Chip8 instance
+void mark_display_dirty(Chip8 *c8);
+
+// Execute instructions for one CPU cycle, returns the number executed
+int cycle_cpu(Chip8 *c8, int max_cycles);
+
+// Execute one frame worth of instructions and tick the timers, returns the
+// number of instructions executed
+int run_frame(Chip8 *c8, int max_cycles);
 
 #endif
\ No newline at end of file
@@ -7,7 +7,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include "raylib.h"
+
+#include "quirks.h"
 
 // Return codes for function calls
 #define SUCCESS 0
@@ -15,19 +16,57 @@
 
 // Starting address of the program space in memory
 #define PROGRAM_MEM 0x200
+#define MEMORY_SIZE 4096
+// XO-CHIP memory, the whole range of the 16-bit I register
+#define XO_MEMORY_SIZE 0x10000
 #define STACKSIZE 16
 #define FONTSIZE 80
+// SUPER-CHIP large font, 10 bytes per digit right after the small font
+#define LARGE_FONT_MEM FONTSIZE
+#define LARGE_FONTSIZE 100
+// XO-CHIP also has large hex digits A to F
+#define XO_LARGE_FONTSIZE 160
+// SUPER-CHIP RPL user flags saved and loaded by FX75 and FX85
+#define RPL_FLAGS 8
+// XO-CHIP has one for every register
+#define XO_RPL_FLAGS 16
+// XO-CHIP audio pattern buffer, played one bit at a time
+#define AUDIO_PATTERN_SIZE 16
+// XO-CHIP pitch register value of a 4000 Hz pattern
+#define DEFAULT_PITCH 64
+// Every byte of the audio pattern until F002 loads one, a 500 Hz square
+// wave at the default pitch
+#define DEFAULT_AUDIO_PATTERN 0xF0
 
-// IO props
+// IO props, the low resolution display
 #define SCREEN_WIDTH 64
 #define SCREEN_HEIGHT 32
+// SUPER-CHIP high resolution display
+#define HIRES_WIDTH 128
+#define HIRES_HEIGHT 64
+// 64-bit words of a display plane, enough for the high resolution display
+#define DISPLAY_WORDS (HIRES_WIDTH / 64 * HIRES_HEIGHT)
+// XO-CHIP bitplanes, other profiles only draw to the first
+#define DISPLAY_PLANES 2
 
 // Timers
 #define DELAY_TIMER 60
 #define SOUND_TIMER 60
 
-// Resources
-#define SFX "./res/beep.mp3"
+// Instructions executed per 60 Hz frame
+#define CYCLES_PER_FRAME 60
+
+// Execution engines that can run a Chip8 instance
+typedef enum {
+  CPU_INTERPRETER, // Fetch, decode and execute one instruction at a time
+  CPU_CACHED,      // Execute pre-decoded blocks cached by PC
+  CPU_JIT,         // Execute blocks translated to native code (x86-64 only)
+} CpuMode;
+
+struct BlockCache;
+struct Jit;
+struct Trace;
+struct Profile;
 
 /**
  * Represents a Chip8 system
@@ -64,10 +103,41 @@
  * opcode -> The current instruction to be executed
  * pc (Program Counter) -> points to the next instruction
  * sp (Stack Pointer) -> ponits to the last memory address on the stack
+ * memory -> classic_memory, or the XO_MEMORY_SIZE bytes set_quirks
+ *           allocates for XO-CHIP, so classic programs keep the 4 KB they
+ *           always had next to the registers
+ * memory_size -> The bytes memory points at
+ * hires -> SUPER-CHIP 128x64 mode, false -> the 64x32 display
+ * buffer -> The display, read it with get_pixel. Plane p starts at
+ *           buffer[p * DISPLAY_WORDS]. In low resolution row y of a plane
+ *           is its word y, in high resolution it is the two words 2y
+ *           (x 0 to 63) and 2y + 1 (x 64 to 127). Words the resolution
+ *           does not use are always 0.
+ * presented -> The display as of the last take_dirty_rows call
+ * dirty_rows -> Bit y is set if row y was drawn to since then
+ * redraw -> Report every row at the next take_dirty_rows, as presented no
+ *           longer says what is shown
+ * planes -> XO-CHIP planes drawn to, bit p for plane p, always 1 otherwise
+ * audio_pattern, pitch -> XO-CHIP sound, played while the sound timer runs
+ * rpl -> SUPER-CHIP user flags, kept across a reset like the HP-48 keeps
+ *        them between programs. Only XO-CHIP uses more than RPL_FLAGS.
+ * awaited_key -> The key FX0A saw pressed and now waits to see released,
+ *                -1 -> FX0A waits for a key to be pressed
+ * rng_state -> State of the instance's own random number generator (RND)
+ * display_zobrist, memory_zobrist -> Running hashes of the display and the
+ *         memory, kept up to date by every write (see display_hash)
+ * mode -> The engine used by cycle_cpu, block_cache and jit are only
+ *         allocated once their engine is selected
+ * trace -> The execution trace being recorded, NULL -> none
+ * profile -> Execution counters, only collected in CHIP8_PROFILE builds
+ * quirks -> The quirk profile, a host setting that survives a reset
+ * handlers -> The handler table compiled for it, op_handlers[quirks]
  */
-typedef struct {
+typedef struct Chip8 {
   uint16_t stack[16];
-  uint8_t memory[4096];
+  uint8_t *memory;
+  uint32_t memory_size;
+  uint8_t classic_memory[MEMORY_SIZE];
   uint8_t registers[16];
   uint16_t IRegister;
   uint16_t opcode;
@@ -76,13 +146,35 @@ typedef struct {
   uint8_t delay_timer;
   uint8_t sound_timer;
   bool keypad[16];
-  uint32_t buffer[SCREEN_WIDTH * SCREEN_HEIGHT];
-  Sound sfx;
+  int8_t awaited_key;
+  uint32_t rng_state;
+  bool hires;
+  uint64_t buffer[DISPLAY_PLANES * DISPLAY_WORDS]; // MSB of a word is x = 0
+  uint64_t presented[DISPLAY_PLANES * DISPLAY_WORDS];
+  uint64_t dirty_rows;
+  bool redraw;
+  uint8_t planes;
+  uint8_t audio_pattern[AUDIO_PATTERN_SIZE];
+  uint8_t pitch;
+  uint8_t rpl[XO_RPL_FLAGS];
+  uint64_t display_zobrist;
+  uint64_t memory_zobrist;
+
+  // Execution engine
+  CpuMode mode;
+  struct BlockCache *block_cache;
+  struct Jit *jit;
+  struct Trace *trace;
+  struct Profile *profile;
+  QuirkProfile quirks;
+  int (*const *handlers)(struct Chip8 *c8);
 
   // Flags
   bool running;
   bool paused;
   bool reset;
+  bool rewinding;
+  bool turbo; // Fast-forward, a host setting that survives a reset
   bool draw;
 } Chip8;
 
@@ -106,4 +198,24 @@ static const uint8_t sprite_data[FONTSIZE] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+// SUPER-CHIP large digits, 8x10 pixels, followed by XO-CHIP's A to F
+static const uint8_t large_sprite_data[XO_LARGE_FONTSIZE] = {
+    0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, // 0
+    0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, // 1
+    0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, // 2
+    0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, // 3
+    0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, // 5
+    0x3E, 0x7C, 0xE0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, // 6
+    0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, // 7
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, // 8
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, // 9
+    0x3C, 0x7E, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFE, 0xC3, 0xC3, 0xFE, 0xFE, 0xC3, 0xC3, 0xFE, 0xFC, // B
+    0x3C, 0x7E, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0x7E, 0x3C, // C
+    0xFC, 0xFE, 0xC7, 0xC3, 0xC3, 0xC3, 0xC3, 0xC7, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
 #endif
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "debug.h"
 #include "chip8_types.h"
+#include <stdatomic.h>
 #include <stdio.h>
-#include <stdlib.h>
 
-int debugger_enabled = 0;
+// Written once at startup, read by any thread that prints debug output
+static atomic_int debugger_enabled = 0;
 void debugger_init(void) { debugger_enabled = 1; }
 
 bool is_debugger_enabled(void) { return debugger_enabled; }
@@ -17,8 +18,6 @@ void print_sys_info(Chip8 *c8) {
     return;
   }
 
-  system("clear");
-
   // Print system information
   printf("===================================\n");
   printf("System Information\n");
@@ -0,0 +1,390 @@
+#include "dispatch.h"
+#include "instructions.h"
+#include "logger.h"
+#include <pthread.h>
+
+uint8_t op_decode_table[0x10000];
+static pthread_once_t dispatch_table_once = PTHREAD_ONCE_INIT;
+
+// Wraps a handler that cannot fail into the uniform OpHandler signature
+#define WRAP_HANDLER(name)                                                     \
+  static int op_##name(Chip8 *c8) {                                            \
+    name(c8);                                                                  \
+    return SUCCESS;                                                            \
+  }
+
+WRAP_HANDLER(cls)
+WRAP_HANDLER(scd_nibble)
+WRAP_HANDLER(scu_nibble)
+WRAP_HANDLER(scr)
+WRAP_HANDLER(scl)
+WRAP_HANDLER(exit_interpreter)
+WRAP_HANDLER(low)
+WRAP_HANDLER(high)
+WRAP_HANDLER(sys_addr)
+WRAP_HANDLER(jmp_addr)
+WRAP_HANDLER(ld_i_vx_vy)
+WRAP_HANDLER(ld_vx_vy_i)
+WRAP_HANDLER(ld_vx_byte)
+WRAP_HANDLER(add_vx_byte)
+WRAP_HANDLER(ld_vx_vy)
+WRAP_HANDLER(add_vx_vy)
+WRAP_HANDLER(sub_vx_vy)
+WRAP_HANDLER(subn_vx_vy)
+WRAP_HANDLER(ld_i_addr)
+WRAP_HANDLER(rnd_vx_kk)
+WRAP_HANDLER(ld_vx_dt)
+WRAP_HANDLER(ld_dt_vx)
+WRAP_HANDLER(ld_st_vx)
+WRAP_HANDLER(add_i_vx)
+WRAP_HANDLER(ld_f_vx)
+WRAP_HANDLER(ld_hf_vx)
+WRAP_HANDLER(ld_b_vx)
+WRAP_HANDLER(ld_i_long)
+WRAP_HANDLER(plane_n)
+WRAP_HANDLER(ld_audio_i)
+WRAP_HANDLER(ld_pitch_vx)
+
+// Wraps the handlers compiled for one quirk profile
+#define WRAP_QUIRK_HANDLERS(name, ...)                                         \
+  WRAP_HANDLER(se_vx_byte_##name)                                              \
+  WRAP_HANDLER(sne_vx_byte_##name)                                             \
+  WRAP_HANDLER(se_vx_vy_##name)                                                \
+  WRAP_HANDLER(or_vx_vy_##name)                                                \
+  WRAP_HANDLER(and_vx_vy_##name)                                               \
+  WRAP_HANDLER(xor_vx_vy_##name)                                               \
+  WRAP_HANDLER(shr_vx_##name)                                                  \
+  WRAP_HANDLER(shl_vx_##name)                                                  \
+  WRAP_HANDLER(sne_vx_vy_##name)                                               \
+  WRAP_HANDLER(jp_v0_addr_##name)                                              \
+  WRAP_HANDLER(drw_vx_vy_nibble_##name)                                        \
+  WRAP_HANDLER(skp_vx_##name)                                                  \
+  WRAP_HANDLER(sknp_vx_##name)                                                 \
+  WRAP_HANDLER(ld_i_vx_##name)                                                 \
+  WRAP_HANDLER(ld_vx_i_##name)                                                 \
+  WRAP_HANDLER(ld_r_vx_##name)                                                 \
+  WRAP_HANDLER(ld_vx_r_##name)
+
+QUIRK_PROFILES(WRAP_QUIRK_HANDLERS)
+
+/**
+ * @brief Waits for a key to be pressed and then released, as the COSMAC
+ * VIP does, so a key held down satisfies one FX0A and not every FX0A
+ * executed while it is held.
+ *
+ * The keypad is filled in by whichever frontend drives the instance, so the
+ * core only looks at its own state and never polls an input device.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @return The key value once it is released, or -1 while waiting.
+ */
+static int wait_for_key(Chip8 *c8) {
+  if (c8->awaited_key < 0) {
+    for (int i = 0x0; i <= 0xF; i++) {
+      if (c8->keypad[i]) {
+        c8->awaited_key = i;
+        break;
+      }
+    }
+    return -1;
+  }
+
+  if (c8->keypad[c8->awaited_key])
+    return -1;
+  int key = c8->awaited_key;
+  c8->awaited_key = -1;
+  return key;
+}
+
+// 0xFX0A -> LD: Wait for a key press and release and store it in Vx
+static int op_ld_vx_k(Chip8 *c8) {
+  ld_vx_k(c8, wait_for_key(c8));
+  return SUCCESS;
+}
+
+// Any opcode that does not decode to an instruction
+static int op_unknown(Chip8 *c8) {
+  log_error("Unknown opcode: %04X\n", c8->opcode);
+  return ERR;
+}
+
+// The handler of an extension's instruction if the profile has the
+// extension, or what the opcode did before under other profiles
+#define EXTENSION_OP(extension, handler, fallback)                             \
+  ((extension) ? (handler) : (fallback))
+
+// Handler of every decoded operation under one quirk profile
+#define HANDLER_TABLE(name, profile, vf_reset, shift_vy, index, clip, jump_vx, \
+                      schip, xochip)                                           \
+  [profile] = {                                                                \
+      [OP_UNKNOWN] = op_unknown,                                               \
+      [OP_CLS] = op_cls,                                                       \
+      [OP_RET] = ret,                                                          \
+      [OP_SYS_ADDR] = op_sys_addr,                                             \
+      [OP_JP_ADDR] = op_jmp_addr,                                              \
+      [OP_CALL_ADDR] = call_addr,                                              \
+      [OP_SE_VX_BYTE] = op_se_vx_byte_##name,                                  \
+      [OP_SNE_VX_BYTE] = op_sne_vx_byte_##name,                                \
+      [OP_SE_VX_VY] = op_se_vx_vy_##name,                                      \
+      [OP_LD_VX_BYTE] = op_ld_vx_byte,                                         \
+      [OP_ADD_VX_BYTE] = op_add_vx_byte,                                       \
+      [OP_LD_VX_VY] = op_ld_vx_vy,                                             \
+      [OP_OR_VX_VY] = op_or_vx_vy_##name,                                      \
+      [OP_AND_VX_VY] = op_and_vx_vy_##name,                                    \
+      [OP_XOR_VX_VY] = op_xor_vx_vy_##name,                                    \
+      [OP_ADD_VX_VY] = op_add_vx_vy,                                           \
+      [OP_SUB_VX_VY] = op_sub_vx_vy,                                           \
+      [OP_SHR_VX] = op_shr_vx_##name,                                          \
+      [OP_SUBN_VX_VY] = op_subn_vx_vy,                                         \
+      [OP_SHL_VX] = op_shl_vx_##name,                                          \
+      [OP_SNE_VX_VY] = op_sne_vx_vy_##name,                                    \
+      [OP_LD_I_ADDR] = op_ld_i_addr,                                           \
+      [OP_JP_V0_ADDR] = op_jp_v0_addr_##name,                                  \
+      [OP_RND_VX_KK] = op_rnd_vx_kk,                                           \
+      [OP_DRW_VX_VY_NIBBLE] = op_drw_vx_vy_nibble_##name,                      \
+      [OP_SKP_VX] = op_skp_vx_##name,                                          \
+      [OP_SKNP_VX] = op_sknp_vx_##name,                                        \
+      [OP_LD_VX_DT] = op_ld_vx_dt,                                             \
+      [OP_LD_VX_K] = op_ld_vx_k,                                               \
+      [OP_LD_DT_VX] = op_ld_dt_vx,                                             \
+      [OP_LD_ST_VX] = op_ld_st_vx,                                             \
+      [OP_ADD_I_VX] = op_add_i_vx,                                             \
+      [OP_LD_F_VX] = op_ld_f_vx,                                               \
+      [OP_LD_B_VX] = op_ld_b_vx,                                               \
+      [OP_LD_I_VX] = op_ld_i_vx_##name,                                        \
+      [OP_LD_VX_I] = op_ld_vx_i_##name,                                        \
+      [OP_SCD_NIBBLE] = EXTENSION_OP(schip, op_scd_nibble, op_sys_addr),       \
+      [OP_SCR] = EXTENSION_OP(schip, op_scr, op_sys_addr),                     \
+      [OP_SCL] = EXTENSION_OP(schip, op_scl, op_sys_addr),                     \
+      [OP_EXIT] = EXTENSION_OP(schip, op_exit_interpreter, op_sys_addr),       \
+      [OP_LOW] = EXTENSION_OP(schip, op_low, op_sys_addr),                     \
+      [OP_HIGH] = EXTENSION_OP(schip, op_high, op_sys_addr),                   \
+      [OP_LD_HF_VX] = EXTENSION_OP(schip, op_ld_hf_vx, op_unknown),            \
+      [OP_LD_R_VX] = EXTENSION_OP(schip, op_ld_r_vx_##name, op_unknown),       \
+      [OP_LD_VX_R] = EXTENSION_OP(schip, op_ld_vx_r_##name, op_unknown),       \
+      [OP_SCU_NIBBLE] = EXTENSION_OP(xochip, op_scu_nibble, op_sys_addr),      \
+      [OP_LD_I_VX_VY] =                                                        \
+          EXTENSION_OP(xochip, op_ld_i_vx_vy, op_se_vx_vy_##name),             \
+      [OP_LD_VX_VY_I] =                                                        \
+          EXTENSION_OP(xochip, op_ld_vx_vy_i, op_se_vx_vy_##name),             \
+      [OP_LD_I_LONG] = EXTENSION_OP(xochip, op_ld_i_long, op_unknown),         \
+      [OP_PLANE] = EXTENSION_OP(xochip, op_plane_n, op_unknown),               \
+      [OP_AUDIO] = EXTENSION_OP(xochip, op_ld_audio_i, op_unknown),            \
+      [OP_PITCH] = EXTENSION_OP(xochip, op_ld_pitch_vx, op_unknown),           \
+  },
+
+const OpHandler op_handlers[QUIRKS_COUNT][OP_COUNT] = {
+    QUIRK_PROFILES(HANDLER_TABLE)};
+
+/**
+ * @brief Checks if an operation ends a straight-line run.
+ *
+ * The block cache and the JIT split code into blocks at the same
+ * operations, so both engines run the same blocks.
+ *
+ * Jumps, calls, returns and skips change the PC in ways that depend on
+ * state, FX0A may not advance the PC at all, DXYN is the natural frame
+ * boundary, and FX33/FX55 may overwrite code that follows them. The
+ * SUPER-CHIP and XO-CHIP instructions are SYS jumps, skips or unknown
+ * opcodes under profiles without them, and 00FD stops the instance. Under
+ * XO-CHIP F000 is 4 bytes long and a skip looks at the instruction after
+ * it when it runs.
+ *
+ * @param op The decoded operation.
+ * @return true if the block must end after this operation.
+ */
+bool op_ends_block(Op op) {
+  switch (op) {
+  case OP_UNKNOWN:
+  case OP_RET:
+  case OP_SYS_ADDR:
+  case OP_JP_ADDR:
+  case OP_CALL_ADDR:
+  case OP_SE_VX_BYTE:
+  case OP_SNE_VX_BYTE:
+  case OP_SE_VX_VY:
+  case OP_SNE_VX_VY:
+  case OP_JP_V0_ADDR:
+  case OP_DRW_VX_VY_NIBBLE:
+  case OP_SKP_VX:
+  case OP_SKNP_VX:
+  case OP_LD_VX_K:
+  case OP_LD_B_VX:
+  case OP_LD_I_VX:
+  case OP_SCD_NIBBLE:
+  case OP_SCR:
+  case OP_SCL:
+  case OP_EXIT:
+  case OP_LOW:
+  case OP_HIGH:
+  case OP_LD_HF_VX:
+  case OP_LD_R_VX:
+  case OP_LD_VX_R:
+  case OP_SCU_NIBBLE:
+  case OP_LD_I_VX_VY:
+  case OP_LD_VX_VY_I:
+  case OP_LD_I_LONG:
+  case OP_PLANE:
+  case OP_AUDIO:
+  case OP_PITCH:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Decodes an opcode into the operation that executes it.
+ *
+ * @param opcode The 16-bit opcode to decode.
+ * @return The decoded operation, OP_UNKNOWN for invalid opcodes.
+ */
+Op decode_opcode(uint16_t opcode) {
+  switch (opcode & 0xF000) {
+  case 0x0000:
+    if (opcode == 0x00E0)
+      return OP_CLS;
+    if (opcode == 0x00EE)
+      return OP_RET;
+    if ((opcode & 0xFFF0) == 0x00C0)
+      return OP_SCD_NIBBLE;
+    if ((opcode & 0xFFF0) == 0x00D0)
+      return OP_SCU_NIBBLE;
+    switch (opcode) {
+    case 0x00FB:
+      return OP_SCR;
+    case 0x00FC:
+      return OP_SCL;
+    case 0x00FD:
+      return OP_EXIT;
+    case 0x00FE:
+      return OP_LOW;
+    case 0x00FF:
+      return OP_HIGH;
+    default:
+      return OP_SYS_ADDR;
+    }
+  case 0x1000:
+    return OP_JP_ADDR;
+  case 0x2000:
+    return OP_CALL_ADDR;
+  case 0x3000:
+    return OP_SE_VX_BYTE;
+  case 0x4000:
+    return OP_SNE_VX_BYTE;
+  case 0x5000:
+    switch (opcode & 0x000F) {
+    case 0x2:
+      return OP_LD_I_VX_VY;
+    case 0x3:
+      return OP_LD_VX_VY_I;
+    default:
+      return OP_SE_VX_VY;
+    }
+  case 0x6000:
+    return OP_LD_VX_BYTE;
+  case 0x7000:
+    return OP_ADD_VX_BYTE;
+
+  case 0x8000:
+    switch (opcode & 0x000F) {
+    case 0x0:
+      return OP_LD_VX_VY;
+    case 0x1:
+      return OP_OR_VX_VY;
+    case 0x2:
+      return OP_AND_VX_VY;
+    case 0x3:
+      return OP_XOR_VX_VY;
+    case 0x4:
+      return OP_ADD_VX_VY;
+    case 0x5:
+      return OP_SUB_VX_VY;
+    case 0x6:
+      return OP_SHR_VX;
+    case 0x7:
+      return OP_SUBN_VX_VY;
+    case 0xE:
+      return OP_SHL_VX;
+    default:
+      return OP_UNKNOWN;
+    }
+
+  case 0x9000:
+    return OP_SNE_VX_VY;
+  case 0xA000:
+    return OP_LD_I_ADDR;
+  case 0xB000:
+    return OP_JP_V0_ADDR;
+  case 0xC000:
+    return OP_RND_VX_KK;
+  case 0xD000:
+    return OP_DRW_VX_VY_NIBBLE;
+
+  case 0xE000:
+    switch (opcode & 0x00FF) {
+    case 0x9E:
+      return OP_SKP_VX;
+    case 0xA1:
+      return OP_SKNP_VX;
+    default:
+      return OP_UNKNOWN;
+    }
+
+  case 0xF000:
+    if (opcode == 0xF000)
+      return OP_LD_I_LONG;
+    switch (opcode & 0x00FF) {
+    case 0x01:
+      return OP_PLANE;
+    case 0x02:
+      return opcode == 0xF002 ? OP_AUDIO : OP_UNKNOWN;
+    case 0x07:
+      return OP_LD_VX_DT;
+    case 0x0A:
+      return OP_LD_VX_K;
+    case 0x15:
+      return OP_LD_DT_VX;
+    case 0x18:
+      return OP_LD_ST_VX;
+    case 0x1E:
+      return OP_ADD_I_VX;
+    case 0x29:
+      return OP_LD_F_VX;
+    case 0x30:
+      return OP_LD_HF_VX;
+    case 0x33:
+      return OP_LD_B_VX;
+    case 0x3A:
+      return OP_PITCH;
+    case 0x55:
+      return OP_LD_I_VX;
+    case 0x65:
+      return OP_LD_VX_I;
+    case 0x75:
+      return OP_LD_R_VX;
+    case 0x85:
+      return OP_LD_VX_R;
+    default:
+      return OP_UNKNOWN;
+    }
+  }
+
+  return OP_UNKNOWN;
+}
+
+// Fills the decode table, run exactly once through pthread_once
+static void build_dispatch_table(void) {
+  for (uint32_t opcode = 0; opcode <= 0xFFFF; opcode++)
+    op_decode_table[opcode] = decode_opcode(opcode);
+}
+
+/**
+ * @brief Precomputes the decoded operation of all 65536 opcodes.
+ *
+ * The table is shared by every Chip8 instance and never changes once built,
+ * so instances created concurrently on different threads can all call this.
+ */
+void init_dispatch_table(void) {
+  pthread_once(&dispatch_table_once, build_dispatch_table);
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "chip8_types.h"
+
+// Decoded operations, one per handler in instructions.h
+typedef enum {
+  OP_UNKNOWN,
+  OP_CLS,
+  OP_RET,
+  OP_SYS_ADDR,
+  OP_JP_ADDR,
+  OP_CALL_ADDR,
+  OP_SE_VX_BYTE,
+  OP_SNE_VX_BYTE,
+  OP_SE_VX_VY,
+  OP_LD_VX_BYTE,
+  OP_ADD_VX_BYTE,
+  OP_LD_VX_VY,
+  OP_OR_VX_VY,
+  OP_AND_VX_VY,
+  OP_XOR_VX_VY,
+  OP_ADD_VX_VY,
+  OP_SUB_VX_VY,
+  OP_SHR_VX,
+  OP_SUBN_VX_VY,
+  OP_SHL_VX,
+  OP_SNE_VX_VY,
+  OP_LD_I_ADDR,
+  OP_JP_V0_ADDR,
+  OP_RND_VX_KK,
+  OP_DRW_VX_VY_NIBBLE,
+  OP_SKP_VX,
+  OP_SKNP_VX,
+  OP_LD_VX_DT,
+  OP_LD_VX_K,
+  OP_LD_DT_VX,
+  OP_LD_ST_VX,
+  OP_ADD_I_VX,
+  OP_LD_F_VX,
+  OP_LD_B_VX,
+  OP_LD_I_VX,
+  OP_LD_VX_I,
+  OP_SCD_NIBBLE,
+  OP_SCR,
+  OP_SCL,
+  OP_EXIT,
+  OP_LOW,
+  OP_HIGH,
+  OP_LD_HF_VX,
+  OP_LD_R_VX,
+  OP_LD_VX_R,
+  OP_SCU_NIBBLE,
+  OP_LD_I_VX_VY,
+  OP_LD_VX_VY_I,
+  OP_LD_I_LONG,
+  OP_PLANE,
+  OP_AUDIO,
+  OP_PITCH,
+  OP_COUNT
+} Op;
+
+// Uniform signature for every entry of the dispatch table
+typedef int (*OpHandler)(Chip8 *c8);
+
+// Maps every 16-bit opcode to its decoded operation
+extern uint8_t op_decode_table[0x10000];
+
+// Handler of every decoded operation, one table per quirk profile
+extern const OpHandler op_handlers[QUIRKS_COUNT][OP_COUNT];
+
+/// @brief Builds the opcode decode table, only the first call does any work
+void init_dispatch_table(void);
+
+/// @brief Checks if an operation ends a straight-line block of code
+/// @param op The decoded operation
+/// @return true if the block cache and the JIT end a block after it
+bool op_ends_block(Op op);
+
+/// @brief Decodes an opcode without using the table
+/// @param opcode The opcode to decode
+/// @return The decoded operation (OP_UNKNOWN if the opcode is invalid)
+Op decode_opcode(uint16_t opcode);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include "emulator.h"
+#include <math.h>
+
+void frame_exchange_init(FrameExchange *exchange) {
+  memset(exchange->slots, 0, sizeof(exchange->slots));
+  exchange->back = 0;
+  atomic_init(&exchange->middle, 1);
+  exchange->front = 2;
+}
+
+Frame *frame_exchange_back(FrameExchange *exchange) {
+  return &exchange->slots[exchange->back];
+}
+
+void frame_exchange_publish(FrameExchange *exchange) {
+  uint8_t old = atomic_exchange_explicit(
+      &exchange->middle, exchange->back | FRAME_FRESH, memory_order_acq_rel);
+  exchange->back = old & ~FRAME_FRESH;
+}
+
+bool frame_exchange_taken(FrameExchange *exchange) {
+  return !(atomic_load_explicit(&exchange->middle, memory_order_acquire) &
+           FRAME_FRESH);
+}
+
+const Frame *frame_exchange_acquire(FrameExchange *exchange) {
+  if (!(atomic_load_explicit(&exchange->middle, memory_order_relaxed) &
+        FRAME_FRESH))
+    return NULL;
+
+  uint8_t old = atomic_exchange_explicit(&exchange->middle, exchange->front,
+                                         memory_order_acq_rel);
+  exchange->front = old & ~FRAME_FRESH;
+  return &exchange->slots[exchange->front];
+}
+
+/**
+ * @brief Hands the display of the instance to the render thread.
+ *
+ * The frame carries the rows changed since the last frame the render thread
+ * took, so it uploads only those. A frame it skipped is never uploaded, so
+ * its rows are carried into the next frame until one is taken.
+ *
+ * @param emu The emulation.
+ */
+static void publish(Emulation *emu) {
+  Frame *frame = frame_exchange_back(&emu->frames);
+
+  if (frame_exchange_taken(&emu->frames))
+    emu->untaken = 0;
+  frame->dirty = take_dirty_rows(emu->c8) | emu->untaken;
+  emu->untaken = frame->dirty;
+
+  // Words a resolution does not use stay 0 in the slot, so only the used
+  // ones are copied unless the slot last held the other resolution. Only
+  // XO-CHIP draws to the planes after the first.
+  int words = frame->hires == emu->c8->hires ? display_words(emu->c8)
+                                             : DISPLAY_WORDS;
+  for (int p = 0; p < display_planes(emu->c8); p++)
+    memcpy(&frame->rows[p * DISPLAY_WORDS],
+           &emu->c8->buffer[p * DISPLAY_WORDS], words * 8);
+  frame->hires = emu->c8->hires;
+  frame->number = emu->scheduler.frame;
+  frame_exchange_publish(&emu->frames);
+}
+
+/**
+ * @brief Hands the sound of the instance to the audio thread.
+ *
+ * The sound is published as the clock reading of the timer tick that
+ * brings the sound timer to 0, so the audio thread can end the tone on the
+ * sample at which it runs out rather than at the end of a buffer. Emulated
+ * time has no clock reading in unbounded turbo, where the tone plays until
+ * the next call instead.
+ *
+ * Under XO-CHIP the audio pattern and pitch are published too, each word
+ * on its own, so a pattern changed mid-buffer may be heard half old for a
+ * few samples.
+ *
+ * @param emu The emulation.
+ */
+static void publish_sound(Emulation *emu) {
+  const Chip8 *c8 = emu->c8;
+  SoundState *sound = &emu->sound;
+  double until = 0;
+
+  if (c8->sound_timer > 0 && !c8->paused && !c8->rewinding)
+    until = c8->turbo && emu->turbo_speed == 0
+                ? INFINITY
+                : scheduler_tick_time(&emu->scheduler, c8->sound_timer);
+
+  if (quirk_profiles[c8->quirks].xochip) {
+    for (int w = 0; w < 2; w++) {
+      uint64_t bits = 0;
+      for (int i = 0; i < 8; i++)
+        bits = bits << 8 | c8->audio_pattern[w * 8 + i];
+      atomic_store_explicit(&sound->bits[w], bits, memory_order_relaxed);
+    }
+    atomic_store_explicit(&sound->pitch, c8->pitch, memory_order_relaxed);
+  }
+  atomic_store_explicit(&sound->pattern, quirk_profiles[c8->quirks].xochip,
+                        memory_order_relaxed);
+  atomic_store_explicit(&sound->until, until, memory_order_relaxed);
+}
+
+/**
+ * @brief Latches the host keys for the frame about to run and records them.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param ctx The Emulation.
+ */
+static void start_frame(Chip8 *c8, void *ctx) {
+  Emulation *emu = ctx;
+  uint16_t keys = atomic_load(&emu->controls.keys);
+
+  set_keypad_mask(c8, keys);
+  if (emu->movie != NULL)
+    movie_record(emu->movie, keys);
+}
+
+/**
+ * @brief Captures the frame that just ended and hands it to the render
+ * thread.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param ctx The Emulation.
+ */
+static void end_frame(Chip8 *c8, void *ctx) {
+  Emulation *emu = ctx;
+
+  if (emu->history != NULL)
+    rewind_capture(emu->history, c8);
+  if (emu->publish_frames)
+    publish(emu);
+}
+
+/**
+ * @brief Sleeps the calling thread.
+ *
+ * @param seconds The time to sleep.
+ */
+static void sleep_seconds(double seconds) {
+  struct timespec ts = {(time_t)seconds,
+                        (long)((seconds - (time_t)seconds) * 1e9)};
+  nanosleep(&ts, NULL);
+}
+
+/**
+ * @brief Runs the instance until the host or the instance stops it.
+ *
+ * The scheduler is run every EMULATION_SLEEP_SECONDS, so the instructions
+ * due are run in small slices and the keys are picked up between them.
+ * While recording, keys only change when a frame starts, so the movie
+ * holds exactly what the instance saw.
+ *
+ * @param arg The Emulation.
+ * @return NULL.
+ */
+static void *emulation_main(void *arg) {
+  Emulation *emu = arg;
+  Chip8 *c8 = emu->c8;
+  Controls *controls = &emu->controls;
+  Scheduler *scheduler = &emu->scheduler;
+  FrameHooks hooks = {start_frame, end_frame, emu};
+
+  scheduler_init(scheduler, emu->ips, scheduler_clock());
+  publish(emu);
+
+  while (c8->running && atomic_load(&controls->running)) {
+    double now = scheduler_clock(), sleep = EMULATION_SLEEP_SECONDS;
+
+    c8->paused = atomic_load(&controls->paused);
+    c8->turbo = atomic_load(&controls->turbo);
+    c8->rewinding = atomic_load(&controls->rewinding);
+    if (atomic_exchange(&controls->reset, false))
+      c8->reset = true;
+    if (emu->movie == NULL)
+      set_keypad_mask(c8, atomic_load(&controls->keys));
+
+    emu->publish_frames = true;
+    if (c8->rewinding && emu->history != NULL) {
+      // Restores timers and display too, one frame per 60 Hz of host time
+      if (rewind_step(emu->history, c8) == SUCCESS) {
+        scheduler_step_back(scheduler, now);
+        if (emu->movie != NULL)
+          movie_truncate(emu->movie, scheduler->frame);
+        publish(emu);
+      } else {
+        scheduler_skip(scheduler, now);
+      }
+      sleep = 1.0 / TIMER_HZ;
+    } else if (c8->paused) {
+      scheduler_skip(scheduler, now);
+    } else if (c8->turbo && emu->turbo_speed == 0) {
+      // Only the last of the frames run is handed over
+      emu->publish_frames = false;
+      scheduler_run_unbounded(scheduler, c8, TURBO_FRAME_SECONDS, &hooks);
+      publish(emu);
+      sleep = 0;
+    } else {
+      scheduler_set_speed(scheduler, c8->turbo ? emu->turbo_speed : 1, now);
+      scheduler_run(scheduler, c8, now, &hooks);
+    }
+
+    if (c8->reset) {
+      // Memory is not restored by a reset, so the recording could not be
+      // replayed from the ROM after one
+      if (emu->movie != NULL) {
+        log_info("Reset is disabled while recording.");
+        c8->reset = false;
+      } else {
+        reset(c8);
+        publish(emu);
+      }
+    }
+
+    // The audio thread gates the tone by this from its next buffer on
+    publish_sound(emu);
+
+    if (sleep > 0)
+      sleep_seconds(sleep);
+  }
+
+  // A recording holds whole frames only
+  if (emu->movie != NULL)
+    scheduler_finish_frame(scheduler, c8, &hooks);
+
+  atomic_store(&emu->sound.until, 0);
+  atomic_store(&controls->running, false);
+  return NULL;
+}
+
+int emulation_start(Emulation *emu, bool turbo) {
+  atomic_init(&emu->controls.keys, 0);
+  atomic_init(&emu->controls.running, true);
+  atomic_init(&emu->controls.paused, false);
+  atomic_init(&emu->controls.turbo, turbo);
+  atomic_init(&emu->controls.rewinding, false);
+  atomic_init(&emu->controls.reset, false);
+  frame_exchange_init(&emu->frames);
+  // The render thread starts from a blank texture
+  emu->untaken = 0;
+  mark_display_dirty(emu->c8);
+  atomic_init(&emu->sound.until, 0);
+  atomic_init(&emu->sound.pattern, false);
+  atomic_init(&emu->sound.bits[0], 0);
+  atomic_init(&emu->sound.bits[1], 0);
+  atomic_init(&emu->sound.pitch, DEFAULT_PITCH);
+
+  if (pthread_create(&emu->thread, NULL, emulation_main, emu) != 0) {
+    log_error("Failed to start the emulation thread.");
+    return ERR;
+  }
+  return SUCCESS;
+}
+
+bool emulation_running(Emulation *emu) {
+  return atomic_load(&emu->controls.running);
+}
+
+void emulation_stop(Emulation *emu) {
+  atomic_store(&emu->controls.running, false);
+  pthread_join(emu->thread, NULL);
+}
\ No newline at end of file
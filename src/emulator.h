@@ -0,0 +1,117 @@
+#ifndef EMULATOR_H
+#define EMULATOR_H
+
+#include "movie.h"
+#include "rewind.h"
+#include "scheduler.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Host time the emulation thread sleeps between two runs of the scheduler
+#define EMULATION_SLEEP_SECONDS 0.001
+// Host time spent emulating between two published frames in unbounded turbo
+#define TURBO_FRAME_SECONDS 0.015
+
+// A finished frame, as handed from the emulation to the render thread
+typedef struct {
+  uint64_t rows[DISPLAY_PLANES * DISPLAY_WORDS]; // As in Chip8.buffer
+  bool hires;      // The display is 128x64, as Chip8.hires
+  uint64_t dirty;  // Rows changed since the last frame the reader took
+  uint64_t number; // Emulated frames completed before it
+} Frame;
+
+/*
+ * Lock-free triple buffer: the writer fills its back slot and swaps it with
+ * the middle one, the reader swaps its front slot with the middle one when
+ * that holds a newer frame. Neither side ever waits, and the reader always
+ * gets the newest frame; frames it was too slow for are skipped.
+ */
+typedef struct {
+  Frame slots[3];
+  _Atomic uint8_t middle; // Index of the middle slot, FRAME_FRESH if unread
+  uint8_t back;           // Owned by the writer
+  uint8_t front;          // Owned by the reader
+} FrameExchange;
+
+#define FRAME_FRESH 0x80
+
+// Sound requested by the emulation thread, read by the audio thread
+typedef struct {
+  _Atomic double until;         // Clock reading at which the sound timer
+                                // runs out, 0 -> silent
+  atomic_bool pattern;          // Play the XO-CHIP pattern, not the tone
+  _Atomic uint64_t bits[2];     // Chip8.audio_pattern, first byte the MSB
+  _Atomic uint8_t pitch;        // Chip8.pitch
+} SoundState;
+
+// Requests from the host, written by the render thread and read by the
+// emulation thread
+typedef struct {
+  _Atomic uint16_t keys; // Bit k is set if key k is held
+  atomic_bool running;   // Cleared by either side to stop both
+  atomic_bool paused;
+  atomic_bool turbo;
+  atomic_bool rewinding;
+  atomic_bool reset; // Set by the host, cleared once done
+} Controls;
+
+// A Chip8 instance running on a thread of its own
+typedef struct {
+  Chip8 *c8;
+  uint32_t ips;
+  double turbo_speed;    // Multiple of ips run in turbo mode, 0 -> unbounded
+  RewindBuffer *history; // Captures every frame, or NULL
+  Movie *movie;          // Records every frame, or NULL
+  Controls controls;
+  FrameExchange frames;
+  SoundState sound;
+  pthread_t thread;
+
+  // Owned by the emulation thread
+  Scheduler scheduler;
+  bool publish_frames; // Hand every finished frame to the render thread
+  uint64_t untaken;    // Dirty rows of the last published frame, if unread
+} Emulation;
+
+/// @brief Empty a triple buffer
+/// @param exchange The triple buffer
+void frame_exchange_init(FrameExchange *exchange);
+
+/// @brief Get the slot the writer fills next
+/// @param exchange The triple buffer
+/// @return The back slot
+Frame *frame_exchange_back(FrameExchange *exchange);
+
+/// @brief Hand the back slot to the reader
+/// @param exchange The triple buffer
+void frame_exchange_publish(FrameExchange *exchange);
+
+/// @brief Check if the reader took the last published frame
+/// Only meaningful on the writer's side, the answer can only turn true.
+/// @param exchange The triple buffer
+/// @return true if no published frame is waiting to be read
+bool frame_exchange_taken(FrameExchange *exchange);
+
+/// @brief Take the newest frame published since the last call
+/// @param exchange The triple buffer
+/// @return The frame, valid until the next call, or NULL if none is new
+const Frame *frame_exchange_acquire(FrameExchange *exchange);
+
+/// @brief Start running a Chip8 instance on its own thread
+/// The instance must not be used by the caller until emulation_stop.
+/// @param emu The emulation, c8, ips, turbo_speed, history and movie set
+/// @param turbo Start in turbo mode
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int emulation_start(Emulation *emu, bool turbo);
+
+/// @brief Check if the emulation thread is still running
+/// @param emu The emulation
+/// @return false once the host or the instance stopped it
+bool emulation_running(Emulation *emu);
+
+/// @brief Stop the emulation thread and wait for it to finish
+/// A recording is completed up to the end of the frame being run.
+/// @param emu The emulation
+void emulation_stop(Emulation *emu);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "headless.h"
+
+/**
+ * @brief Runs a Chip8 instance as fast as possible.
+ *
+ * Instructions are executed in the same emulated frames as in a window,
+ * each followed by a timer tick, so ROMs see the same timer behaviour. The
+ * run stops at whichever limit is reached first; a limit of 0 is ignored.
+ *
+ * @param c8 The Chip8 instance to run.
+ * @param ips The emulated instructions per second.
+ * @param max_cycles The maximum number of instructions to execute.
+ * @param max_frames The maximum number of frames to execute.
+ * @param history The rewind history to capture every frame in, or NULL.
+ * @param stats Filled in with the statistics of the run.
+ */
+void run_headless(Chip8 *c8, uint32_t ips, uint64_t max_cycles,
+                  uint64_t max_frames, RewindBuffer *history,
+                  RunStats *stats) {
+  uint64_t cycles = 0, frames = 0;
+  double start = scheduler_clock();
+
+  while (c8->running) {
+    if (max_frames > 0 && frames >= max_frames)
+      break;
+    if (max_cycles > 0 && cycles >= max_cycles)
+      break;
+
+    int batch = frame_cycles(ips, frames);
+    if (max_cycles > 0 && max_cycles - cycles < (uint64_t)batch)
+      batch = max_cycles - cycles;
+
+    run_frame(c8, batch);
+    if (history != NULL)
+      rewind_capture(history, c8);
+    cycles += batch;
+    frames++;
+  }
+
+  stats->cycles = cycles;
+  stats->frames = frames;
+  stats->seconds = scheduler_clock() - start;
+}
+
+/**
+ * @brief Replays a recorded session as fast as possible.
+ *
+ * Each frame holds the recorded keys while it runs, exactly as the window
+ * did. The framebuffer at the end is compared with the recorded one.
+ *
+ * @param c8 The Chip8 instance to run.
+ * @param movie The recording to replay.
+ * @param stats Filled in with the statistics of the run.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int replay_movie(Chip8 *c8, const Movie *movie, RunStats *stats) {
+  double start = scheduler_clock();
+
+  memset(stats, 0, sizeof(RunStats));
+  if (state_hash(c8) != movie->start_hash) {
+    log_error("Movie was recorded from a different ROM or save state.");
+    return ERR;
+  }
+
+  for (uint32_t frame = 0; frame < movie->frame_count; frame++) {
+    set_keypad_mask(c8, movie->frames[frame]);
+    run_frame(c8, frame_cycles(movie->ips, frame));
+    stats->cycles += frame_cycles(movie->ips, frame);
+  }
+
+  stats->frames = movie->frame_count;
+  stats->seconds = scheduler_clock() - start;
+
+  if (framebuffer_hash(c8) != movie->end_hash) {
+    log_error("Replay ended with a different display than the recording.");
+    return ERR;
+  }
+  return SUCCESS;
+}
+
+void print_run_stats(const RunStats *stats) {
+  double seconds = stats->seconds > 0 ? stats->seconds : 1e-9;
+
+  // Messages logged during the run come first
+  log_flush();
+
+  printf("Cycles: %llu\n", (unsigned long long)stats->cycles);
+  printf("Frames: %llu\n", (unsigned long long)stats->frames);
+  printf("Time: %.6f s\n", stats->seconds);
+  printf("IPS: %.0f\n", stats->cycles / seconds);
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "movie.h"
+#include "rewind.h"
+
+// Statistics gathered over a headless run
+typedef struct {
+  uint64_t cycles;
+  uint64_t frames;
+  double seconds;
+} RunStats;
+
+/// @brief Runs a Chip8 instance without a display, audio or frame cap
+/// @param c8 The Chip8 instance to run
+/// @param ips The emulated instructions per second, which sets how many run
+///        between two timer ticks
+/// @param max_cycles Stop after this many instructions (0 -> no limit)
+/// @param max_frames Stop after this many frames (0 -> no limit)
+/// @param history Captures every frame if not NULL
+/// @param stats Filled in with the work done and the wall time it took
+void run_headless(Chip8 *c8, uint32_t ips, uint64_t max_cycles,
+                  uint64_t max_frames, RewindBuffer *history,
+                  RunStats *stats);
+
+/// @brief Replays a recorded session without a display or frame cap
+/// The instance must be seeded with the movie's seed and otherwise be in the
+/// state the recording started from.
+/// @param c8 The Chip8 instance to run
+/// @param movie The recording to replay
+/// @param stats Filled in with the work done and the wall time it took
+/// @return Status of the operation (1 -> the replay did not start or end in
+///         the recorded state)
+int replay_movie(Chip8 *c8, const Movie *movie, RunStats *stats);
+
+/// @brief Prints the statistics of a headless run
+/// @param stats The statistics to print
+void print_run_stats(const RunStats *stats);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "input_script.h"
+
+/**
+ * @brief Parse an input script file.
+ *
+ * @param script The script to fill in.
+ * @param filename The file to read.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int load_input_script(InputScript *script, const char *filename) {
+  FILE *fp = NULL;
+  char line[256];
+  size_t capacity = 0;
+  uint32_t last_frame = 0;
+  int line_number = 0;
+
+  script->events = NULL;
+  script->count = 0;
+  script->next = 0;
+  script->keys = 0;
+
+  fp = fopen(filename, "r");
+  if (fp == NULL) {
+    log_error("Failed to open input script: %s", filename);
+    return ERR;
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    unsigned long frame;
+    unsigned int keys;
+    char *start = line + strspn(line, " \t");
+
+    line_number++;
+    if (*start == '#' || *start == '\n' || *start == '\0')
+      continue;
+
+    if (sscanf(start, "%lu %x", &frame, &keys) != 2 || keys > 0xFFFF ||
+        frame < last_frame) {
+      log_error("Invalid input script line %s:%d", filename, line_number);
+      fclose(fp);
+      free_input_script(script);
+      return ERR;
+    }
+
+    if (script->count == capacity) {
+      capacity = capacity ? capacity * 2 : 16;
+      InputEvent *events = realloc(script->events, capacity * sizeof(*events));
+      if (events == NULL) {
+        log_error("Error: Failed to allocate memory for input script.");
+        fclose(fp);
+        free_input_script(script);
+        return ERR;
+      }
+      script->events = events;
+    }
+
+    script->events[script->count].frame = frame;
+    script->events[script->count].keys = keys;
+    script->count++;
+    last_frame = frame;
+  }
+
+  fclose(fp);
+  return SUCCESS;
+}
+
+void free_input_script(InputScript *script) {
+  free(script->events);
+  script->events = NULL;
+  script->count = 0;
+  script->next = 0;
+  script->keys = 0;
+}
+
+/**
+ * @brief Set the keypad to the keys held during a frame.
+ *
+ * The keypad is written every frame, like a frontend polling the keyboard
+ * does, so a key consumed by FX0A is seen again while it is still held.
+ *
+ * @param script The script to apply.
+ * @param c8 The Chip8 instance whose keypad is updated.
+ * @param frame The frame about to be executed.
+ */
+void apply_input_script(InputScript *script, Chip8 *c8, uint32_t frame) {
+  while (script->next < script->count &&
+         script->events[script->next].frame <= frame) {
+    script->keys = script->events[script->next].keys;
+    script->next++;
+  }
+  set_keypad_mask(c8, script->keys);
+}
\ No newline at end of file
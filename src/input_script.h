@@ -0,0 +1,38 @@
+#ifndef INPUT_SCRIPT_H
+#define INPUT_SCRIPT_H
+
+#include "chip8.h"
+
+// From `frame` on, the keys in the `keys` mask are held down
+typedef struct {
+  uint32_t frame;
+  uint16_t keys;
+} InputEvent;
+
+// Scripted keypad input, events sorted by frame
+typedef struct {
+  InputEvent *events;
+  size_t count;
+  size_t next;   // Index of the next event to apply
+  uint16_t keys; // Keys held as of the last applied event
+} InputScript;
+
+/// @brief Parse an input script file
+/// Each non-empty line that is not a comment (#) holds a frame number and a
+/// hexadecimal key mask, e.g. "120 0010" holds key 4 down from frame 120.
+/// @param script The script to fill in
+/// @param filename The file to read
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int load_input_script(InputScript *script, const char *filename);
+
+/// @brief Release the events of an input script
+/// @param script The script to free
+void free_input_script(InputScript *script);
+
+/// @brief Set the keypad to the keys held during a frame
+/// @param script The script, events are consumed in order
+/// @param c8 The Chip8 instance whose keypad is updated
+/// @param frame The frame about to be executed
+void apply_input_script(InputScript *script, Chip8 *c8, uint32_t frame);
+
+#endif
\ No newline at end of file
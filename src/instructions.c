@@ -1,13 +1,145 @@
 #include "instructions.h"
+#include "chip8.h"
 #include "logger.h"
 
-// 0x00E0 -> CLS: Clear the screen
+/*
+ * Handlers that behave differently under some quirk profiles are written
+ * once as templates taking the quirks they depend on, and compiled for
+ * every profile at the end of this file with those quirks as constants.
+ * Each profile's handlers are then as plain as if they were written for
+ * it alone, with no quirk checks left in them.
+ */
+#define SPECIALIZED static inline __attribute__((always_inline))
+
+// Checks if plane p is selected for drawing, always only the first one
+// outside XO-CHIP
+static inline bool plane_selected(const Chip8 *c8, int p) {
+  return c8->planes & (1 << p);
+}
+
+// 0x00E0 -> CLS: Clear the selected planes of the screen
 void cls(Chip8 *c8) {
-  memset(c8->buffer, 0, sizeof(c8->buffer));
+  int words = display_words(c8);
+
+  if (c8->planes == (1 << display_planes(c8)) - 1) {
+    // Every plane that can hold pixels is cleared
+    memset(c8->buffer, 0, sizeof(c8->buffer));
+    c8->display_zobrist = c8->hires ? ZOBRIST_HIRES : 0;
+  } else {
+    for (int p = 0; p < DISPLAY_PLANES; p++) {
+      if (!plane_selected(c8, p))
+        continue;
+      for (int i = 0; i < words; i++)
+        write_row(c8, p * DISPLAY_WORDS + i, 0);
+    }
+  }
+  c8->dirty_rows = ~0ull;
   c8->draw = true;
   c8->pc += 0x2;
 }
 
+// Words per row times N rows, whole rows move as a block of words
+static inline int scroll_words(const Chip8 *c8) {
+  int words = display_words(c8);
+  return words / (c8->hires ? HIRES_HEIGHT : SCREEN_HEIGHT) *
+         (c8->opcode & 0x000F);
+}
+
+// 0x00CN -> SCD: Scroll the display down N rows (SUPER-CHIP)
+void scd_nibble(Chip8 *c8) {
+  int words = display_words(c8);
+  int shift = scroll_words(c8);
+
+  for (int p = 0; p < DISPLAY_PLANES; p++) {
+    if (!plane_selected(c8, p))
+      continue;
+    uint64_t *plane = &c8->buffer[p * DISPLAY_WORDS];
+    for (int i = words - 1; i >= 0; i--)
+      write_row(c8, p * DISPLAY_WORDS + i, i >= shift ? plane[i - shift] : 0);
+  }
+  c8->dirty_rows = ~0ull;
+  c8->draw = true;
+  c8->pc += 0x2;
+}
+
+// 0x00DN -> SCU: Scroll the display up N rows (XO-CHIP)
+void scu_nibble(Chip8 *c8) {
+  int words = display_words(c8);
+  int shift = scroll_words(c8);
+
+  for (int p = 0; p < DISPLAY_PLANES; p++) {
+    if (!plane_selected(c8, p))
+      continue;
+    uint64_t *plane = &c8->buffer[p * DISPLAY_WORDS];
+    for (int i = 0; i < words; i++)
+      write_row(c8, p * DISPLAY_WORDS + i,
+                i + shift < words ? plane[i + shift] : 0);
+  }
+  c8->dirty_rows = ~0ull;
+  c8->draw = true;
+  c8->pc += 0x2;
+}
+
+// 0x00FB -> SCR: Scroll the display right 4 pixels (SUPER-CHIP)
+void scr(Chip8 *c8) {
+  for (int p = 0; p < DISPLAY_PLANES; p++) {
+    if (!plane_selected(c8, p))
+      continue;
+    int base = p * DISPLAY_WORDS;
+    uint64_t *plane = &c8->buffer[base];
+    if (c8->hires) {
+      // Carry the low nibble of the left half into the right half
+      for (int i = 0; i < DISPLAY_WORDS; i += 2) {
+        write_row(c8, base + i + 1, plane[i] << 60 | plane[i + 1] >> 4);
+        write_row(c8, base + i, plane[i] >> 4);
+      }
+    } else {
+      for (int i = 0; i < SCREEN_HEIGHT; i++)
+        write_row(c8, base + i, plane[i] >> 4);
+    }
+  }
+  c8->dirty_rows = ~0ull;
+  c8->draw = true;
+  c8->pc += 0x2;
+}
+
+// 0x00FC -> SCL: Scroll the display left 4 pixels (SUPER-CHIP)
+void scl(Chip8 *c8) {
+  for (int p = 0; p < DISPLAY_PLANES; p++) {
+    if (!plane_selected(c8, p))
+      continue;
+    int base = p * DISPLAY_WORDS;
+    uint64_t *plane = &c8->buffer[base];
+    if (c8->hires) {
+      for (int i = 0; i < DISPLAY_WORDS; i += 2) {
+        write_row(c8, base + i, plane[i] << 4 | plane[i + 1] >> 60);
+        write_row(c8, base + i + 1, plane[i + 1] << 4);
+      }
+    } else {
+      for (int i = 0; i < SCREEN_HEIGHT; i++)
+        write_row(c8, base + i, plane[i] << 4);
+    }
+  }
+  c8->dirty_rows = ~0ull;
+  c8->draw = true;
+  c8->pc += 0x2;
+}
+
+// 0x00FD -> EXIT: Stop the interpreter (SUPER-CHIP)
+void exit_interpreter(Chip8 *c8) { c8->running = false; }
+
+// 0x00FE -> LOW: Switch to the 64x32 display (SUPER-CHIP)
+void low(Chip8 *c8) {
+  set_resolution(c8, false);
+  c8->pc += 0x2;
+}
+
+// 0x00FF -> HIGH: Switch to the 128x64 display (SUPER-CHIP)
+void high(Chip8 *c8) {
+  set_resolution(c8, true);
+  c8->pc += 0x2;
+}
+
 // 0x00EE -> RET: Return from a subroutine
 int ret(Chip8 *c8) {
   if (c8->sp <= 0) {
@@ -41,36 +173,82 @@ int call_addr(Chip8 *c8) {
 // 0x1NNN -> JMP: Jump to address
 void jmp_addr(Chip8 *c8) { c8->pc = c8->opcode & 0x0FFF; }
 
+// How far a skip moves the PC past the next instruction, all 4 bytes of
+// F000 NNNN under XO-CHIP
+SPECIALIZED uint16_t skip_size(const Chip8 *c8, bool xochip) {
+  if (xochip && read_memory(c8, c8->pc + 2) == 0xF0 &&
+      read_memory(c8, c8->pc + 3) == 0x00)
+    return 0x4;
+  return 0x2;
+}
+
 // 0x3XKK -> SE: Skip next instruction if Vx == kk
-void se_vx_byte(Chip8 *c8) {
+SPECIALIZED void se_vx_byte(Chip8 *c8, bool xochip) {
   uint8_t x, kk;
 
   x = (c8->opcode & 0x0F00) >> 8;
   kk = (c8->opcode & 0x00FF);
   if (c8->registers[x] == kk)
-    c8->pc += 0x2;
+    c8->pc += skip_size(c8, xochip);
   c8->pc += 0x2;
 }
 
 // 0x4XKK -> SNE: Skip next instruction if Vx != kk
-void sne_vx_byte(Chip8 *c8) {
+SPECIALIZED void sne_vx_byte(Chip8 *c8, bool xochip) {
   uint8_t x, kk;
 
   x = (c8->opcode & 0x0F00) >> 8;
   kk = (c8->opcode & 0x00FF);
   if (c8->registers[x] != kk)
-    c8->pc += 0x2;
+    c8->pc += skip_size(c8, xochip);
   c8->pc += 0x2;
 }
 
 // 0x5XY0 -> SE: Skip next instruction if Vx == Vy
-void se_vx_vy(Chip8 *c8) {
+SPECIALIZED void se_vx_vy(Chip8 *c8, bool xochip) {
   uint8_t x, y;
 
   x = (c8->opcode & 0x0F00) >> 8;
   y = (c8->opcode & 0x00F0) >> 4;
   if (c8->registers[x] == c8->registers[y])
-    c8->pc += 0x2;
+    c8->pc += skip_size(c8, xochip);
+  c8->pc += 0x2;
+}
+
+// First and last register of 5XY2 and 5XY3, and the direction between them
+static inline void register_range(const Chip8 *c8, int *x, int *y,
+                                  int *step) {
+  *x = (c8->opcode & 0x0F00) >> 8;
+  *y = (c8->opcode & 0x00F0) >> 4;
+  *step = *x <= *y ? 1 : -1;
+}
+
+// 0x5XY2 -> LD: Store registers Vx to Vy in memory, in reverse order if x
+// is greater than y, leaving I unchanged (XO-CHIP)
+void ld_i_vx_vy(Chip8 *c8) {
+  int x, y, step;
+
+  register_range(c8, &x, &y, &step);
+  for (int i = 0, r = x;; i++, r += step) {
+    write_memory(c8, c8->IRegister + i, c8->registers[r]);
+    if (r == y)
+      break;
+  }
+  memory_written(c8, c8->IRegister, abs(y - x) + 1);
+  c8->pc += 0x2;
+}
+
+// 0x5XY3 -> LD: Load registers Vx to Vy from memory, in reverse order if x
+// is greater than y, leaving I unchanged (XO-CHIP)
+void ld_vx_vy_i(Chip8 *c8) {
+  int x, y, step;
+
+  register_range(c8, &x, &y, &step);
+  for (int i = 0, r = x;; i++, r += step) {
+    c8->registers[r] = read_memory(c8, c8->IRegister + i);
+    if (r == y)
+      break;
+  }
   c8->pc += 0x2;
 }
 
@@ -105,33 +283,38 @@ void ld_vx_vy(Chip8 *c8) {
 }
 
 // 0x8XY1 -> OR: Set Vx = Vx | Vy
-void or_vx_vy(Chip8 *c8) {
+SPECIALIZED void or_vx_vy(Chip8 *c8, uint8_t vf_reset) {
   uint8_t x, y;
 
   x = (c8->opcode & 0x0F00) >> 8;
   y = (c8->opcode & 0x00F0) >> 4;
   c8->registers[x] |= c8->registers[y];
-  c8->registers[0xF] = 0;
+  if (vf_reset & (1 << 0x1))
+    c8->registers[0xF] = 0;
   c8->pc += 0x2;
 }
 
 // 0x8XY2 -> AND: Set Vx = Vx & Vy
-void and_vx_vy(Chip8 *c8) {
+SPECIALIZED void and_vx_vy(Chip8 *c8, uint8_t vf_reset) {
   uint8_t x, y;
 
   x = (c8->opcode & 0x0F00) >> 8;
   y = (c8->opcode & 0x00F0) >> 4;
   c8->registers[x] &= c8->registers[y];
+  if (vf_reset & (1 << 0x2))
+    c8->registers[0xF] = 0;
   c8->pc += 0x2;
 }
 
 // 0x8XY3 -> XOR: Set Vx = Vx ^ Vy
-void xor_vx_vy(Chip8 *c8) {
+SPECIALIZED void xor_vx_vy(Chip8 *c8, uint8_t vf_reset) {
   uint8_t x, y;
 
   x = (c8->opcode & 0x0F00) >> 8;
   y = (c8->opcode & 0x00F0) >> 4;
   c8->registers[x] ^= c8->registers[y];
+  if (vf_reset & (1 << 0x3))
+    c8->registers[0xF] = 0;
   c8->pc += 0x2;
 }
 
@@ -167,13 +350,15 @@ void sub_vx_vy(Chip8 *c8) {
   c8->pc += 0x2;
 }
 
-// 0x8XY6 -> SHR: Set Vx = Vx >> 1
-void shr_vx(Chip8 *c8) {
+// 0x8XY6 -> SHR: Set Vx = Vx >> 1, or Vy >> 1 if shift_vy
+SPECIALIZED void shr_vx(Chip8 *c8, bool shift_vy) {
   uint8_t x, y;
 
   x = (c8->opcode & 0x0F00) >> 8;
   y = (c8->opcode & 0x00F0) >> 4;
 
+  if (shift_vy)
+    c8->registers[x] = c8->registers[y];
   c8->registers[0xF] = c8->registers[x] & 0x1;
   c8->registers[x] >>= 1;
   c8->pc += 0x2;
@@ -195,27 +380,29 @@ void subn_vx_vy(Chip8 *c8) {
   c8->pc += 0x2;
 }
 
-// 0x8XYE -> SHL: Set Vx = Vx << 1
-void shl_vx(Chip8 *c8) {
+// 0x8XYE -> SHL: Set Vx = Vx << 1, or Vy << 1 if shift_vy
+SPECIALIZED void shl_vx(Chip8 *c8, bool shift_vy) {
   uint8_t x, y;
 
   x = (c8->opcode & 0x0F00) >> 8;
   y = (c8->opcode & 0x00F0) >> 4;
 
+  if (shift_vy)
+    c8->registers[x] = c8->registers[y];
   c8->registers[0xF] = (c8->registers[x] & 0x80) >> 7;
   c8->registers[x] <<= 1;
   c8->pc += 0x2;
 }
 
 // 0x9XY0 -> SNE: Skip next instruction if Vx != Vy
-void sne_vx_vy(Chip8 *c8) {
+SPECIALIZED void sne_vx_vy(Chip8 *c8, bool xochip) {
   uint8_t x, y;
 
   x = (c8->opcode & 0x0F00) >> 8;
   y = (c8->opcode & 0x00F0) >> 4;
 
   if (c8->registers[x] != c8->registers[y])
-    c8->pc += 0x2;
+    c8->pc += skip_size(c8, xochip);
   c8->pc += 0x2;
 }
 
@@ -228,12 +415,14 @@ void ld_i_addr(Chip8 *c8) {
   c8->pc += 0x2;
 }
 
-// 0xBNNN -> JP: Jump to V0 + nnn
-void jp_v0_addr(Chip8 *c8) {
+// 0xBNNN -> JP: Jump to V0 + nnn, or to Vx + xnn if jump_vx
+SPECIALIZED void jp_v0_addr(Chip8 *c8, bool jump_vx) {
   uint16_t nnn;
+  uint8_t x;
 
   nnn = c8->opcode & 0x0FFF;
-  c8->pc = nnn + c8->registers[0];
+  x = jump_vx ? (c8->opcode & 0x0F00) >> 8 : 0;
+  c8->pc = nnn + c8->registers[x];
 }
 
 // 0xCXKK -> RND: Set Vx = random byte AND kk
@@ -242,35 +431,123 @@ void rnd_vx_kk(Chip8 *c8) {
 
   x = (c8->opcode & 0x0F00) >> 8;
   kk = (c8->opcode & 0x00FF);
-  c8->registers[x] = (rand() & 0xFF) & kk;
+  c8->registers[x] = next_random(c8) & kk;
   c8->pc += 0x2;
 }
 
-// 0xDXYN -> DRW: Draw a sprite at (Vx, Vy)
-void drw_vx_vy_nibble(Chip8 *c8) {
-  uint8_t x, y, height, sprite, x_pos, y_pos;
+// 0xDXYN -> DRW: Draw a sprite at (Vx, Vy) on the 128x64 display, 16x16
+// pixels from two bytes per row if N is 0. Under XO-CHIP each selected
+// plane gets its own sprite, one after the other in memory.
+SPECIALIZED void drw_hires(Chip8 *c8, bool clip, bool xochip) {
+  uint8_t x, y, height, width, x_pos, y_pos;
+  unsigned __int128 row, line;
+  uint16_t sprite = c8->IRegister;
 
   x = (c8->opcode & 0x0F00) >> 8;
   y = (c8->opcode & 0x00F0) >> 4;
   height = (c8->opcode & 0x000F);
+  width = height == 0 ? 16 : 8;
+  if (height == 0)
+    height = 16;
+  x_pos = c8->registers[x] % HIRES_WIDTH;
+  y_pos = c8->registers[y] % HIRES_HEIGHT;
   c8->registers[0xF] = 0;
 
-  for (int i = 0; i < height; i++) {
-    sprite = c8->memory[c8->IRegister + i];
-    for (int j = 0; j < 8; j++) {
-      if (sprite & (0x80 >> j)) {
-        x_pos = (c8->registers[x] + j) % 64;
-        y_pos = (c8->registers[y] + i) % 32;
+  for (int p = 0; p < (xochip ? DISPLAY_PLANES : 1); p++) {
+    if (xochip && !plane_selected(c8, p))
+      continue;
+    uint64_t *plane = &c8->buffer[p * DISPLAY_WORDS];
+
+    for (int i = 0; i < height; i++) {
+      int line_y = y_pos + i;
+      if (clip && line_y >= HIRES_HEIGHT)
+        break;
+      line_y %= HIRES_HEIGHT;
+
+      // The whole 128-pixel row is a single integer, so the sprite moves to
+      // column x_pos with one shift, or one rotate when it wraps around
+      uint16_t bits = sprite + i * (width / 8);
+      row = width == 16 ? (unsigned __int128)(read_memory(c8, bits) << 8 |
+                                              read_memory(c8, bits + 1))
+                              << 112
+                        : (unsigned __int128)read_memory(c8, bits) << 120;
+      if (clip)
+        row >>= x_pos;
+      else if (x_pos != 0)
+        row = (row >> x_pos) | (row << (HIRES_WIDTH - x_pos));
+      line = (unsigned __int128)plane[2 * line_y] << 64 | plane[2 * line_y + 1];
+      c8->dirty_rows |= 1ull << line_y;
+
+      // Collision
+      if (line & row)
+        c8->registers[0xF] = 1;
+
+      line ^= row;
+      write_row(c8, p * DISPLAY_WORDS + 2 * line_y, (uint64_t)(line >> 64));
+      write_row(c8, p * DISPLAY_WORDS + 2 * line_y + 1, (uint64_t)line);
+    }
+    sprite += height * (width / 8);
+  }
 
-        // Collision
-        if (c8->buffer[x_pos + (y_pos * 64)] == 1)
-          c8->registers[0xF] = 1;
-        else
-          c8->registers[0xF] = 0;
+  c8->draw = true;
+  c8->pc += 0x2;
+}
 
-        c8->buffer[x_pos + (y_pos * 64)] ^= 1;
-      }
+// 0xDXYN -> DRW: Draw a sprite at (Vx, Vy), under XO-CHIP 16x16 pixels if
+// N is 0 and once for every selected plane
+SPECIALIZED void drw_vx_vy_nibble(Chip8 *c8, bool clip, bool xochip) {
+  uint8_t x, y, height, width, x_pos, y_pos;
+  uint64_t row, line;
+  uint16_t sprite = c8->IRegister;
+
+  if (c8->hires) {
+    drw_hires(c8, clip, xochip);
+    return;
+  }
+
+  x = (c8->opcode & 0x0F00) >> 8;
+  y = (c8->opcode & 0x00F0) >> 4;
+  height = (c8->opcode & 0x000F);
+  width = xochip && height == 0 ? 16 : 8;
+  if (xochip && height == 0)
+    height = 16;
+  x_pos = c8->registers[x] % SCREEN_WIDTH;
+  y_pos = c8->registers[y] % SCREEN_HEIGHT;
+  c8->registers[0xF] = 0;
+
+  for (int p = 0; p < (xochip ? DISPLAY_PLANES : 1); p++) {
+    if (xochip && !plane_selected(c8, p))
+      continue;
+    uint64_t *plane = &c8->buffer[p * DISPLAY_WORDS];
+
+    for (int i = 0; i < height; i++) {
+      int line_y = y_pos + i;
+      if (clip && line_y >= SCREEN_HEIGHT)
+        break;
+      line_y %= SCREEN_HEIGHT;
+
+      // Move the sprite row to column x_pos, clipped at or wrapped around
+      // the right edge
+      uint16_t bits = sprite + i * (width / 8);
+      row = width == 16 ? (uint64_t)(read_memory(c8, bits) << 8 |
+                                     read_memory(c8, bits + 1))
+                              << (SCREEN_WIDTH - 16)
+                        : (uint64_t)read_memory(c8, bits) << (SCREEN_WIDTH - 8);
+      if (clip)
+        row >>= x_pos;
+      else
+        row =
+            (row >> x_pos) | (row << ((SCREEN_WIDTH - x_pos) % SCREEN_WIDTH));
+      line = plane[line_y];
+      c8->dirty_rows |= 1ull << line_y;
+
+      // Collision
+      if (line & row)
+        c8->registers[0xF] = 1;
+
+      write_row(c8, p * DISPLAY_WORDS + line_y, line ^ row);
     }
+    sprite += height * (width / 8);
   }
 
   c8->draw = true;
@@ -278,23 +555,23 @@ void drw_vx_vy_nibble(Chip8 *c8) {
 }
 
 // 0xEX9E SKP: Skip next instruction if key with the value of Vx is pressed
-void skp_vx(Chip8 *c8) {
+SPECIALIZED void skp_vx(Chip8 *c8, bool xochip) {
   uint8_t x;
 
   x = (c8->opcode & 0x0F00) >> 8;
   if (c8->keypad[c8->registers[x]])
-    c8->pc += 0x2;
+    c8->pc += skip_size(c8, xochip);
   c8->pc += 0x2;
 }
 
 // 0xEXA1 -> SKNP: Skip next instruction if key with the value of Vx is not
 // pressed
-void sknp_vx(Chip8 *c8) {
+SPECIALIZED void sknp_vx(Chip8 *c8, bool xochip) {
   uint8_t x;
 
   x = (c8->opcode & 0x0F00) >> 8;
   if (!c8->keypad[c8->registers[x]])
-    c8->pc += 0x2;
+    c8->pc += skip_size(c8, xochip);
   c8->pc += 0x2;
 }
 
@@ -354,37 +631,141 @@ void ld_f_vx(Chip8 *c8) {
   c8->pc += 0x2;
 }
 
+// 0xFX30 -> LD: Set I = location of large sprite for digit Vx (SUPER-CHIP)
+void ld_hf_vx(Chip8 *c8) {
+  uint8_t x;
+
+  x = (c8->opcode & 0x0F00) >> 8;
+  c8->IRegister = LARGE_FONT_MEM + c8->registers[x] * 10;
+  c8->pc += 0x2;
+}
+
+// 0xF000 NNNN -> LD: Set I = NNNN, the word after the instruction
+// (XO-CHIP)
+void ld_i_long(Chip8 *c8) {
+  c8->IRegister =
+      read_memory(c8, c8->pc + 2) << 8 | read_memory(c8, c8->pc + 3);
+  c8->pc += 0x4;
+}
+
+// 0xFN01 -> PLANE: Select the planes N for drawing (XO-CHIP)
+void plane_n(Chip8 *c8) {
+  c8->planes = (c8->opcode & 0x0F00) >> 8 & ((1 << DISPLAY_PLANES) - 1);
+  c8->pc += 0x2;
+}
+
+// 0xF002 -> AUDIO: Load the audio pattern from the 16 bytes at I (XO-CHIP)
+void ld_audio_i(Chip8 *c8) {
+  for (int i = 0; i < AUDIO_PATTERN_SIZE; i++)
+    c8->audio_pattern[i] = read_memory(c8, c8->IRegister + i);
+  c8->pc += 0x2;
+}
+
+// 0xFX3A -> PITCH: Set the pitch of the audio pattern to Vx (XO-CHIP)
+void ld_pitch_vx(Chip8 *c8) {
+  uint8_t x;
+
+  x = (c8->opcode & 0x0F00) >> 8;
+  c8->pitch = c8->registers[x];
+  c8->pc += 0x2;
+}
+
 // 0xFX33 -> LD: Store BCD representation of Vx
 void ld_b_vx(Chip8 *c8) {
   uint8_t x;
 
   x = (c8->opcode & 0x0F00) >> 8;
-  c8->memory[c8->IRegister] = c8->registers[x] / 100;
-  c8->memory[c8->IRegister + 1] = (c8->registers[x] / 10) % 10;
-  c8->memory[c8->IRegister + 2] = c8->registers[x] % 10;
+  write_memory(c8, c8->IRegister, c8->registers[x] / 100);
+  write_memory(c8, c8->IRegister + 1, (c8->registers[x] / 10) % 10);
+  write_memory(c8, c8->IRegister + 2, c8->registers[x] % 10);
+  memory_written(c8, c8->IRegister, 3);
+  c8->pc += 0x2;
+}
+
+// 0xFX75 -> LD: Save V0 to Vx in the RPL user flags, at most V0 to V7
+// unless xochip (SUPER-CHIP)
+SPECIALIZED void ld_r_vx(Chip8 *c8, bool xochip) {
+  uint8_t x, flags = xochip ? XO_RPL_FLAGS : RPL_FLAGS;
+
+  x = (c8->opcode & 0x0F00) >> 8;
+  if (x >= flags)
+    x = flags - 1;
+  memcpy(c8->rpl, c8->registers, x + 1);
+  c8->pc += 0x2;
+}
+
+// 0xFX85 -> LD: Load V0 to Vx from the RPL user flags, at most V0 to V7
+// unless xochip (SUPER-CHIP)
+SPECIALIZED void ld_vx_r(Chip8 *c8, bool xochip) {
+  uint8_t x, flags = xochip ? XO_RPL_FLAGS : RPL_FLAGS;
+
+  x = (c8->opcode & 0x0F00) >> 8;
+  if (x >= flags)
+    x = flags - 1;
+  memcpy(c8->registers, c8->rpl, x + 1);
   c8->pc += 0x2;
 }
 
+// How far FX55 and FX65 move I under an IndexQuirk
+SPECIALIZED uint16_t index_step(IndexQuirk index, uint8_t x) {
+  switch (index) {
+  case INDEX_ADD_X:
+    return x;
+  case INDEX_ADD_X_PLUS_1:
+    return x + 1;
+  default:
+    return 0;
+  }
+}
+
 // 0xFX55 -> LD: Store registers V0 to Vx in memory
-void ld_i_vx(Chip8 *c8) {
+SPECIALIZED void ld_i_vx(Chip8 *c8, IndexQuirk index) {
   uint8_t x;
 
   x = (c8->opcode & 0x0F00) >> 8;
+  memory_written(c8, c8->IRegister, x + 1);
   for (int i = 0; i <= x; i++) {
-    c8->memory[c8->IRegister++] = c8->registers[i];
+    write_memory(c8, c8->IRegister + i, c8->registers[i]);
   }
 
+  c8->IRegister += index_step(index, x);
   c8->pc += 0x2;
 }
 
 // 0xFX65 -> LD: Load registers V0 to Vx from memory
-void ld_vx_i(Chip8 *c8) {
+SPECIALIZED void ld_vx_i(Chip8 *c8, IndexQuirk index) {
   uint8_t x;
 
   x = (c8->opcode & 0x0F00) >> 8;
   for (int i = 0; i <= x; i++) {
-    c8->registers[i] = c8->memory[c8->IRegister++];
+    c8->registers[i] = read_memory(c8, c8->IRegister + i);
   }
 
+  c8->IRegister += index_step(index, x);
   c8->pc += 0x2;
-}
\ No newline at end of file
+}
+
+// The handlers above, compiled for one quirk profile
+#define DEFINE_QUIRK_HANDLERS(name, profile, vf_reset, shift_vy, index, clip, \
+                              jump_vx, schip, xochip)                          \
+  void se_vx_byte_##name(Chip8 *c8) { se_vx_byte(c8, xochip); }                \
+  void sne_vx_byte_##name(Chip8 *c8) { sne_vx_byte(c8, xochip); }              \
+  void se_vx_vy_##name(Chip8 *c8) { se_vx_vy(c8, xochip); }                    \
+  void or_vx_vy_##name(Chip8 *c8) { or_vx_vy(c8, vf_reset); }                  \
+  void and_vx_vy_##name(Chip8 *c8) { and_vx_vy(c8, vf_reset); }                \
+  void xor_vx_vy_##name(Chip8 *c8) { xor_vx_vy(c8, vf_reset); }                \
+  void shr_vx_##name(Chip8 *c8) { shr_vx(c8, shift_vy); }                      \
+  void shl_vx_##name(Chip8 *c8) { shl_vx(c8, shift_vy); }                      \
+  void sne_vx_vy_##name(Chip8 *c8) { sne_vx_vy(c8, xochip); }                  \
+  void jp_v0_addr_##name(Chip8 *c8) { jp_v0_addr(c8, jump_vx); }               \
+  void drw_vx_vy_nibble_##name(Chip8 *c8) {                                    \
+    drw_vx_vy_nibble(c8, clip, xochip);                                        \
+  }                                                                            \
+  void skp_vx_##name(Chip8 *c8) { skp_vx(c8, xochip); }                        \
+  void sknp_vx_##name(Chip8 *c8) { sknp_vx(c8, xochip); }                      \
+  void ld_i_vx_##name(Chip8 *c8) { ld_i_vx(c8, index); }                       \
+  void ld_vx_i_##name(Chip8 *c8) { ld_vx_i(c8, index); }                       \
+  void ld_r_vx_##name(Chip8 *c8) { ld_r_vx(c8, xochip); }                      \
+  void ld_vx_r_##name(Chip8 *c8) { ld_vx_r(c8, xochip); }
+
+QUIRK_PROFILES(DEFINE_QUIRK_HANDLERS)
\ No newline at end of file
@@ -5,39 +5,60 @@
 
 // Function prototypes for CHIP-8 operations
 void cls(Chip8 *c8);
+void scd_nibble(Chip8 *c8);
+void scu_nibble(Chip8 *c8);
+void scr(Chip8 *c8);
+void scl(Chip8 *c8);
+void exit_interpreter(Chip8 *c8);
+void low(Chip8 *c8);
+void high(Chip8 *c8);
 int ret(Chip8 *c8);
 void sys_addr(Chip8 *c8);
 int call_addr(Chip8 *c8);
 void jmp_addr(Chip8 *c8);
-void se_vx_byte(Chip8 *c8);
-void sne_vx_byte(Chip8 *c8);
-void se_vx_vy(Chip8 *c8);
+void ld_i_vx_vy(Chip8 *c8);
+void ld_vx_vy_i(Chip8 *c8);
 void ld_vx_byte(Chip8 *c8);
 void add_vx_byte(Chip8 *c8);
 void ld_vx_vy(Chip8 *c8);
-void or_vx_vy(Chip8 *c8);
-void and_vx_vy(Chip8 *c8);
-void xor_vx_vy(Chip8 *c8);
 void add_vx_vy(Chip8 *c8);
 void sub_vx_vy(Chip8 *c8);
-void shr_vx(Chip8 *c8);
 void subn_vx_vy(Chip8 *c8);
-void shl_vx(Chip8 *c8);
-void sne_vx_vy(Chip8 *c8);
 void ld_i_addr(Chip8 *c8);
-void jp_v0_addr(Chip8 *c8);
 void rnd_vx_kk(Chip8 *c8);
-void drw_vx_vy_nibble(Chip8 *c8);
-void skp_vx(Chip8 *c8);
-void sknp_vx(Chip8 *c8);
 void ld_vx_k(Chip8 *c8, int key);
 void ld_vx_dt(Chip8 *c8);
 void ld_dt_vx(Chip8 *c8);
 void ld_st_vx(Chip8 *c8);
 void add_i_vx(Chip8 *c8);
 void ld_f_vx(Chip8 *c8);
+void ld_hf_vx(Chip8 *c8);
 void ld_b_vx(Chip8 *c8);
-void ld_i_vx(Chip8 *c8);
-void ld_vx_i(Chip8 *c8);
+void ld_i_long(Chip8 *c8);
+void plane_n(Chip8 *c8);
+void ld_audio_i(Chip8 *c8);
+void ld_pitch_vx(Chip8 *c8);
+
+// Handlers that depend on the quirk profile, compiled once per profile
+#define DECLARE_QUIRK_HANDLERS(name, ...)                                      \
+  void se_vx_byte_##name(Chip8 *c8);                                           \
+  void sne_vx_byte_##name(Chip8 *c8);                                          \
+  void se_vx_vy_##name(Chip8 *c8);                                             \
+  void or_vx_vy_##name(Chip8 *c8);                                             \
+  void and_vx_vy_##name(Chip8 *c8);                                            \
+  void xor_vx_vy_##name(Chip8 *c8);                                            \
+  void shr_vx_##name(Chip8 *c8);                                               \
+  void shl_vx_##name(Chip8 *c8);                                               \
+  void sne_vx_vy_##name(Chip8 *c8);                                            \
+  void jp_v0_addr_##name(Chip8 *c8);                                           \
+  void drw_vx_vy_nibble_##name(Chip8 *c8);                                     \
+  void skp_vx_##name(Chip8 *c8);                                               \
+  void sknp_vx_##name(Chip8 *c8);                                              \
+  void ld_i_vx_##name(Chip8 *c8);                                              \
+  void ld_vx_i_##name(Chip8 *c8);                                              \
+  void ld_r_vx_##name(Chip8 *c8);                                              \
+  void ld_vx_r_##name(Chip8 *c8);
+
+QUIRK_PROFILES(DECLARE_QUIRK_HANDLERS)
 
 #endif
\ No newline at end of file
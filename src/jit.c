@@ -0,0 +1,647 @@
+#include "jit.h"
+#include "chip8.h"
+#include "dispatch.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <stddef.h>
+#include <sys/mman.h>
+
+/*
+ * Translated code runs with the Chip8 instance in rbx, the remaining cycle
+ * budget in r12 and the block entry table in r13. Guest registers, I and
+ * the timers are read and written in place through rbx, and every other
+ * register is scratch, so handlers from instructions.c can be called at
+ * any point without spilling anything.
+ *
+ * Each block starts by checking that the budget covers all of its
+ * instructions and bails out to the dispatcher otherwise, which steps the
+ * remainder with the interpreter. This keeps instruction counts, and so
+ * timer ticks, identical to the interpreter.
+ */
+
+#define V_OFF(x) ((int32_t)(offsetof(Chip8, registers) + (x)))
+#define I_OFF ((int32_t)offsetof(Chip8, IRegister))
+#define PC_OFF ((int32_t)offsetof(Chip8, pc))
+#define OPCODE_OFF ((int32_t)offsetof(Chip8, opcode))
+#define DT_OFF ((int32_t)offsetof(Chip8, delay_timer))
+#define ST_OFF ((int32_t)offsetof(Chip8, sound_timer))
+#define KEYPAD_OFF ((int32_t)offsetof(Chip8, keypad))
+
+// Space that must be left in the code region before translating a block
+#define MAX_BLOCK_CODE 4096
+
+// Signature of the entry trampoline at the start of the code region
+typedef int64_t (*JitEnter)(Chip8 *c8, int64_t budget, void *code,
+                            void **entries);
+
+static void emit8(Jit *jit, uint8_t byte) { jit->code[jit->used++] = byte; }
+
+static void emit16(Jit *jit, uint16_t value) {
+  memcpy(jit->code + jit->used, &value, sizeof(value));
+  jit->used += sizeof(value);
+}
+
+static void emit32(Jit *jit, int32_t value) {
+  memcpy(jit->code + jit->used, &value, sizeof(value));
+  jit->used += sizeof(value);
+}
+
+static void emit64(Jit *jit, uint64_t value) {
+  memcpy(jit->code + jit->used, &value, sizeof(value));
+  jit->used += sizeof(value);
+}
+
+static void emit_bytes(Jit *jit, const uint8_t *bytes, size_t len) {
+  memcpy(jit->code + jit->used, bytes, len);
+  jit->used += len;
+}
+
+// <op> [rbx + disp32] with a one or two byte opcode and a ModRM reg field
+static void emit_mem(Jit *jit, const uint8_t *op, size_t op_len, uint8_t reg,
+                     int32_t disp) {
+  emit_bytes(jit, op, op_len);
+  emit8(jit, 0x83 | (reg << 3));
+  emit32(jit, disp);
+}
+
+static void patch_rel32(Jit *jit, size_t site, size_t target) {
+  int32_t rel = (int32_t)(target - (site + 4));
+  memcpy(jit->code + site, &rel, sizeof(rel));
+}
+
+// jmp rel32 to an offset in the code region
+static void emit_jmp(Jit *jit, size_t target) {
+  emit8(jit, 0xE9);
+  emit32(jit, 0);
+  patch_rel32(jit, jit->used - 4, target);
+}
+
+// mov byte [rbx + disp], imm8
+static void emit_store_imm8(Jit *jit, int32_t disp, uint8_t imm) {
+  emit_mem(jit, (const uint8_t[]){0xC6}, 1, 0, disp);
+  emit8(jit, imm);
+}
+
+// mov word [rbx + disp], imm16
+static void emit_store_imm16(Jit *jit, int32_t disp, uint16_t imm) {
+  emit8(jit, 0x66);
+  emit_mem(jit, (const uint8_t[]){0xC7}, 1, 0, disp);
+  emit16(jit, imm);
+}
+
+// mov al, byte [rbx + disp]
+static void emit_load_al(Jit *jit, int32_t disp) {
+  emit_mem(jit, (const uint8_t[]){0x8A}, 1, 0, disp);
+}
+
+// mov byte [rbx + disp], al
+static void emit_store_al(Jit *jit, int32_t disp) {
+  emit_mem(jit, (const uint8_t[]){0x88}, 1, 0, disp);
+}
+
+// movzx eax, byte [rbx + disp]
+static void emit_movzx_eax(Jit *jit, int32_t disp) {
+  emit_mem(jit, (const uint8_t[]){0x0F, 0xB6}, 2, 0, disp);
+}
+
+// Sets the guest PC, used before handlers and exits that need it
+static void emit_set_pc(Jit *jit, uint16_t pc) {
+  emit_store_imm16(jit, PC_OFF, pc);
+}
+
+// Calls the interpreter handler of an operation on the instance in rbx
+static void emit_call_handler(Jit *jit, Op op, uint16_t opcode) {
+  emit_store_imm16(jit, OPCODE_OFF, opcode);
+  emit_bytes(jit, (const uint8_t[]){0x48, 0x89, 0xDF}, 3); // mov rdi, rbx
+  emit_bytes(jit, (const uint8_t[]){0x48, 0xB8}, 2);       // mov rax, imm64
+  emit64(jit, (uint64_t)(uintptr_t)op_handlers[jit->quirks][op]);
+  emit_bytes(jit, (const uint8_t[]){0xFF, 0xD0}, 2); // call rax
+}
+
+/**
+ * @brief Emits an exit to a PC known at translation time.
+ *
+ * If the target is already translated the jump goes straight to it,
+ * otherwise it goes to the exit stub and is recorded so it can be patched
+ * once the target is translated.
+ *
+ * @param jit The JIT to emit into.
+ * @param target The guest PC to continue at.
+ */
+static void emit_chain_exit(Jit *jit, uint16_t target) {
+  emit_set_pc(jit, target);
+  emit8(jit, 0xE9);
+  emit32(jit, 0);
+  size_t site = jit->used - 4;
+
+  if (target < MEMORY_SIZE && jit->entries[target] != NULL) {
+    patch_rel32(jit, site, (uint8_t *)jit->entries[target] - jit->code);
+    return;
+  }
+
+  patch_rel32(jit, site, jit->exit_stub);
+  if (target < MEMORY_SIZE && jit->link_count < JIT_MAX_LINKS) {
+    JitLink *link = &jit->links[jit->link_count];
+    link->site = site;
+    link->next = jit->link_heads[target];
+    jit->link_heads[target] = jit->link_count++;
+  }
+}
+
+/**
+ * @brief Emits an exit to the PC a handler left in the instance, looking
+ * the target block up in the entry table at run time.
+ *
+ * @param jit The JIT to emit into.
+ */
+static void emit_dynamic_exit(Jit *jit) {
+  emit_mem(jit, (const uint8_t[]){0x0F, 0xB7}, 2, 0, PC_OFF); // movzx eax, pc
+  emit8(jit, 0x3D); // cmp eax, imm32
+  emit32(jit, MEMORY_SIZE - 1);
+  emit_bytes(jit, (const uint8_t[]){0x0F, 0x83}, 2); // jae exit_stub
+  emit32(jit, 0);
+  patch_rel32(jit, jit->used - 4, jit->exit_stub);
+  // mov rcx, [r13 + rax * 8]
+  emit_bytes(jit, (const uint8_t[]){0x49, 0x8B, 0x4C, 0xC5, 0x00}, 5);
+  emit_bytes(jit, (const uint8_t[]){0x48, 0x85, 0xC9}, 3); // test rcx, rcx
+  emit_bytes(jit, (const uint8_t[]){0x0F, 0x84}, 2);       // jz exit_stub
+  emit32(jit, 0);
+  patch_rel32(jit, jit->used - 4, jit->exit_stub);
+  emit_bytes(jit, (const uint8_t[]){0xFF, 0xE1}, 2); // jmp rcx
+}
+
+/**
+ * @brief Emits a skip instruction: the condition has already been compared
+ * and `jcc` selects the taken (skip) path.
+ *
+ * @param jit The JIT to emit into.
+ * @param jcc The second byte of the 0x0F 0x8x conditional jump.
+ * @param pc The address of the skip instruction.
+ */
+static void emit_skip(Jit *jit, uint8_t jcc, uint16_t pc) {
+  emit_bytes(jit, (const uint8_t[]){0x0F, jcc}, 2);
+  emit32(jit, 0);
+  size_t taken = jit->used - 4;
+
+  emit_chain_exit(jit, pc + 2);
+  patch_rel32(jit, taken, jit->used);
+  emit_chain_exit(jit, pc + 4);
+}
+
+/**
+ * @brief Emits native code for an operation that falls through to the next
+ * instruction. Each sequence mirrors its handler in instructions.c for the
+ * quirk profile being translated, including the order VF and Vx are
+ * written in when x or y is F.
+ *
+ * @param jit The JIT to emit into.
+ * @param op The decoded operation.
+ * @param opcode The opcode of the instruction.
+ */
+static void emit_straight(Jit *jit, Op op, uint16_t opcode) {
+  uint8_t x = (opcode & 0x0F00) >> 8;
+  uint8_t y = (opcode & 0x00F0) >> 4;
+  uint8_t kk = opcode & 0x00FF;
+  uint16_t nnn = opcode & 0x0FFF;
+  const Quirks *quirks = &quirk_profiles[jit->quirks];
+
+  switch (op) {
+  case OP_LD_VX_BYTE:
+    emit_store_imm8(jit, V_OFF(x), kk);
+    break;
+  case OP_ADD_VX_BYTE:
+    emit_mem(jit, (const uint8_t[]){0x80}, 1, 0, V_OFF(x)); // add [Vx], kk
+    emit8(jit, kk);
+    break;
+  case OP_LD_VX_VY:
+    emit_load_al(jit, V_OFF(y));
+    emit_store_al(jit, V_OFF(x));
+    break;
+  case OP_OR_VX_VY:
+  case OP_AND_VX_VY:
+  case OP_XOR_VX_VY:
+    emit_load_al(jit, V_OFF(y));
+    if (op == OP_OR_VX_VY)
+      emit_mem(jit, (const uint8_t[]){0x08}, 1, 0, V_OFF(x)); // or [Vx], al
+    else if (op == OP_AND_VX_VY)
+      emit_mem(jit, (const uint8_t[]){0x20}, 1, 0, V_OFF(x)); // and [Vx], al
+    else
+      emit_mem(jit, (const uint8_t[]){0x30}, 1, 0, V_OFF(x)); // xor [Vx], al
+    if (quirks->vf_reset & (1 << (opcode & 0x000F)))
+      emit_store_imm8(jit, V_OFF(0xF), 0);
+    break;
+  case OP_ADD_VX_VY:
+    emit_movzx_eax(jit, V_OFF(x));
+    emit_mem(jit, (const uint8_t[]){0x0F, 0xB6}, 2, 1, V_OFF(y)); // ecx = Vy
+    emit_bytes(jit, (const uint8_t[]){0x01, 0xC8}, 2);   // add eax, ecx
+    emit8(jit, 0x3D);                                    // cmp eax, 0xFF
+    emit32(jit, 0xFF);
+    emit_bytes(jit, (const uint8_t[]){0x0F, 0x97, 0xC0}, 3); // seta al
+    emit_store_al(jit, V_OFF(0xF));
+    emit_load_al(jit, V_OFF(x));
+    emit_mem(jit, (const uint8_t[]){0x02}, 1, 0, V_OFF(y)); // add al, [Vy]
+    emit_store_al(jit, V_OFF(x));
+    break;
+  case OP_SUB_VX_VY:
+    emit_load_al(jit, V_OFF(x));
+    emit_mem(jit, (const uint8_t[]){0x3A}, 1, 0, V_OFF(y)); // cmp al, [Vy]
+    emit_bytes(jit, (const uint8_t[]){0x0F, 0x97, 0xC0}, 3); // seta al
+    emit_store_al(jit, V_OFF(0xF));
+    emit_load_al(jit, V_OFF(x));
+    emit_mem(jit, (const uint8_t[]){0x2A}, 1, 0, V_OFF(y)); // sub al, [Vy]
+    emit_store_al(jit, V_OFF(x));
+    break;
+  case OP_SHR_VX:
+    if (quirks->shift_vy) {
+      emit_load_al(jit, V_OFF(y));
+      emit_store_al(jit, V_OFF(x));
+    }
+    emit_load_al(jit, V_OFF(x));
+    emit_bytes(jit, (const uint8_t[]){0x24, 0x01}, 2); // and al, 1
+    emit_store_al(jit, V_OFF(0xF));
+    emit_mem(jit, (const uint8_t[]){0xD0}, 1, 5, V_OFF(x)); // shr [Vx], 1
+    break;
+  case OP_SUBN_VX_VY:
+    emit_load_al(jit, V_OFF(y));
+    emit_mem(jit, (const uint8_t[]){0x3A}, 1, 0, V_OFF(x)); // cmp al, [Vx]
+    emit_bytes(jit, (const uint8_t[]){0x0F, 0x97, 0xC0}, 3); // seta al
+    emit_store_al(jit, V_OFF(0xF));
+    emit_load_al(jit, V_OFF(y));
+    emit_mem(jit, (const uint8_t[]){0x2A}, 1, 0, V_OFF(x)); // sub al, [Vx]
+    emit_store_al(jit, V_OFF(x));
+    break;
+  case OP_SHL_VX:
+    if (quirks->shift_vy) {
+      emit_load_al(jit, V_OFF(y));
+      emit_store_al(jit, V_OFF(x));
+    }
+    emit_load_al(jit, V_OFF(x));
+    emit_bytes(jit, (const uint8_t[]){0xC0, 0xE8, 0x07}, 3); // shr al, 7
+    emit_store_al(jit, V_OFF(0xF));
+    emit_mem(jit, (const uint8_t[]){0xD0}, 1, 4, V_OFF(x)); // shl [Vx], 1
+    break;
+  case OP_LD_I_ADDR:
+    emit_store_imm16(jit, I_OFF, nnn);
+    break;
+  case OP_ADD_I_VX:
+    emit_movzx_eax(jit, V_OFF(x));
+    emit8(jit, 0x66);
+    emit_mem(jit, (const uint8_t[]){0x01}, 1, 0, I_OFF); // add [I], ax
+    break;
+  case OP_LD_F_VX:
+    emit_movzx_eax(jit, V_OFF(x));
+    emit_bytes(jit, (const uint8_t[]){0x8D, 0x04, 0x80}, 3); // eax *= 5
+    emit8(jit, 0x66);
+    emit_mem(jit, (const uint8_t[]){0x89}, 1, 0, I_OFF); // mov [I], ax
+    break;
+  case OP_LD_VX_DT:
+    emit_load_al(jit, DT_OFF);
+    emit_store_al(jit, V_OFF(x));
+    break;
+  case OP_LD_DT_VX:
+    emit_load_al(jit, V_OFF(x));
+    emit_store_al(jit, DT_OFF);
+    break;
+  case OP_LD_ST_VX:
+    emit_load_al(jit, V_OFF(x));
+    emit_store_al(jit, ST_OFF);
+    break;
+  default:
+    // CLS, RND and FX65 go through their handlers
+    emit_call_handler(jit, op, opcode);
+    break;
+  }
+}
+
+/**
+ * @brief Checks if an operation is a conditional skip.
+ *
+ * @param op The decoded operation.
+ * @return true for 3XKK, 4XKK, 5XY0, 9XY0, EX9E and EXA1.
+ */
+static bool skips(Op op) {
+  switch (op) {
+  case OP_SE_VX_BYTE:
+  case OP_SNE_VX_BYTE:
+  case OP_SE_VX_VY:
+  case OP_SNE_VX_VY:
+  case OP_SKP_VX:
+  case OP_SKNP_VX:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Emits the instruction that ends a block and the exits following it.
+ *
+ * @param jit The JIT to emit into.
+ * @param op The decoded operation.
+ * @param opcode The opcode of the instruction.
+ * @param pc The address of the instruction.
+ */
+static void emit_block_end(Jit *jit, Op op, uint16_t opcode, uint16_t pc) {
+  uint8_t x = (opcode & 0x0F00) >> 8;
+  uint8_t y = (opcode & 0x00F0) >> 4;
+  uint8_t kk = opcode & 0x00FF;
+
+  // XO-CHIP skips step over all 4 bytes of F000 NNNN, so how far they skip
+  // is only known from the next instruction when they run
+  if (quirk_profiles[jit->quirks].xochip && skips(op)) {
+    emit_set_pc(jit, pc);
+    emit_call_handler(jit, op, opcode);
+    emit_dynamic_exit(jit);
+    return;
+  }
+
+  switch (op) {
+  case OP_JP_ADDR:
+  case OP_SYS_ADDR:
+    emit_chain_exit(jit, opcode & 0x0FFF);
+    break;
+  case OP_SE_VX_BYTE:
+  case OP_SNE_VX_BYTE:
+    emit_mem(jit, (const uint8_t[]){0x80}, 1, 7, V_OFF(x)); // cmp [Vx], kk
+    emit8(jit, kk);
+    emit_skip(jit, op == OP_SE_VX_BYTE ? 0x84 : 0x85, pc);
+    break;
+  case OP_SE_VX_VY:
+  case OP_SNE_VX_VY:
+    emit_load_al(jit, V_OFF(x));
+    emit_mem(jit, (const uint8_t[]){0x3A}, 1, 0, V_OFF(y)); // cmp al, [Vy]
+    emit_skip(jit, op == OP_SE_VX_VY ? 0x84 : 0x85, pc);
+    break;
+  case OP_SKP_VX:
+  case OP_SKNP_VX:
+    emit_movzx_eax(jit, V_OFF(x));
+    // cmp byte [rbx + rax + keypad], 0
+    emit_bytes(jit, (const uint8_t[]){0x80, 0xBC, 0x03}, 3);
+    emit32(jit, KEYPAD_OFF);
+    emit8(jit, 0);
+    emit_skip(jit, op == OP_SKP_VX ? 0x85 : 0x84, pc);
+    break;
+  case OP_DRW_VX_VY_NIBBLE:
+    emit_call_handler(jit, op, opcode);
+    emit_chain_exit(jit, pc + 2);
+    break;
+  case OP_LD_B_VX:
+  case OP_LD_I_VX:
+  case OP_LD_I_VX_VY:
+    // The write may invalidate this very block, return to the dispatcher
+    // so it can flush before anything else runs
+    emit_set_pc(jit, pc);
+    emit_call_handler(jit, op, opcode);
+    emit_jmp(jit, jit->exit_stub);
+    break;
+  case OP_EXIT:
+    // Return to the dispatcher, which stops if the instance was stopped
+    emit_set_pc(jit, pc);
+    emit_call_handler(jit, op, opcode);
+    emit_jmp(jit, jit->exit_stub);
+    break;
+  default:
+    // CALL, RET, BNNN, FX0A, unknown opcodes and the SUPER-CHIP and XO-CHIP
+    // instructions, which are SYS jumps, skips or unknown under other
+    // profiles, leave the next PC in c8
+    emit_set_pc(jit, pc);
+    emit_call_handler(jit, op, opcode);
+    emit_dynamic_exit(jit);
+    break;
+  }
+}
+
+/**
+ * @brief Emits the entry trampoline and the shared exit stub.
+ *
+ * The trampoline saves the callee-saved registers, loads rbx, r12 and r13
+ * and jumps to a block. The exit stub returns the remaining budget.
+ *
+ * @param jit The JIT to emit into.
+ */
+static void emit_stubs(Jit *jit) {
+  static const uint8_t enter[] = {
+      0x53,                   // push rbx
+      0x41, 0x54,             // push r12
+      0x41, 0x55,             // push r13
+      0x41, 0x56,             // push r14
+      0x41, 0x57,             // push r15
+      0x55,                   // push rbp
+      0x48, 0x83, 0xEC, 0x08, // sub rsp, 8 (align calls to 16 bytes)
+      0x48, 0x89, 0xFB,       // mov rbx, rdi
+      0x49, 0x89, 0xF4,       // mov r12, rsi
+      0x49, 0x89, 0xCD,       // mov r13, rcx
+      0xFF, 0xE2,             // jmp rdx
+  };
+  static const uint8_t leave[] = {
+      0x4C, 0x89, 0xE0,       // mov rax, r12
+      0x48, 0x83, 0xC4, 0x08, // add rsp, 8
+      0x5D,                   // pop rbp
+      0x41, 0x5F,             // pop r15
+      0x41, 0x5E,             // pop r14
+      0x41, 0x5D,             // pop r13
+      0x41, 0x5C,             // pop r12
+      0x5B,                   // pop rbx
+      0xC3,                   // ret
+  };
+
+  jit->used = 0;
+  emit_bytes(jit, enter, sizeof(enter));
+  jit->exit_stub = jit->used;
+  emit_bytes(jit, leave, sizeof(leave));
+}
+
+/**
+ * @brief Discards all translated code and lookup state.
+ *
+ * @param jit The JIT to flush.
+ */
+static void jit_flush(Jit *jit) {
+  memset(jit->entries, 0, sizeof(jit->entries));
+  memset(jit->lengths, 0, sizeof(jit->lengths));
+  memset(jit->coverage, 0, sizeof(jit->coverage));
+  memset(jit->link_heads, 0xFF, sizeof(jit->link_heads));
+  jit->link_count = 0;
+  jit->flush_pending = false;
+  emit_stubs(jit);
+}
+
+/**
+ * @brief Translates the block starting at pc and links pending exits to it.
+ *
+ * @param c8 The Chip8 instance whose memory holds the code.
+ * @param pc The address of the first instruction.
+ * @return The entry point of the translated block.
+ */
+static void *translate_block(Chip8 *c8, uint16_t pc) {
+  Jit *jit = c8->jit;
+  uint32_t addr = pc;
+  int length = 0;
+  Op op = OP_UNKNOWN;
+  uint16_t opcode = 0;
+
+  if (JIT_CODE_SIZE - jit->used < MAX_BLOCK_CODE)
+    jit_flush(jit);
+  jit->quirks = c8->quirks;
+
+  // Count the instructions first, the entry check needs the total
+  for (uint32_t a = pc; length < 32 && a + 1 < MEMORY_SIZE; a += 2) {
+    opcode = (c8->memory[a] << 8) | c8->memory[a + 1];
+    length++;
+    if (op_ends_block(op_decode_table[opcode]))
+      break;
+  }
+
+  size_t entry = jit->used;
+  emit_bytes(jit, (const uint8_t[]){0x49, 0x81, 0xFC}, 3); // cmp r12, length
+  emit32(jit, length);
+  emit_bytes(jit, (const uint8_t[]){0x0F, 0x8C}, 2); // jl bail
+  emit32(jit, 0);
+  size_t bail = jit->used - 4;
+  emit_bytes(jit, (const uint8_t[]){0x49, 0x81, 0xEC}, 3); // sub r12, length
+  emit32(jit, length);
+
+  for (int i = 0; i < length; i++, addr += 2) {
+    opcode = (c8->memory[addr] << 8) | c8->memory[addr + 1];
+    op = op_decode_table[opcode];
+    if (i == length - 1 && op_ends_block(op))
+      emit_block_end(jit, op, opcode, addr);
+    else
+      emit_straight(jit, op, opcode);
+  }
+  if (!op_ends_block(op))
+    emit_chain_exit(jit, addr);
+
+  // Not enough budget left for the whole block
+  patch_rel32(jit, bail, jit->used);
+  emit_set_pc(jit, pc);
+  emit_jmp(jit, jit->exit_stub);
+
+  for (uint32_t a = pc; a < addr; a++)
+    jit->coverage[a] = 1;
+  jit->entries[pc] = jit->code + entry;
+  jit->lengths[pc] = length;
+
+  // Chain exits that were waiting for this block
+  for (int32_t l = jit->link_heads[pc]; l >= 0; l = jit->links[l].next)
+    patch_rel32(jit, jit->links[l].site, entry);
+  jit->link_heads[pc] = -1;
+
+  return jit->entries[pc];
+}
+
+bool jit_supported(void) { return true; }
+
+Jit *jit_create(void) {
+  Jit *jit = calloc(1, sizeof(Jit));
+  if (jit == NULL) {
+    log_error("Error: Failed to allocate memory for the JIT.");
+    return NULL;
+  }
+
+  jit->code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (jit->code == MAP_FAILED) {
+    log_error("Error: Failed to map executable memory for the JIT.");
+    free(jit);
+    return NULL;
+  }
+
+  jit_flush(jit);
+  return jit;
+}
+
+void jit_destroy(Jit *jit) {
+  if (jit == NULL)
+    return;
+
+  munmap(jit->code, JIT_CODE_SIZE);
+  free(jit);
+}
+
+/**
+ * @brief Schedules a flush when translated code was read from the range.
+ *
+ * The flush is deferred to the dispatcher because the write may come from
+ * a handler called by the very block that would be discarded.
+ *
+ * @param jit The JIT to update.
+ * @param addr The first address written.
+ * @param len The number of bytes written.
+ */
+void jit_invalidate(Jit *jit, uint32_t addr, uint32_t len) {
+  uint32_t end = addr + len;
+
+  if (end > MEMORY_SIZE)
+    end = MEMORY_SIZE;
+  for (uint32_t a = addr; a < end; a++) {
+    if (jit->coverage[a]) {
+      jit->flush_pending = true;
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Executes up to max_cycles instructions with translated code.
+ *
+ * Translated blocks jump to each other directly and only return here when
+ * they reach untranslated code, a memory write, or the end of the budget.
+ * A budget smaller than the next block is finished with the interpreter.
+ *
+ * @param c8 The Chip8 instance to run.
+ * @param max_cycles The maximum number of instructions to execute.
+ * @return The number of instructions executed, fewer if the instance stops.
+ */
+int jit_run(Chip8 *c8, int max_cycles) {
+  Jit *jit = c8->jit;
+  JitEnter enter = (JitEnter)(void *)jit->code;
+  int64_t budget = max_cycles;
+
+  while (budget > 0 && c8->running) {
+    if (jit->flush_pending)
+      jit_flush(jit);
+
+    void *entry = NULL;
+    if (c8->pc + 1 < MEMORY_SIZE) {
+      entry = jit->entries[c8->pc];
+      if (entry == NULL)
+        entry = translate_block(c8, c8->pc);
+    }
+
+    if (entry == NULL || jit->lengths[c8->pc] > budget) {
+      fetch_opcode(c8);
+      execute_instruction(c8);
+      budget--;
+      continue;
+    }
+
+    budget = enter(c8, budget, entry, jit->entries);
+  }
+  return max_cycles - budget;
+}
+
+#else
+
+bool jit_supported(void) { return false; }
+
+Jit *jit_create(void) {
+  log_error("Error: The JIT is only available on x86-64 hosts.");
+  return NULL;
+}
+
+void jit_destroy(Jit *jit) { (void)jit; }
+
+void jit_invalidate(Jit *jit, uint32_t addr, uint32_t len) {
+  (void)jit;
+  (void)addr;
+  (void)len;
+}
+
+int jit_run(Chip8 *c8, int max_cycles) {
+  (void)c8;
+  (void)max_cycles;
+  return 0;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "chip8_types.h"
+
+// Size of the executable region holding translated blocks
+#define JIT_CODE_SIZE (1 << 20)
+// Maximum number of chained exits waiting for their target to be compiled
+#define JIT_MAX_LINKS 8192
+
+// A jump in translated code waiting for the block at its target PC
+typedef struct {
+  uint32_t site; // Offset of the rel32 operand to patch
+  int32_t next;  // Next link waiting for the same target, -1 ends the list
+} JitLink;
+
+// Translated code and lookup tables of one Chip8 instance
+typedef struct Jit {
+  uint8_t *code;
+  size_t used;
+  size_t exit_stub;
+  void *entries[MEMORY_SIZE];     // Entry point of the block at each PC
+  uint8_t lengths[MEMORY_SIZE];   // Instructions in the block at each PC
+  uint8_t coverage[MEMORY_SIZE];  // Bytes that translated code was read from
+  int32_t link_heads[MEMORY_SIZE];
+  JitLink links[JIT_MAX_LINKS];
+  int link_count;
+  bool flush_pending;
+  QuirkProfile quirks; // Profile of the instance being translated
+} Jit;
+
+/// @brief Checks if the JIT can run on this host
+/// @return true on x86-64 hosts
+bool jit_supported(void);
+
+/// @brief Allocates the executable region and tables of a JIT
+/// @return The JIT, or NULL if unsupported or allocation fails
+Jit *jit_create(void);
+
+/// @brief Releases a JIT and its executable region
+/// @param jit The JIT to free
+void jit_destroy(Jit *jit);
+
+/// @brief Schedules a flush if translated code was read from a written range
+/// @param jit The JIT to update
+/// @param addr The first address that was written
+/// @param len The number of bytes written
+void jit_invalidate(Jit *jit, uint32_t addr, uint32_t len);
+
+/// @brief Executes instructions with translated code, translating as needed
+/// @param c8 The Chip8 instance, its JIT must be allocated
+/// @param max_cycles The maximum number of instructions to execute
+/// @return The number of instructions executed, fewer if the instance stops
+int jit_run(Chip8 *c8, int max_cycles);
+
+#endif
\ No newline at end of file
@@ -1,39 +1,33 @@
 #include "keypad.h"
-#include "chip8_types.h"
 
 static const uint8_t KEYMAP[16] = {
     KEY_X, KEY_ONE, KEY_TWO, KEY_THREE, KEY_Q,    KEY_W, KEY_E, KEY_A,
     KEY_S, KEY_D,   KEY_Z,   KEY_C,     KEY_FOUR, KEY_R, KEY_F, KEY_V};
 
-void handle_input(Chip8 *c8) {
+void handle_input(Controls *controls) {
   // Exit the program
   if (IsKeyPressed(KEY_ESCAPE))
-    c8->running = false;
+    atomic_store(&controls->running, false);
 
   // Reset program
-  if (!c8->paused && IsKeyPressed(KEY_O))
-    c8->reset = true;
+  if (!atomic_load(&controls->paused) && IsKeyPressed(KEY_O))
+    atomic_store(&controls->reset, true);
 
   // Pause/Resume program
   if (IsKeyPressed(KEY_P))
-    c8->paused = !c8->paused;
+    atomic_store(&controls->paused, !atomic_load(&controls->paused));
 
-  for (int i = 0x0; i <= 0xF; i++) {
-    c8->keypad[i] = IsKeyDown(KEYMAP[i]);
-  }
-}
+  // Fast-forward on/off
+  if (IsKeyPressed(KEY_TAB))
+    atomic_store(&controls->turbo, !atomic_load(&controls->turbo));
 
-int wait_for_key(Chip8 *c8) {
-  for (int i = 0x0; i <= 0xF; i++) {
-    if (IsKeyDown(KEYMAP[i])) {
-      return -1;
-    }
+  // Step backwards through the rewind history while held
+  atomic_store(&controls->rewinding, IsKeyDown(KEY_BACKSPACE));
 
-    if (c8->keypad[i]) {
-      c8->keypad[i] = false;
-      return i;
-    }
+  // The emulation thread picks the keys up as one word
+  uint16_t keys = 0;
+  for (int i = 0x0; i <= 0xF; i++) {
+    keys |= IsKeyDown(KEYMAP[i]) << i;
   }
-
-  return -1;
+  atomic_store(&controls->keys, keys);
 }
\ No newline at end of file
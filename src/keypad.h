@@ -1,16 +1,12 @@
 #ifndef KEYPAD_H
 #define KEYPAD_H
 
-#include "chip8_types.h"
+#include "emulator.h"
 #include "raylib.h"
 #include "stdint.h"
 
-/// @brief Handle key events and update the Chip8 keypad state
-/// @param c8 The Chip8 instance for which to handle events
-void handle_input(Chip8 *c8);
-
-/// @brief Listens for a key press and returns the key value
-/// @param c8 The Chip8 instance for which to handle events
-int wait_for_key(Chip8 *c8);
+/// @brief Handle key events and pass them to the emulation thread
+/// @param controls The controls of the emulation to update
+void handle_input(Controls *controls);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,691 @@
+#include "lockstep.h"
+#include "chip8.h"
+#include "dispatch.h"
+#include "savestate.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LOCKSTEP_AVX2
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Copies the structure-of-arrays registers of a lane into its Chip8.
+ *
+ * @param ls The group.
+ * @param lane The lane.
+ */
+static void load_lane(Lockstep *ls, int lane) {
+  Chip8 *c8 = ls->lanes[lane];
+  for (int r = 0; r < 16; r++)
+    c8->registers[r] = ls->registers[r][lane];
+  c8->IRegister = ls->IRegister[lane];
+  c8->pc = ls->pc[lane];
+  c8->delay_timer = ls->delay_timer[lane];
+  c8->sound_timer = ls->sound_timer[lane];
+  c8->rng_state = ls->rng_state[lane];
+}
+
+/**
+ * @brief Copies the registers of a lane's Chip8 back into the arrays.
+ *
+ * @param ls The group.
+ * @param lane The lane.
+ */
+static void store_lane(Lockstep *ls, int lane) {
+  const Chip8 *c8 = ls->lanes[lane];
+  for (int r = 0; r < 16; r++)
+    ls->registers[r][lane] = c8->registers[r];
+  ls->IRegister[lane] = c8->IRegister;
+  ls->pc[lane] = c8->pc;
+  ls->delay_timer[lane] = c8->delay_timer;
+  ls->sound_timer[lane] = c8->sound_timer;
+  ls->rng_state[lane] = c8->rng_state;
+}
+
+// Moves the registers of a lane into its Chip8, if they are not there yet
+static inline void unpack_lane(Lockstep *ls, int lane) {
+  if (!(ls->unpacked & (1u << lane))) {
+    load_lane(ls, lane);
+    ls->unpacked |= 1u << lane;
+  }
+}
+
+// Moves the registers of a lane back into the arrays, if they are not there
+static inline void pack_lane(Lockstep *ls, int lane) {
+  if (ls->unpacked & (1u << lane)) {
+    store_lane(ls, lane);
+    ls->unpacked &= ~(1u << lane);
+  }
+}
+
+// PC of a lane, wherever its registers are
+#define LANE_PC(ls, lane)                                                      \
+  ((ls)->unpacked & (1u << (lane)) ? (ls)->lanes[lane]->pc : (ls)->pc[lane])
+
+/**
+ * @brief Executes one instruction of a single lane with the handlers from
+ * instructions.c.
+ *
+ * The lane's registers stay in its Chip8 afterwards, so a lane that runs
+ * on its own for a while is only moved in and out of the arrays once.
+ *
+ * @param ls The group.
+ * @param lane The lane.
+ */
+static void step_scalar(Lockstep *ls, int lane) {
+  Chip8 *c8 = ls->lanes[lane];
+  unpack_lane(ls, lane);
+  fetch_opcode(c8);
+
+  // FX33, FX55 and 5XY2 are the only instructions that write memory
+  Op op = op_decode_table[c8->opcode];
+  if (op == OP_LD_B_VX || op == OP_LD_I_VX || op == OP_LD_I_VX_VY) {
+    int x = (c8->opcode & 0x0F00) >> 8;
+    int y = (c8->opcode & 0x00F0) >> 4;
+    uint32_t len = op == OP_LD_B_VX   ? 3
+                   : op == OP_LD_I_VX ? x + 1
+                                      : abs(y - x) + 1;
+    // Writes wrap around at the end of memory like write_memory
+    for (uint32_t i = 0; i < len; i++) {
+      uint32_t addr = (c8->IRegister + i) & (c8->memory_size - 1);
+      if (addr < MEMORY_SIZE)
+        ls->written[addr / LOCKSTEP_PAGE_SIZE] |= 1u << lane;
+    }
+  }
+
+  execute_instruction(c8);
+  ls->scalar_ops++;
+  if (!c8->running)
+    ls->stopped |= 1u << lane;
+}
+
+// Operations step_simd executes, all others run lane by lane
+static const bool SIMD_OPS[OP_COUNT] = {
+    [OP_JP_ADDR] = true,     [OP_SE_VX_BYTE] = true,  [OP_SNE_VX_BYTE] = true,
+    [OP_SE_VX_VY] = true,    [OP_LD_VX_BYTE] = true,  [OP_ADD_VX_BYTE] = true,
+    [OP_LD_VX_VY] = true,    [OP_OR_VX_VY] = true,    [OP_AND_VX_VY] = true,
+    [OP_XOR_VX_VY] = true,   [OP_ADD_VX_VY] = true,   [OP_SUB_VX_VY] = true,
+    [OP_SHR_VX] = true,      [OP_SUBN_VX_VY] = true,  [OP_SHL_VX] = true,
+    [OP_SNE_VX_VY] = true,   [OP_LD_I_ADDR] = true,   [OP_RND_VX_KK] = true,
+    [OP_LD_VX_DT] = true,    [OP_LD_DT_VX] = true,    [OP_LD_ST_VX] = true,
+    [OP_ADD_I_VX] = true,    [OP_LD_F_VX] = true,
+};
+
+/**
+ * @brief Checks if step_simd executes an operation under the quirk profile
+ * of the group.
+ *
+ * XO-CHIP skips step over all 4 bytes of F000 NNNN, which depends on the
+ * memory of each lane, so they run lane by lane.
+ *
+ * @param ls The group.
+ * @param op The decoded operation.
+ * @return true if the operation is executed with AVX2.
+ */
+static bool simd_op(const Lockstep *ls, Op op) {
+  if (quirk_profiles[ls->quirks].xochip) {
+    switch (op) {
+    case OP_SE_VX_BYTE:
+    case OP_SNE_VX_BYTE:
+    case OP_SE_VX_VY:
+    case OP_SNE_VX_VY:
+      return false;
+    default:
+      break;
+    }
+  }
+  return SIMD_OPS[op];
+}
+
+#ifdef LOCKSTEP_AVX2
+
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define STORE(p, v) _mm256_storeu_si256((__m256i *)(p), (v))
+
+// Writes v to the lanes selected by mask and leaves the others untouched
+__attribute__((target("avx2"))) static inline void
+store_lanes(void *p, __m256i v, __m256i mask) {
+  STORE(p, _mm256_blendv_epi8(LOAD(p), v, mask));
+}
+
+// Expands a bit per lane into a byte per lane, 0xFF for selected lanes
+__attribute__((target("avx2"))) static inline __m256i
+byte_mask(uint32_t lanes) {
+  const __m256i spread =
+      _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2,
+                       2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+  const __m256i bits = _mm256_set1_epi64x(0x8040201008040201);
+  __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(lanes), spread);
+  return _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits);
+}
+
+// Byte lanes 16 * half to 16 * half + 15 sign-extended to 16 bits
+__attribute__((target("avx2"))) static inline __m256i
+widen16(__m256i v, int half) {
+  return _mm256_cvtepi8_epi16(half ? _mm256_extracti128_si256(v, 1)
+                                   : _mm256_castsi256_si128(v));
+}
+
+// Byte lanes 16 * half to 16 * half + 15 zero-extended to 16 bits
+__attribute__((target("avx2"))) static inline __m256i
+widen16_unsigned(__m256i v, int half) {
+  return _mm256_cvtepu8_epi16(half ? _mm256_extracti128_si256(v, 1)
+                                   : _mm256_castsi256_si128(v));
+}
+
+// Byte lanes 8 * quarter to 8 * quarter + 7 sign-extended to 32 bits
+__attribute__((target("avx2"))) static inline __m256i
+widen32(__m256i v, int quarter) {
+  __m128i half = quarter < 2 ? _mm256_castsi256_si128(v)
+                             : _mm256_extracti128_si256(v, 1);
+  if (quarter & 1)
+    half = _mm_srli_si128(half, 8);
+  return _mm256_cvtepi8_epi32(half);
+}
+
+// Unsigned a > b per byte
+__attribute__((target("avx2"))) static inline __m256i
+greater_unsigned(__m256i a, __m256i b) {
+  const __m256i bias = _mm256_set1_epi8((char)0x80);
+  return _mm256_cmpgt_epi8(_mm256_xor_si256(a, bias),
+                           _mm256_xor_si256(b, bias));
+}
+
+// Lanes whose PC in the arrays is pc
+__attribute__((target("avx2"))) static uint32_t lanes_at_simd(Lockstep *ls,
+                                                              uint16_t pc) {
+  __m256i target = _mm256_set1_epi16(pc);
+  __m256i low = _mm256_cmpeq_epi16(LOAD(&ls->pc[0]), target);
+  __m256i high = _mm256_cmpeq_epi16(LOAD(&ls->pc[16]), target);
+  // Packing interleaves the 128-bit halves, the permute restores lane order
+  __m256i bytes = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high),
+                                           0xD8);
+  return _mm256_movemask_epi8(bytes);
+}
+
+/**
+ * @brief Executes one opcode in every selected lane with AVX2.
+ *
+ * Only operations on registers, I, the PC and the timers are handled here.
+ * Each one writes its results in the same order as its handler in
+ * instructions.c, re-reading registers after VF is set, so x or y = F
+ * behave exactly as they do there.
+ *
+ * @param ls The group, the registers of the selected lanes must be packed.
+ * @param opcode The opcode, the same in every selected lane, of one of the
+ * SIMD_OPS.
+ * @param lanes Bit l is set if lane l executes the opcode.
+ */
+__attribute__((target("avx2"))) static void
+step_simd(Lockstep *ls, uint16_t opcode, uint32_t lanes) {
+  const uint8_t x = (opcode & 0x0F00) >> 8;
+  const uint8_t y = (opcode & 0x00F0) >> 4;
+  const uint8_t kk = opcode & 0x00FF;
+  const uint16_t nnn = opcode & 0x0FFF;
+  const __m256i one = _mm256_set1_epi8(1);
+  const __m256i ones = _mm256_set1_epi8(-1);
+  __m256i mask = byte_mask(lanes);
+  __m256i vx = LOAD(ls->registers[x]);
+  __m256i vy = LOAD(ls->registers[y]);
+  __m256i skip = _mm256_setzero_si256();
+  uint8_t(*v)[LOCKSTEP_LANES] = ls->registers;
+  const Quirks *quirks = &quirk_profiles[ls->quirks];
+
+  switch (op_decode_table[opcode]) {
+  case OP_JP_ADDR:
+    for (int h = 0; h < 2; h++)
+      store_lanes(&ls->pc[16 * h], _mm256_set1_epi16(nnn), widen16(mask, h));
+    ls->simd_ops += __builtin_popcount(lanes);
+    return;
+  case OP_SE_VX_BYTE:
+    skip = _mm256_cmpeq_epi8(vx, _mm256_set1_epi8(kk));
+    break;
+  case OP_SNE_VX_BYTE:
+    skip = _mm256_xor_si256(_mm256_cmpeq_epi8(vx, _mm256_set1_epi8(kk)), ones);
+    break;
+  case OP_SE_VX_VY:
+    skip = _mm256_cmpeq_epi8(vx, vy);
+    break;
+  case OP_SNE_VX_VY:
+    skip = _mm256_xor_si256(_mm256_cmpeq_epi8(vx, vy), ones);
+    break;
+  case OP_LD_VX_BYTE:
+    store_lanes(v[x], _mm256_set1_epi8(kk), mask);
+    break;
+  case OP_ADD_VX_BYTE:
+    store_lanes(v[x], _mm256_add_epi8(vx, _mm256_set1_epi8(kk)), mask);
+    break;
+  case OP_LD_VX_VY:
+    store_lanes(v[x], vy, mask);
+    break;
+  case OP_OR_VX_VY:
+    store_lanes(v[x], _mm256_or_si256(vx, vy), mask);
+    if (quirks->vf_reset & (1 << 0x1))
+      store_lanes(v[0xF], _mm256_setzero_si256(), mask);
+    break;
+  case OP_AND_VX_VY:
+    store_lanes(v[x], _mm256_and_si256(vx, vy), mask);
+    if (quirks->vf_reset & (1 << 0x2))
+      store_lanes(v[0xF], _mm256_setzero_si256(), mask);
+    break;
+  case OP_XOR_VX_VY:
+    store_lanes(v[x], _mm256_xor_si256(vx, vy), mask);
+    if (quirks->vf_reset & (1 << 0x3))
+      store_lanes(v[0xF], _mm256_setzero_si256(), mask);
+    break;
+  case OP_ADD_VX_VY:
+    // Carry if Vx > 0xFF - Vy
+    store_lanes(v[0xF],
+                _mm256_and_si256(
+                    greater_unsigned(vx, _mm256_xor_si256(vy, ones)), one),
+                mask);
+    store_lanes(v[x], _mm256_add_epi8(LOAD(v[x]), LOAD(v[y])), mask);
+    break;
+  case OP_SUB_VX_VY:
+    store_lanes(v[0xF], _mm256_and_si256(greater_unsigned(vx, vy), one), mask);
+    store_lanes(v[x], _mm256_sub_epi8(LOAD(v[x]), LOAD(v[y])), mask);
+    break;
+  case OP_SHR_VX:
+    if (quirks->shift_vy) {
+      store_lanes(v[x], vy, mask);
+      vx = LOAD(v[x]);
+    }
+    store_lanes(v[0xF], _mm256_and_si256(vx, one), mask);
+    store_lanes(v[x],
+                _mm256_and_si256(_mm256_srli_epi16(LOAD(v[x]), 1),
+                                 _mm256_set1_epi8(0x7F)),
+                mask);
+    break;
+  case OP_SUBN_VX_VY:
+    store_lanes(v[0xF], _mm256_and_si256(greater_unsigned(vy, vx), one), mask);
+    store_lanes(v[x], _mm256_sub_epi8(LOAD(v[y]), LOAD(v[x])), mask);
+    break;
+  case OP_SHL_VX:
+    if (quirks->shift_vy) {
+      store_lanes(v[x], vy, mask);
+      vx = LOAD(v[x]);
+    }
+    store_lanes(v[0xF], _mm256_and_si256(_mm256_srli_epi16(vx, 7), one),
+                mask);
+    store_lanes(v[x], _mm256_add_epi8(LOAD(v[x]), LOAD(v[x])), mask);
+    break;
+  case OP_LD_I_ADDR:
+    for (int h = 0; h < 2; h++)
+      store_lanes(&ls->IRegister[16 * h], _mm256_set1_epi16(nnn),
+                  widen16(mask, h));
+    break;
+  case OP_ADD_I_VX:
+    for (int h = 0; h < 2; h++)
+      store_lanes(&ls->IRegister[16 * h],
+                  _mm256_add_epi16(LOAD(&ls->IRegister[16 * h]),
+                                   widen16_unsigned(vx, h)),
+                  widen16(mask, h));
+    break;
+  case OP_LD_F_VX:
+    for (int h = 0; h < 2; h++) {
+      __m256i digit = widen16_unsigned(vx, h);
+      store_lanes(&ls->IRegister[16 * h],
+                  _mm256_add_epi16(_mm256_slli_epi16(digit, 2), digit),
+                  widen16(mask, h));
+    }
+    break;
+  case OP_RND_VX_KK: {
+    // xorshift32 as in next_random, eight lanes per register
+    __m256i top[4];
+    for (int q = 0; q < 4; q++) {
+      __m256i s = LOAD(&ls->rng_state[8 * q]);
+      s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 13));
+      s = _mm256_xor_si256(s, _mm256_srli_epi32(s, 17));
+      s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 5));
+      store_lanes(&ls->rng_state[8 * q], s, widen32(mask, q));
+      top[q] = _mm256_srli_epi32(s, 24);
+    }
+    // Packing works within 128-bit halves, the permute restores lane order
+    __m256i bytes =
+        _mm256_packus_epi16(_mm256_packus_epi32(top[0], top[1]),
+                            _mm256_packus_epi32(top[2], top[3]));
+    bytes = _mm256_permutevar8x32_epi32(
+        bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    store_lanes(v[x], _mm256_and_si256(bytes, _mm256_set1_epi8(kk)), mask);
+    break;
+  }
+  case OP_LD_VX_DT:
+    store_lanes(v[x], LOAD(ls->delay_timer), mask);
+    break;
+  case OP_LD_DT_VX:
+    store_lanes(ls->delay_timer, vx, mask);
+    break;
+  case OP_LD_ST_VX:
+    store_lanes(ls->sound_timer, vx, mask);
+    break;
+  default:
+    return;
+  }
+
+  // PC += 2, or 4 in lanes that skip
+  for (int h = 0; h < 2; h++) {
+    __m256i step = _mm256_add_epi16(
+        _mm256_set1_epi16(2),
+        _mm256_and_si256(widen16(skip, h), _mm256_set1_epi16(2)));
+    store_lanes(&ls->pc[16 * h],
+                _mm256_add_epi16(LOAD(&ls->pc[16 * h]), step),
+                widen16(mask, h));
+  }
+
+  ls->simd_ops += __builtin_popcount(lanes);
+}
+
+bool lockstep_simd_supported(void) { return __builtin_cpu_supports("avx2"); }
+
+#else
+
+static uint32_t lanes_at_simd(Lockstep *ls, uint16_t pc) {
+  (void)ls;
+  (void)pc;
+  return 0;
+}
+
+static void step_simd(Lockstep *ls, uint16_t opcode, uint32_t lanes) {
+  (void)ls;
+  (void)opcode;
+  (void)lanes;
+}
+
+bool lockstep_simd_supported(void) { return false; }
+
+#endif
+
+Lockstep *lockstep_create(int lane_count, bool verify) {
+  Lockstep *ls = NULL;
+
+  if (lane_count < 1 || lane_count > LOCKSTEP_LANES) {
+    log_error("Invalid number of lockstep lanes: %d", lane_count);
+    return NULL;
+  }
+
+  ls = calloc(1, sizeof(Lockstep));
+  if (ls == NULL) {
+    log_error("Error: Failed to allocate memory for lockstep lanes.");
+    return NULL;
+  }
+
+  ls->lane_count = lane_count;
+  ls->simd = lockstep_simd_supported();
+  ls->verify = verify;
+  for (int l = 0; l < lane_count; l++) {
+    ls->lanes[l] = initialize();
+    if (ls->lanes[l] == NULL ||
+        (verify && (ls->shadows[l] = initialize()) == NULL)) {
+      lockstep_destroy(ls);
+      return NULL;
+    }
+    store_lane(ls, l);
+  }
+  memcpy(ls->image, ls->lanes[0]->memory, MEMORY_SIZE);
+
+  return ls;
+}
+
+void lockstep_destroy(Lockstep *ls) {
+  if (ls == NULL)
+    return;
+  for (int l = 0; l < ls->lane_count; l++) {
+    destroy(ls->lanes[l]);
+    destroy(ls->shadows[l]);
+  }
+  free(ls);
+}
+
+int lockstep_set_quirks(Lockstep *ls, QuirkProfile profile) {
+  ls->quirks = profile;
+  for (int l = 0; l < ls->lane_count; l++) {
+    if (set_quirks(ls->lanes[l], profile) != SUCCESS)
+      return ERR;
+    if (ls->verify && set_quirks(ls->shadows[l], profile) != SUCCESS)
+      return ERR;
+  }
+
+  // The profile decides whether the large font is in memory
+  memcpy(ls->image, ls->lanes[0]->memory, MEMORY_SIZE);
+  return SUCCESS;
+}
+
+int lockstep_load_rom(Lockstep *ls, const uint8_t *data, size_t size) {
+  for (int l = 0; l < ls->lane_count; l++) {
+    if (load_rom_data(ls->lanes[l], data, size) != SUCCESS)
+      return ERR;
+    if (ls->verify && load_rom_data(ls->shadows[l], data, size) != SUCCESS)
+      return ERR;
+  }
+
+  // Every lane got the same bytes, pages a lane wrote to stay its own. The
+  // image only covers the first 4 KB, XO-CHIP code above it is fetched
+  // from each lane.
+  if (size > MEMORY_SIZE - PROGRAM_MEM)
+    size = MEMORY_SIZE - PROGRAM_MEM;
+  memcpy(&ls->image[PROGRAM_MEM], data, size);
+  return SUCCESS;
+}
+
+int lockstep_load_state(Lockstep *ls, const uint8_t *data, size_t size) {
+  for (int l = 0; l < ls->lane_count; l++) {
+    if (load_state(ls->lanes[l], data, size) != SUCCESS)
+      return ERR;
+    if (ls->verify && load_state(ls->shadows[l], data, size) != SUCCESS)
+      return ERR;
+    store_lane(ls, l);
+  }
+
+  // Every lane has the memory of the state now
+  ls->unpacked = 0;
+  memset(ls->written, 0, sizeof(ls->written));
+  memcpy(ls->image, ls->lanes[0]->memory, MEMORY_SIZE);
+  return SUCCESS;
+}
+
+void lockstep_seed(Lockstep *ls, int lane, uint32_t seed) {
+  seed_random(ls->lanes[lane], seed);
+  ls->rng_state[lane] = ls->lanes[lane]->rng_state;
+  if (ls->verify)
+    seed_random(ls->shadows[lane], seed);
+}
+
+Chip8 *lockstep_lane(Lockstep *ls, int lane) {
+  unpack_lane(ls, lane);
+  return ls->lanes[lane];
+}
+
+/**
+ * @brief Checks a lane against its scalar run after every instruction.
+ *
+ * Registers, and memory and the display through their running hashes, are
+ * compared on every step, the stack and keypad too once per frame.
+ *
+ * @param ls The group.
+ * @param lane The lane.
+ * @param full Compare the whole machine state.
+ * @return Status of the operation (0 -> Match, 1 -> Diverged).
+ */
+static int verify_lane(Lockstep *ls, int lane, bool full) {
+  pack_lane(ls, lane);
+  const Chip8 *lane_c8 = ls->lanes[lane];
+  const Chip8 *shadow = ls->shadows[lane];
+  bool match = ls->IRegister[lane] == shadow->IRegister &&
+               ls->pc[lane] == shadow->pc &&
+               ls->delay_timer[lane] == shadow->delay_timer &&
+               ls->sound_timer[lane] == shadow->sound_timer &&
+               ls->rng_state[lane] == shadow->rng_state &&
+               lane_c8->sp == shadow->sp;
+
+  for (int r = 0; r < 16; r++)
+    match = match && ls->registers[r][lane] == shadow->registers[r];
+  match = match && lane_c8->memory_zobrist == shadow->memory_zobrist &&
+          lane_c8->display_zobrist == shadow->display_zobrist;
+
+  if (match && full)
+    match = machine_hash(lockstep_lane(ls, lane)) == machine_hash(shadow);
+
+  if (!match) {
+    log_error("Lockstep lane %d diverged from its scalar run (PC %03X, "
+              "scalar PC %03X)",
+              lane, ls->pc[lane], shadow->pc);
+    return ERR;
+  }
+  return SUCCESS;
+}
+
+// Lanes whose Chip8 is running
+static uint32_t running_lanes(const Lockstep *ls) {
+  uint32_t running = 0;
+  for (int l = 0; l < ls->lane_count; l++) {
+    if (ls->lanes[l]->running)
+      running |= 1u << l;
+  }
+  return running;
+}
+
+// Opcode at pc in the memory of a lane
+static uint16_t lane_opcode(const Chip8 *c8, uint16_t pc) {
+  return (read_memory(c8, pc) << 8) | read_memory(c8, pc + 1);
+}
+
+/**
+ * @brief Finds the pending lanes that execute the same opcode as a leader.
+ *
+ * Lanes that never wrote to the memory around the PC share the opcode of
+ * the loaded image, so only the others are fetched from one by one.
+ *
+ * @param ls The group.
+ * @param leader The lane to match.
+ * @param pending The lanes still to step.
+ * @param opcode Set to the opcode of the leader.
+ * @return The lanes at the leader's PC that fetch the same opcode.
+ */
+static uint32_t group_with(Lockstep *ls, int leader, uint32_t pending,
+                           uint16_t *opcode) {
+  uint16_t pc = LANE_PC(ls, leader);
+  uint32_t at_pc = 0;
+  uint32_t group = 0;
+  uint32_t own_code = ~0u;
+
+  // Packed lanes are compared all at once, unpacked ones one by one
+  uint32_t scan = pending;
+  if (ls->simd) {
+    at_pc = lanes_at_simd(ls, pc) & pending & ~ls->unpacked;
+    scan = pending & ls->unpacked;
+  }
+  for (uint32_t rest = scan; rest; rest &= rest - 1) {
+    int l = __builtin_ctz(rest);
+    if (LANE_PC(ls, l) == pc)
+      at_pc |= 1u << l;
+  }
+
+  if (pc + 1 < MEMORY_SIZE)
+    own_code = ls->written[pc / LOCKSTEP_PAGE_SIZE] |
+               ls->written[(pc + 1) / LOCKSTEP_PAGE_SIZE];
+
+  *opcode = own_code & (1u << leader)
+                ? lane_opcode(ls->lanes[leader], pc)
+                : (ls->image[pc] << 8) | ls->image[pc + 1];
+
+  // Past the image every lane counts as having code of its own
+  if (pc + 1 < MEMORY_SIZE &&
+      ((ls->image[pc] << 8) | ls->image[pc + 1]) == *opcode)
+    group = at_pc & ~own_code;
+  for (uint32_t rest = at_pc & own_code; rest; rest &= rest - 1) {
+    int l = __builtin_ctz(rest);
+    if (lane_opcode(ls->lanes[l], pc) == *opcode)
+      group |= 1u << l;
+  }
+  return group;
+}
+
+/**
+ * @brief Executes one instruction in the given lanes.
+ *
+ * Lanes are grouped by PC, taking the lowest pending lane as the leader of
+ * each group. A group executes its opcode together; a group of one, or an
+ * operation that touches memory, the stack, the display or the keypad,
+ * falls back to stepping lane by lane with the handlers from
+ * instructions.c.
+ *
+ * @param ls The group.
+ * @param running The lanes to step.
+ * @return Status of the operation (1 -> a lane diverged from its scalar run).
+ */
+static int step_lanes(Lockstep *ls, uint32_t running) {
+  uint32_t pending = running;
+
+  while (pending) {
+    uint16_t opcode;
+    uint32_t group = group_with(ls, __builtin_ctz(pending), pending, &opcode);
+    pending &= ~group;
+
+    if (ls->simd && (group & (group - 1)) &&
+        simd_op(ls, op_decode_table[opcode])) {
+      for (uint32_t rest = group & ls->unpacked; rest; rest &= rest - 1)
+        pack_lane(ls, __builtin_ctz(rest));
+      step_simd(ls, opcode, group);
+    } else {
+      for (uint32_t rest = group; rest; rest &= rest - 1)
+        step_scalar(ls, __builtin_ctz(rest));
+    }
+  }
+
+  if (ls->verify) {
+    for (uint32_t rest = running; rest; rest &= rest - 1) {
+      int l = __builtin_ctz(rest);
+      cycle_cpu(ls->shadows[l], 1);
+      if (verify_lane(ls, l, false) != SUCCESS)
+        return ERR;
+    }
+  }
+
+  return SUCCESS;
+}
+
+int lockstep_step(Lockstep *ls) { return step_lanes(ls, running_lanes(ls)); }
+
+int lockstep_run_frame(Lockstep *ls, int max_cycles) {
+  if (ls->verify) {
+    for (int l = 0; l < ls->lane_count; l++)
+      memcpy(ls->shadows[l]->keypad, ls->lanes[l]->keypad,
+             sizeof(ls->lanes[l]->keypad));
+  }
+
+  // 00FD only runs lane by lane, which reports the lanes it stops
+  uint32_t started = running_lanes(ls);
+  uint32_t running = started;
+  ls->stopped = 0;
+  for (int cycle = 0; cycle < max_cycles && running; cycle++) {
+    if (step_lanes(ls, running) != SUCCESS)
+      return ERR;
+    for (uint32_t rest = running & ls->stopped; rest; rest &= rest - 1)
+      ls->cycles[__builtin_ctz(rest)] += cycle + 1;
+    running &= ~ls->stopped;
+  }
+  for (uint32_t rest = running; rest; rest &= rest - 1)
+    ls->cycles[__builtin_ctz(rest)] += max_cycles;
+
+  // Same as update_timers, for every lane that ran, a stopped lane is left
+  // as it is like the instance of a batch job
+  for (uint32_t rest = started; rest; rest &= rest - 1) {
+    int l = __builtin_ctz(rest);
+    pack_lane(ls, l);
+    if (ls->delay_timer[l] > 0)
+      ls->delay_timer[l]--;
+    if (ls->sound_timer[l] > 0)
+      ls->sound_timer[l]--;
+  }
+
+  if (ls->verify) {
+    for (int l = 0; l < ls->lane_count; l++) {
+      if (started & (1u << l))
+        update_timers(ls->shadows[l]);
+      if (verify_lane(ls, l, true) != SUCCESS)
+        return ERR;
+    }
+  }
+
+  return SUCCESS;
+}
\ No newline at end of file
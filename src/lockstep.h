@@ -0,0 +1,113 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "chip8_types.h"
+
+// Maximum number of instances stepped together, one AVX2 register of bytes
+#define LOCKSTEP_LANES 32
+// Granularity at which writes to lane memory are tracked
+#define LOCKSTEP_PAGE_SIZE 64
+#define LOCKSTEP_PAGES (MEMORY_SIZE / LOCKSTEP_PAGE_SIZE)
+
+/*
+ * Many instances of the same program stepped one instruction at a time.
+ *
+ * State read by the same instruction in every lane is stored as
+ * structure-of-arrays, lane l of register r at registers[r][l], so lanes
+ * that share a PC execute an opcode together with AVX2. Memory, the stack,
+ * the display and the keypad are indexed by lane-specific values, so each
+ * lane keeps those in a Chip8 of its own. A lane stepped on its own has its
+ * registers moved into that Chip8 until it joins a SIMD step again.
+ */
+typedef struct {
+  uint8_t registers[16][LOCKSTEP_LANES];
+  uint16_t IRegister[LOCKSTEP_LANES];
+  uint16_t pc[LOCKSTEP_LANES];
+  uint8_t delay_timer[LOCKSTEP_LANES];
+  uint8_t sound_timer[LOCKSTEP_LANES];
+  uint32_t rng_state[LOCKSTEP_LANES];
+  Chip8 *lanes[LOCKSTEP_LANES];
+  uint32_t unpacked; // Bit l is set if lane l's registers are in its Chip8
+  uint32_t stopped;  // Bit l is set if lane l stopped during the last step
+  int lane_count;
+
+  // Memory as loaded, the same in every lane until a lane writes to it
+  uint8_t image[MEMORY_SIZE];
+  uint32_t written[LOCKSTEP_PAGES]; // Bit l is set if lane l wrote the page
+
+  bool simd; // Execute shared opcodes with AVX2, false steps lanes one by one
+  QuirkProfile quirks; // Quirk profile of every lane
+
+  // Verification: every lane is also run on a scalar Chip8 and compared
+  Chip8 *shadows[LOCKSTEP_LANES];
+  bool verify;
+
+  // Instructions executed per lane by the SIMD and the scalar path
+  uint64_t simd_ops;
+  uint64_t scalar_ops;
+  // Instructions each lane executed in lockstep_run_frame, up to its 00FD
+  uint64_t cycles[LOCKSTEP_LANES];
+} Lockstep;
+
+/// @brief Checks if the host can execute lanes with AVX2
+/// @return true on x86-64 hosts with AVX2
+bool lockstep_simd_supported(void);
+
+/// @brief Allocates a group of lanes in their reset state
+/// @param lane_count The number of lanes, 1 to LOCKSTEP_LANES
+/// @param verify Check every lane against a scalar Chip8 while running
+/// @return The group, or NULL if lane_count is invalid or allocation fails
+Lockstep *lockstep_create(int lane_count, bool verify);
+
+/// @brief Frees a group and all of its lanes
+/// @param ls The group to free
+void lockstep_destroy(Lockstep *ls);
+
+/// @brief Select the quirk profile of every lane, before anything is loaded
+/// @param ls The group
+/// @param profile The quirk profile
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int lockstep_set_quirks(Lockstep *ls, QuirkProfile profile);
+
+/// @brief Copy a ROM image into the memory of every lane
+/// @param ls The group
+/// @param data The ROM image
+/// @param size The size of the ROM image in bytes
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int lockstep_load_rom(Lockstep *ls, const uint8_t *data, size_t size);
+
+/// @brief Restore every lane from the same save state
+/// @param ls The group
+/// @param data The save state
+/// @param size The size of the save state in bytes
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int lockstep_load_state(Lockstep *ls, const uint8_t *data, size_t size);
+
+/// @brief Seed the random number generator of one lane
+/// @param ls The group
+/// @param lane The lane to seed
+/// @param seed The seed, as for seed_random
+void lockstep_seed(Lockstep *ls, int lane, uint32_t seed);
+
+/// @brief Get the Chip8 of a lane with its registers brought up to date
+/// Its keypad may be changed to feed input to the lane, its registers must
+/// only be read.
+/// @param ls The group
+/// @param lane The lane
+/// @return The Chip8 of the lane
+Chip8 *lockstep_lane(Lockstep *ls, int lane);
+
+/// @brief Executes one instruction in every running lane
+/// @param ls The group
+/// @return Status of the operation (1 -> a lane diverged from its scalar run)
+int lockstep_step(Lockstep *ls);
+
+/// @brief Emulates one 60 Hz frame in every lane
+/// A lane that executes 00FD stops there, adding only the instructions it
+/// executed to its count in cycles; a stopped lane is left as it is.
+/// @param ls The group
+/// @param max_cycles The number of instructions to execute
+/// @return Status of the operation (1 -> a lane diverged from its scalar run)
+int lockstep_run_frame(Lockstep *ls, int max_cycles);
+
+#endif
\ No newline at end of file
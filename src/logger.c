@@ -1,69 +1,204 @@
 #include "logger.h"
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <time.h>
 
-int logger_enabled = 0;
+#define SLOT_MASK (LOG_SLOTS - 1)
+// Bytes collected per stream before a batch is written
+#define BATCH_SIZE 65536
+// How long the writer sleeps when the ring is empty
+#define IDLE_NANOSECONDS 2000000
 
-char *fmt(const char *fmt, ...) {
-  va_list args;
-  va_list args_copy;
-  int len;
-  char *msg = NULL;
+typedef struct {
+  // Equals the position of the slot once it can be claimed for that
+  // position, and the position + 1 once its message is ready
+  _Atomic uint64_t sequence;
+  int level;
+  char message[LOG_MESSAGE_SIZE];
+} LogSlot;
+
+// Errors are always shown, the rest once logger_init is called
+atomic_int log_threshold = LOG_LEVEL_ERROR;
+
+static LogSlot slots[LOG_SLOTS];
+static _Atomic uint64_t head; // Next position claimed by a logging thread
+static _Atomic uint64_t tail; // Next position written by the writer
+static atomic_ulong dropped;
+static atomic_bool stopping;
+static atomic_bool writer_failed; // Set if the writer thread did not start
+static pthread_t writer;
+static pthread_once_t started = PTHREAD_ONCE_INIT;
+
+static const char *const PREFIXES[] = {
+    "\033[96m Debug: ",
+    "\033[92m Info: ",
+    "\033[93m Warning: ",
+    "\033[95m Error: ",
+};
 
-  // Start argument processing
-  va_start(args, fmt);
+// Bytes waiting to be written to one stream
+typedef struct {
+  FILE *stream;
+  size_t used;
+  char data[BATCH_SIZE];
+} Batch;
 
-  // Make a copy of args for later reuse
-  va_copy(args_copy, args);
+static void batch_write(Batch *batch) {
+  if (batch->used == 0)
+    return;
+  fwrite(batch->data, 1, batch->used, batch->stream);
+  fflush(batch->stream);
+  batch->used = 0;
+}
+
+static void batch_append(Batch *batch, int level, const char *message) {
+  if (BATCH_SIZE - batch->used < LOG_MESSAGE_SIZE + 32)
+    batch_write(batch);
+  int len = snprintf(batch->data + batch->used, BATCH_SIZE - batch->used,
+                     "%s%s \033[0m\n", PREFIXES[level], message);
+  if (len > 0)
+    batch->used += len;
+}
 
-  // Get the required length for the formatted string
-  len = vsnprintf(NULL, 0, fmt, args_copy);
-  va_end(args_copy);
+/**
+ * @brief Writes every message that is ready, in order.
+ *
+ * Info and debug messages go to stdout, warnings and errors to stderr,
+ * each stream in as few writes as possible.
+ *
+ * @param out The batch for stdout.
+ * @param err The batch for stderr.
+ * @return The number of messages written.
+ */
+static int drain(Batch *out, Batch *err) {
+  uint64_t pos = atomic_load_explicit(&tail, memory_order_relaxed);
+  int count = 0;
 
-  if (len < 0) {
-    // Error in vsnprintf (invalid format or other issues)
-    va_end(args);
-    return NULL;
+  for (;; pos++, count++) {
+    LogSlot *slot = &slots[pos & SLOT_MASK];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != pos + 1)
+      break;
+
+    Batch *batch = slot->level >= LOG_LEVEL_WARNING ? err : out;
+    batch_append(batch, slot->level, slot->message);
+
+    // Hand the slot back for the position one lap ahead
+    atomic_store_explicit(&slot->sequence, pos + LOG_SLOTS,
+                          memory_order_release);
   }
 
-  // Allocate memory for the formatted string (+1 for null terminator)
-  msg = (char *)malloc(len + 1);
-  if (msg == NULL) {
-    // Memory allocation failed
-    va_end(args);
-    return NULL;
+  // Drops are reported once, where they happened
+  static unsigned long reported;
+  unsigned long total = atomic_load_explicit(&dropped, memory_order_relaxed);
+  if (total > reported) {
+    char message[64];
+    snprintf(message, sizeof(message), "%lu log messages dropped",
+             total - reported);
+    reported = total;
+    batch_append(err, LOG_LEVEL_WARNING, message);
   }
 
-  // Now actually format the string into the allocated memory
-  if (vsnprintf(msg, len + 1, fmt, args) < 0) {
-    // Error in vsnprintf
-    free(msg); // Free the allocated memory before returning
-    va_end(args);
-    return NULL;
+  batch_write(out);
+  batch_write(err);
+  atomic_store_explicit(&tail, pos, memory_order_release);
+  return count;
+}
+
+static void *writer_main(void *arg) {
+  (void)arg;
+  static Batch out, err;
+  out.stream = stdout;
+  err.stream = stderr;
+
+  while (!atomic_load(&stopping)) {
+    if (drain(&out, &err) == 0) {
+      struct timespec idle = {0, IDLE_NANOSECONDS};
+      nanosleep(&idle, NULL);
+    }
   }
+  drain(&out, &err);
+  return NULL;
+}
 
-  // End argument processing
-  va_end(args);
+// Writes what is left and stops the writer when the program exits
+static void stop_writer(void) {
+  atomic_store(&stopping, true);
+  pthread_join(writer, NULL);
+}
 
-  return msg;
+static void start_writer(void) {
+  for (uint64_t i = 0; i < LOG_SLOTS; i++)
+    atomic_init(&slots[i].sequence, i);
+  if (pthread_create(&writer, NULL, writer_main, NULL) == 0)
+    atexit(stop_writer);
+  else {
+    atomic_store(&writer_failed, true);
+    fprintf(stderr, "Failed to start the log writer\n");
+  }
 }
 
-int logger_init() {
-  logger_enabled = 1;
-  printf("Logger initialised...\n");
+int logger_init(void) {
+  log_set_level(LOG_LEVEL_INFO);
+  log_info("Logger initialised...");
   return 0;
 }
 
-void log_info(char *message) {
-  if (logger_enabled)
-    printf("\033[92m Info: %s \033[0m\n", message);
-}
+void log_set_level(int level) { atomic_store(&log_threshold, level); }
+
+void log_write(int level, const char *format, ...) {
+  pthread_once(&started, start_writer);
+
+  // Claim the next position, unless the writer has not freed its slot yet
+  uint64_t pos = atomic_load_explicit(&head, memory_order_relaxed);
+  LogSlot *slot;
+  for (;;) {
+    slot = &slots[pos & SLOT_MASK];
+    uint64_t sequence =
+        atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (sequence == pos) {
+      if (atomic_compare_exchange_weak_explicit(&head, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed))
+        break;
+    } else if (sequence < pos) {
+      atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+      return;
+    } else {
+      pos = atomic_load_explicit(&head, memory_order_relaxed);
+    }
+  }
 
-void log_error(char *message) {
-  fprintf(stderr, "\033[95m Error: %s \033[0m\n", message);
+  va_list args;
+  va_start(args, format);
+  vsnprintf(slot->message, LOG_MESSAGE_SIZE, format, args);
+  va_end(args);
+  slot->level = level;
+  atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
 }
 
-void log_warning(char *message) {
-  if (logger_enabled)
-    fprintf(stderr, "\033[93m Warning: %s \033[0m\n", message);
+void log_flush(void) {
+  uint64_t end = atomic_load(&head);
+  struct timespec idle = {0, IDLE_NANOSECONDS / 4};
+
+  pthread_once(&started, start_writer);
+  if (atomic_load(&writer_failed)) {
+    // Nothing else writes the ring, so drain it here, one caller at a time
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    static Batch out, err;
+    pthread_mutex_lock(&lock);
+    out.stream = stdout;
+    err.stream = stderr;
+    while (atomic_load_explicit(&tail, memory_order_relaxed) < end) {
+      if (drain(&out, &err) == 0)
+        nanosleep(&idle, NULL);
+    }
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+  while (atomic_load_explicit(&tail, memory_order_acquire) < end)
+    nanosleep(&idle, NULL);
 }
+
+unsigned long log_dropped(void) { return atomic_load(&dropped); }
\ No newline at end of file
@@ -1,13 +1,71 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 
-char *fmt(const char *fmt, ...);
-int logger_init();
-void log_error(char *msg);
-void log_info(char *msg);
-void log_warning(char *msg);
+// Severity of a message, a level shows messages at or above it
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+// Messages below this level are compiled out, e.g. -DLOG_COMPILE_LEVEL=3
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Messages longer than this are cut short
+#define LOG_MESSAGE_SIZE 248
+// Messages that can wait to be written, a power of 2
+#define LOG_SLOTS 1024
+
+/*
+ * Messages are formatted straight into a preallocated ring of slots that
+ * any number of threads fill without locks, and written out in batches by
+ * a background thread. A message that finds the ring full is dropped and
+ * counted rather than blocking the thread that logs it.
+ */
+
+// Lowest level shown, read on every log call
+extern atomic_int log_threshold;
+
+// The level check comes first, so the arguments of a message that is not
+// shown are never evaluated
+#define LOG_AT(level, ...)                                                     \
+  do {                                                                         \
+    if ((level) >= LOG_COMPILE_LEVEL &&                                        \
+        (level) >= atomic_load_explicit(&log_threshold, memory_order_relaxed)) \
+      log_write((level), __VA_ARGS__);                                         \
+  } while (0)
+
+#define log_debug(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define log_info(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define log_warning(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define log_error(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+/// @brief Show info messages and warnings as well as errors
+/// @return Status of the operation (0 -> Success)
+int logger_init(void);
+
+/// @brief Set the lowest level of the messages shown
+/// @param level One of the LOG_LEVEL_ values
+void log_set_level(int level);
+
+/// @brief Queue a message, use the log_ macros instead
+/// @param level The level of the message
+/// @param format A printf format string, followed by its arguments
+void log_write(int level, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/// @brief Wait until every message queued so far is written
+/// If the writer thread could not be started, the caller writes them.
+void log_flush(void);
+
+/// @brief Get the number of messages dropped because the ring was full
+/// @return The number of messages dropped since startup
+unsigned long log_dropped(void);
 
 #endif
\ No newline at end of file
@@ -1,65 +1,292 @@
 #include "chip8.h"
 #include "debug.h"
-#include "keypad.h"
-#include "screen.h"
-#include "speaker.h"
+#include "headless.h"
+#include "movie.h"
+#include "profile.h"
+#include "rewind.h"
+#include "savestate.h"
+#include "scheduler.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#ifndef HEADLESS
+#include "emulator.h"
+#include "keypad.h"
+#include "screen.h"
+#include "speaker.h"
+#endif
+
+// Seconds of rewind history kept in a window unless --rewind says otherwise
+#define DEFAULT_REWIND_SECONDS 60
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s <rom> [-d : Debug mode] [--headless] [--cycles N] "
+          "[--frames N] [--cpu interpreter|cached|jit] [--load-state FILE] "
+          "[--save-state FILE] [--rewind SECONDS] [--seed N] [--record FILE] "
+          "[--replay FILE] [--ips N] [--turbo N] [--trace FILE] "
+          "[--profile FILE] [--quirks default|vip|chip48|schip|xochip]\n",
+          prog);
+}
+
+#ifndef HEADLESS
+/**
+ * Runs the emulation on its own thread and renders it in a raylib window
+ * until the user quits
+ *
+ * @param emu The emulation to run
+ * @param fps Frame rate of the window, independent of the emulated rate
+ * @param turbo Start in turbo mode
+ * @return Status of the operation (0 -> Success, 1 -> Error)
+ */
+static int run_windowed(Emulation *emu, int fps, bool turbo) {
+  init_screen(640, 480, fps);
+  int status = emulation_start(emu, turbo);
+  if (status == SUCCESS) {
+    init_speaker(&emu->sound);
+    log_info("System initialised...");
+
+    // Render loop, the newest finished frame is uploaded whenever there is
+    // one
+    while (emulation_running(emu)) {
+      const Frame *frame = frame_exchange_acquire(&emu->frames);
+      bool changed = frame != NULL &&
+                     update_screen(frame->rows, frame->hires, frame->dirty);
+
+      // Nothing is presented while the picture stays the same, including
+      // when a sprite was drawn and erased within the frame
+      if (changed || screen_needs_redraw()) {
+        BeginDrawing();
+        draw_screen();
+        EndDrawing();
+      } else {
+        PollInputEvents();
+        WaitTime(1.0 / fps);
+      }
+      handle_input(&emu->controls);
+    }
+    emulation_stop(emu);
+    close_speaker();
+  }
+
+  close_screen();
+  return status;
+}
+#endif
 
 int main(int argc, char **argv) {
   char *rom_filename = NULL;
+  const char *load_state_filename = NULL, *save_state_filename = NULL;
+  const char *record_filename = NULL, *replay_filename = NULL;
+  const char *trace_filename = NULL;
+#ifdef CHIP8_PROFILE
+  const char *profile_filename = "profile.json";
+#endif
+  uint32_t seed = 1, ips = DEFAULT_IPS;
+#ifndef HEADLESS
+  double turbo_speed = 0;
+  bool turbo = false;
+#endif
+  uint64_t max_cycles = 0, max_frames = 0;
+  int rewind_seconds = -1;
+  CpuMode mode = CPU_INTERPRETER;
+  QuirkProfile quirks = QUIRKS_DEFAULT;
+#ifdef HEADLESS
+  bool headless = true;
+#else
+  bool headless = false;
+#endif
+
   if (argc < 2) {
     fprintf(stderr, "Not enough arguments provided...\n");
-    fprintf(stderr, "Usage: %s <rom> [-d : Debug mode]\n", argv[0]);
+    usage(argv[0]);
     return ERR;
   }
 
-  // Initialize debugger
-  if (argc > 2) {
-    if (strcmp(argv[2], "-d") == 0) {
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-d") == 0) {
+      // Initialize debugger
       debugger_init();
       logger_init();
+    } else if (strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      max_cycles = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      max_frames = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--load-state") == 0 && i + 1 < argc) {
+      load_state_filename = argv[++i];
+    } else if (strcmp(argv[i], "--save-state") == 0 && i + 1 < argc) {
+      save_state_filename = argv[++i];
+    } else if (strcmp(argv[i], "--ips") == 0 && i + 1 < argc) {
+      ips = strtoul(argv[++i], NULL, 10);
+      if (ips == 0) {
+        fprintf(stderr, "Instructions per second must be positive\n");
+        usage(argv[0]);
+        return ERR;
+      }
+    } else if (strcmp(argv[i], "--turbo") == 0 && i + 1 < argc) {
+#ifndef HEADLESS
+      turbo_speed = strtod(argv[++i], NULL);
+      turbo = true;
+      if (turbo_speed < 0) {
+        fprintf(stderr, "Turbo speed must not be negative\n");
+        usage(argv[0]);
+        return ERR;
+      }
+#else
+      fprintf(stderr, "Headless runs are not throttled, --turbo needs the "
+                      "windowed build\n");
+      return ERR;
+#endif
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_filename = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay_filename = argv[++i];
+      headless = true;
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_filename = argv[++i];
+    } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+#ifdef CHIP8_PROFILE
+      profile_filename = argv[++i];
+#else
+      fprintf(stderr, "Profiling is not built in, build with PROFILE=1\n");
+      return ERR;
+#endif
+    } else if (strcmp(argv[i], "--rewind") == 0 && i + 1 < argc) {
+      rewind_seconds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      if (parse_quirks(argv[++i], &quirks) != SUCCESS) {
+        fprintf(stderr, "Unknown quirk profile: %s\n", argv[i]);
+        usage(argv[0]);
+        return ERR;
+      }
+    } else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "interpreter") == 0) {
+        mode = CPU_INTERPRETER;
+      } else if (strcmp(argv[i], "cached") == 0) {
+        mode = CPU_CACHED;
+      } else if (strcmp(argv[i], "jit") == 0) {
+        mode = CPU_JIT;
+      } else {
+        fprintf(stderr, "Unknown CPU mode: %s\n", argv[i]);
+        usage(argv[0]);
+        return ERR;
+      }
+    } else {
+      fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+      usage(argv[0]);
+      return ERR;
     }
   }
 
+  if (headless && replay_filename == NULL && max_cycles == 0 &&
+      max_frames == 0) {
+    fprintf(stderr, "Headless mode requires --cycles, --frames or --replay\n");
+    usage(argv[0]);
+    return ERR;
+  }
+  if (headless && record_filename != NULL) {
+    fprintf(stderr, "Recording requires a window\n");
+    usage(argv[0]);
+    return ERR;
+  }
+
+  // A replay starts from the seed and quirks it was recorded with
+  Movie *movie = NULL;
+  if (replay_filename != NULL) {
+    movie = movie_load(replay_filename);
+    if (movie == NULL)
+      return ERR;
+    seed = movie->seed;
+    quirks = movie->quirks;
+  }
+
   // Setup Chip8 system
   rom_filename = argv[1];
   Chip8 *chip8 = initialize();
-  const int FPS = 60;
-  if (chip8 != NULL) {
-    load_rom(chip8, rom_filename);
-    init_screen(640, 480, FPS);
-    init_speaker(chip8);
-    log_info("System initialised...");
-  } else {
+  if (chip8 == NULL) {
+    movie_destroy(movie);
     return ERR;
   }
+  seed_random(chip8, seed);
 
-  // Main program loop
-  while (chip8->running) {
-    BeginDrawing();
-    if (!chip8->paused) {
-      print_sys_info(chip8);
-      cycle_cpu(chip8, FPS);
-    }
+  if (set_quirks(chip8, quirks) != SUCCESS ||
+      set_cpu_mode(chip8, mode) != SUCCESS ||
+      load_rom(chip8, rom_filename) != SUCCESS ||
+      (load_state_filename != NULL &&
+       load_state_file(chip8, load_state_filename) != SUCCESS) ||
+      (trace_filename != NULL &&
+       trace_start(chip8, trace_filename) != SUCCESS)) {
+    movie_destroy(movie);
+    destroy(chip8);
+    return ERR;
+  }
 
-    if (chip8->reset)
-      reset(chip8);
+  // History is kept in a window by default, headless runs only on request
+  if (rewind_seconds < 0)
+    rewind_seconds = headless ? 0 : DEFAULT_REWIND_SECONDS;
+  RewindBuffer *history = NULL;
+  if (rewind_seconds > 0) {
+    history = rewind_create(rewind_seconds);
+    if (history == NULL) {
+      movie_destroy(movie);
+      destroy(chip8);
+      return ERR;
+    }
+  }
 
-    if (chip8->draw) {
-      update_screen(chip8->buffer);
-      chip8->draw = false;
+  int status = SUCCESS;
+  if (headless) {
+    RunStats stats;
+    if (movie != NULL)
+      status = replay_movie(chip8, movie, &stats);
+    else
+      run_headless(chip8, ips, max_cycles, max_frames, history, &stats);
+    print_run_stats(&stats);
+  } else {
+#ifndef HEADLESS
+    const int FPS = 60;
+    if (record_filename != NULL)
+      movie = movie_create(chip8, seed, ips);
+    if (record_filename == NULL || movie != NULL) {
+      Emulation emu = {.c8 = chip8,
+                       .ips = ips,
+                       .turbo_speed = turbo_speed,
+                       .history = history,
+                       .movie = movie};
+      status = run_windowed(&emu, FPS, turbo);
+      if (status == SUCCESS && movie != NULL)
+        status = movie_save(movie, chip8, record_filename);
+    } else {
+      status = ERR;
     }
+#endif
+  }
 
-    handle_input(chip8);
-    handle_sound(chip8);
-    update_timers(chip8);
-    EndDrawing();
+  // The state the run ended in, the trace holds how it got there
+  print_sys_info(chip8);
+  trace_stop(chip8);
+#ifdef CHIP8_PROFILE
+  print_profile(chip8->profile);
+  if (profile_save(chip8->profile, profile_filename) != SUCCESS)
+    status = ERR;
+#endif
+
+  if (history != NULL) {
+    print_rewind_stats(history);
+    rewind_destroy(history);
   }
+  movie_destroy(movie);
 
-  close_screen();
-  close_speaker(chip8);
-  free(chip8);
-  return SUCCESS;
-}
+  if (save_state_filename != NULL &&
+      save_state_file(chip8, save_state_filename) != SUCCESS)
+    status = ERR;
+
+  destroy(chip8);
+  return status;
+}
\ No newline at end of file
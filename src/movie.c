@@ -0,0 +1,175 @@
+#include "movie.h"
+#include "bytes.h"
+#include <sys/stat.h>
+
+Movie *movie_create(const Chip8 *c8, uint32_t seed, uint32_t ips) {
+  Movie *movie = calloc(1, sizeof(Movie));
+  if (movie == NULL) {
+    log_error("Error: Failed to allocate memory for movie.");
+    return NULL;
+  }
+
+  movie->seed = seed;
+  movie->ips = ips;
+  movie->quirks = c8->quirks;
+  movie->start_hash = state_hash(c8);
+  return movie;
+}
+
+void movie_destroy(Movie *movie) {
+  if (movie == NULL)
+    return;
+  free(movie->frames);
+  free(movie);
+}
+
+int movie_record(Movie *movie, uint16_t keys) {
+  if (movie->frame_count == movie->capacity) {
+    uint32_t capacity = movie->capacity ? movie->capacity * 2 : 3600;
+    uint16_t *frames = realloc(movie->frames, capacity * sizeof(uint16_t));
+    if (frames == NULL) {
+      log_error("Error: Failed to allocate memory for movie.");
+      return ERR;
+    }
+    movie->frames = frames;
+    movie->capacity = capacity;
+  }
+
+  movie->frames[movie->frame_count++] = keys;
+  return SUCCESS;
+}
+
+void movie_truncate(Movie *movie, uint32_t frames) {
+  if (frames < movie->frame_count)
+    movie->frame_count = frames;
+}
+
+int movie_save(Movie *movie, const Chip8 *c8, const char *filename) {
+  uint8_t header[MOVIE_HEADER_SIZE], *p = header;
+  FILE *fp = fopen(filename, "wb");
+
+  if (fp == NULL) {
+    log_error("Failed to open movie file: %s", filename);
+    return ERR;
+  }
+
+  movie->end_hash = framebuffer_hash(c8);
+  memcpy(p, MOVIE_MAGIC, 4);
+  p += 4;
+  put16(&p, MOVIE_VERSION);
+  put16(&p, movie->quirks);
+  put32(&p, movie->seed);
+  put32(&p, movie->frame_count);
+  put64(&p, movie->start_hash);
+  put64(&p, movie->end_hash);
+  put32(&p, movie->ips);
+
+  // Frames are written in chunks, converted to little-endian on the way
+  uint8_t chunk[4096];
+  bool ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header);
+  for (uint32_t i = 0; ok && i < movie->frame_count;) {
+    p = chunk;
+    for (; i < movie->frame_count && p < chunk + sizeof(chunk); i++)
+      put16(&p, movie->frames[i]);
+    ok = fwrite(chunk, 1, p - chunk, fp) == (size_t)(p - chunk);
+  }
+
+  if (fclose(fp) != 0 || !ok) {
+    log_error("Failed to write movie file: %s", filename);
+    return ERR;
+  }
+  return SUCCESS;
+}
+
+Movie *movie_load(const char *filename) {
+  uint8_t header[MOVIE_HEADER_SIZE];
+  const uint8_t *p = header;
+  FILE *fp = fopen(filename, "rb");
+
+  if (fp == NULL) {
+    log_error("Failed to open movie file: %s", filename);
+    return NULL;
+  }
+
+  if (fread(header, 1, MOVIE_V1_HEADER_SIZE, fp) != MOVIE_V1_HEADER_SIZE ||
+      memcmp(p, MOVIE_MAGIC, 4) != 0) {
+    log_error("Not a movie: %s", filename);
+    fclose(fp);
+    return NULL;
+  }
+  p += 4;
+
+  uint16_t version = get16(&p);
+  uint16_t quirks = get16(&p);
+  if (version < 1 || version > MOVIE_VERSION) {
+    log_error("Unsupported movie version: %u", version);
+    fclose(fp);
+    return NULL;
+  }
+  if (quirks >= QUIRKS_COUNT) {
+    log_error("Unknown quirk profile in movie: %u", quirks);
+    fclose(fp);
+    return NULL;
+  }
+
+  Movie *movie = calloc(1, sizeof(Movie));
+  if (movie == NULL) {
+    log_error("Error: Failed to allocate memory for movie.");
+    fclose(fp);
+    return NULL;
+  }
+  movie->quirks = quirks;
+  movie->seed = get32(&p);
+  movie->frame_count = get32(&p);
+  movie->start_hash = get64(&p);
+  movie->end_hash = get64(&p);
+  movie->ips = DEFAULT_IPS;
+  if (version >= 2) {
+    uint8_t rate[4];
+    const uint8_t *q = rate;
+    if (fread(rate, 1, sizeof(rate), fp) != sizeof(rate) ||
+        (movie->ips = get32(&q)) == 0) {
+      log_error("Movie has no valid rate: %s", filename);
+      fclose(fp);
+      free(movie);
+      return NULL;
+    }
+  }
+
+  // The frame count comes from the file, so it must fit in what is left of
+  // it before anything is allocated for it
+  struct stat st;
+  size_t header_size = version >= 2 ? MOVIE_HEADER_SIZE : MOVIE_V1_HEADER_SIZE;
+  if (fstat(fileno(fp), &st) != 0 || st.st_size < (off_t)header_size ||
+      movie->frame_count > (size_t)(st.st_size - header_size) / 2) {
+    log_error("Movie is truncated or has the wrong size: %s", filename);
+    fclose(fp);
+    free(movie);
+    return NULL;
+  }
+
+  movie->capacity = movie->frame_count;
+  movie->frames = malloc(((size_t)movie->capacity + 1) * sizeof(uint16_t));
+  if (movie->frames == NULL) {
+    log_error("Error: Failed to allocate memory for movie.");
+    fclose(fp);
+    free(movie);
+    return NULL;
+  }
+
+  // Masks are read in place, then converted from little-endian
+  size_t read = fread(movie->frames, sizeof(uint16_t), movie->frame_count, fp);
+  bool extra = fgetc(fp) != EOF;
+  fclose(fp);
+  if (read != movie->frame_count || extra) {
+    log_error("Movie is truncated or has the wrong size: %s", filename);
+    movie_destroy(movie);
+    return NULL;
+  }
+  for (uint32_t i = 0; i < movie->frame_count; i++) {
+    p = (const uint8_t *)&movie->frames[i];
+    movie->frames[i] = get16(&p);
+  }
+
+  return movie;
+}
\ No newline at end of file
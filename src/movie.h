@@ -0,0 +1,72 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include "scheduler.h"
+
+// File signature and format version of a movie
+#define MOVIE_MAGIC "C8MV"
+#define MOVIE_VERSION 2
+
+/*
+ * Layout of a movie, every value little-endian:
+ *
+ *   magic "C8MV" | u16 version | u16 quirk profile | u32 seed | u32 frame count
+ *   | u64 state hash before the first frame | u64 framebuffer hash after
+ *   the last frame | u32 instructions per second | u16 keypad mask[frame count]
+ *
+ * Frame k runs frame_cycles(ips, k) instructions and one timer tick with the
+ * keys of mask k held, so replaying the masks from the same starting state
+ * repeats the session exactly. Version 1 has no rate and ran DEFAULT_IPS.
+ * The quirk profile field was always 0 (QUIRKS_DEFAULT) before profiles.
+ */
+#define MOVIE_HEADER_SIZE 36
+#define MOVIE_V1_HEADER_SIZE 32
+
+// A recorded session
+typedef struct {
+  uint32_t seed;        // Seed of the random number generator
+  uint64_t start_hash;  // state_hash before the first frame
+  uint64_t end_hash;    // framebuffer_hash after the last frame
+  uint32_t ips;         // Instructions per second the session ran at
+  QuirkProfile quirks;  // Quirk profile the session ran with
+  uint16_t *frames;     // Keypad mask of every frame
+  uint32_t frame_count;
+  uint32_t capacity;
+} Movie;
+
+/// @brief Start recording a session
+/// @param c8 The Chip8 instance in the state the session starts from, with
+/// the quirk profile it runs with
+/// @param seed The seed its random number generator was given
+/// @param ips The instructions per second the session runs at
+/// @return The movie, or NULL if allocation fails
+Movie *movie_create(const Chip8 *c8, uint32_t seed, uint32_t ips);
+
+/// @brief Free a movie
+/// @param movie The movie to free
+void movie_destroy(Movie *movie);
+
+/// @brief Append a frame to a recording
+/// @param movie The movie
+/// @param keys The mask of keys held while the frame runs
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int movie_record(Movie *movie, uint16_t keys);
+
+/// @brief Drop the frames after the first ones, after they were rewound
+/// @param movie The movie
+/// @param frames The number of frames to keep
+void movie_truncate(Movie *movie, uint32_t frames);
+
+/// @brief Finish a recording and write it to a file
+/// @param movie The movie
+/// @param c8 The Chip8 instance after the last frame
+/// @param filename The file to write
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int movie_save(Movie *movie, const Chip8 *c8, const char *filename);
+
+/// @brief Read a movie from a file
+/// @param filename The file to read
+/// @return The movie, or NULL if the file is not a valid movie
+Movie *movie_load(const char *filename);
+
+#endif
\ No newline at end of file
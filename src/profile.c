@@ -0,0 +1,335 @@
+#include "profile.h"
+#include "scheduler.h"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Handler of each operation, as named in instructions.h
+static const char *const OP_NAMES[OP_COUNT] = {
+    [OP_UNKNOWN] = "unknown",
+    [OP_CLS] = "cls",
+    [OP_RET] = "ret",
+    [OP_SYS_ADDR] = "sys_addr",
+    [OP_JP_ADDR] = "jmp_addr",
+    [OP_CALL_ADDR] = "call_addr",
+    [OP_SE_VX_BYTE] = "se_vx_byte",
+    [OP_SNE_VX_BYTE] = "sne_vx_byte",
+    [OP_SE_VX_VY] = "se_vx_vy",
+    [OP_LD_VX_BYTE] = "ld_vx_byte",
+    [OP_ADD_VX_BYTE] = "add_vx_byte",
+    [OP_LD_VX_VY] = "ld_vx_vy",
+    [OP_OR_VX_VY] = "or_vx_vy",
+    [OP_AND_VX_VY] = "and_vx_vy",
+    [OP_XOR_VX_VY] = "xor_vx_vy",
+    [OP_ADD_VX_VY] = "add_vx_vy",
+    [OP_SUB_VX_VY] = "sub_vx_vy",
+    [OP_SHR_VX] = "shr_vx",
+    [OP_SUBN_VX_VY] = "subn_vx_vy",
+    [OP_SHL_VX] = "shl_vx",
+    [OP_SNE_VX_VY] = "sne_vx_vy",
+    [OP_LD_I_ADDR] = "ld_i_addr",
+    [OP_JP_V0_ADDR] = "jp_v0_addr",
+    [OP_RND_VX_KK] = "rnd_vx_kk",
+    [OP_DRW_VX_VY_NIBBLE] = "drw_vx_vy_nibble",
+    [OP_SKP_VX] = "skp_vx",
+    [OP_SKNP_VX] = "sknp_vx",
+    [OP_LD_VX_DT] = "ld_vx_dt",
+    [OP_LD_VX_K] = "ld_vx_k",
+    [OP_LD_DT_VX] = "ld_dt_vx",
+    [OP_LD_ST_VX] = "ld_st_vx",
+    [OP_ADD_I_VX] = "add_i_vx",
+    [OP_LD_F_VX] = "ld_f_vx",
+    [OP_LD_B_VX] = "ld_b_vx",
+    [OP_LD_I_VX] = "ld_i_vx",
+    [OP_LD_VX_I] = "ld_vx_i",
+    [OP_SCD_NIBBLE] = "scd_nibble",
+    [OP_SCR] = "scr",
+    [OP_SCL] = "scl",
+    [OP_EXIT] = "exit_interpreter",
+    [OP_LOW] = "low",
+    [OP_HIGH] = "high",
+    [OP_LD_HF_VX] = "ld_hf_vx",
+    [OP_LD_R_VX] = "ld_r_vx",
+    [OP_LD_VX_R] = "ld_vx_r",
+    [OP_SCU_NIBBLE] = "scu_nibble",
+    [OP_LD_I_VX_VY] = "ld_i_vx_vy",
+    [OP_LD_VX_VY_I] = "ld_vx_vy_i",
+    [OP_LD_I_LONG] = "ld_i_long",
+    [OP_PLANE] = "plane_n",
+    [OP_AUDIO] = "ld_audio_i",
+    [OP_PITCH] = "ld_pitch_vx",
+};
+
+// A loop closed by a backward jump, and the instructions executed in it
+typedef struct {
+  uint16_t start;
+  uint16_t end; // Address of the jump
+  uint64_t iterations;
+  uint64_t instructions;
+} Loop;
+
+/**
+ * @brief Reads a cheap, monotonically increasing tick counter.
+ *
+ * @return The timestamp counter on x86, nanoseconds elsewhere.
+ */
+static inline uint64_t read_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+Profile *profile_create(void) {
+  Profile *profile = calloc(1, sizeof(Profile));
+  if (profile == NULL) {
+    log_error("Failed to allocate memory for the profile.");
+    return NULL;
+  }
+
+  // Reading the counter takes time of its own, which is not counted
+  profile->overhead = UINT64_MAX;
+  for (int i = 0; i < 1000; i++) {
+    uint64_t start = read_ticks();
+    uint64_t spent = read_ticks() - start;
+    if (spent < profile->overhead)
+      profile->overhead = spent;
+  }
+
+  profile->start_seconds = scheduler_clock();
+  profile->start_ticks = read_ticks();
+  return profile;
+}
+
+void profile_destroy(Profile *profile) { free(profile); }
+
+/**
+ * @brief Interprets instructions one at a time, counting each by handler and
+ * address and timing its handler.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param max_cycles The maximum number of instructions to execute.
+ * @return The number of instructions executed, fewer if the instance stops.
+ */
+int profile_run(Chip8 *c8, int max_cycles) {
+  Profile *profile = c8->profile;
+  int cycle;
+
+  for (cycle = 0; cycle < max_cycles && c8->running; cycle++) {
+    uint16_t pc = c8->pc & (MEMORY_SIZE - 1);
+    fetch_opcode(c8);
+    uint8_t op = op_decode_table[c8->opcode];
+
+    uint64_t start = read_ticks();
+    c8->handlers[op](c8);
+    uint64_t spent = read_ticks() - start;
+    if (spent > profile->overhead)
+      profile->op_ticks[op] += spent - profile->overhead;
+    profile->op_count[op]++;
+    profile->pc_count[pc]++;
+
+    if (op == OP_JP_ADDR && c8->pc <= pc) {
+      profile->loop_count[pc]++;
+      profile->loop_target[pc] = c8->pc;
+    }
+  }
+  return cycle;
+}
+
+/**
+ * @brief Converts timestamp ticks into nanoseconds, using the ticks that
+ * passed since the counters were created.
+ *
+ * @param profile The counters.
+ * @return Nanoseconds per tick.
+ */
+static double ns_per_tick(const Profile *profile) {
+  double seconds = scheduler_clock() - profile->start_seconds;
+  uint64_t ticks = read_ticks() - profile->start_ticks;
+  return ticks > 0 ? seconds * 1e9 / ticks : 0;
+}
+
+static uint64_t total_instructions(const Profile *profile) {
+  uint64_t total = 0;
+  for (int op = 0; op < OP_COUNT; op++)
+    total += profile->op_count[op];
+  return total;
+}
+
+static int compare_loops(const void *a, const void *b) {
+  const Loop *la = a, *lb = b;
+  if (la->instructions != lb->instructions)
+    return la->instructions < lb->instructions ? 1 : -1;
+  return la->start - lb->start;
+}
+
+/**
+ * @brief Lists every loop, the most instructions executed first.
+ *
+ * A loop runs from the target of a backward jump to the jump itself, and
+ * the instructions executed in it are counted by address, so nested loops
+ * count the instructions of the loops inside them too.
+ *
+ * @param profile The counters.
+ * @param loops Filled in with the loops, MEMORY_SIZE entries.
+ * @return The number of loops.
+ */
+static int find_loops(const Profile *profile, Loop *loops) {
+  int count = 0;
+
+  for (int pc = 0; pc < MEMORY_SIZE; pc++) {
+    if (profile->loop_count[pc] == 0)
+      continue;
+
+    Loop *loop = &loops[count++];
+    loop->start = profile->loop_target[pc];
+    loop->end = pc;
+    loop->iterations = profile->loop_count[pc];
+    loop->instructions = 0;
+    for (int a = loop->start; a <= pc + 1 && a < MEMORY_SIZE; a++)
+      loop->instructions += profile->pc_count[a];
+  }
+
+  qsort(loops, count, sizeof(Loop), compare_loops);
+  return count;
+}
+
+/**
+ * @brief Finds the entries of a counter array with the highest counts.
+ *
+ * @param counts The counters.
+ * @param length The number of counters.
+ * @param top Filled in with the indices of the highest counts, highest
+ *            first, PROFILE_TOP entries.
+ * @return The number of indices found, only counts above 0 are included.
+ */
+static int find_top(const uint64_t *counts, int length, int *top) {
+  int found = 0;
+
+  for (int i = 0; i < length; i++) {
+    if (counts[i] == 0)
+      continue;
+
+    int slot = found < PROFILE_TOP ? found++ : PROFILE_TOP;
+    while (slot > 0 && counts[top[slot - 1]] < counts[i]) {
+      if (slot < PROFILE_TOP)
+        top[slot] = top[slot - 1];
+      slot--;
+    }
+    if (slot < PROFILE_TOP)
+      top[slot] = i;
+  }
+  return found;
+}
+
+void print_profile(const Profile *profile) {
+  double ns = ns_per_tick(profile);
+  uint64_t total = total_instructions(profile), ticks = 0;
+  double scale = total > 0 ? 100.0 / total : 0;
+  int top[PROFILE_TOP], count;
+
+  for (int op = 0; op < OP_COUNT; op++)
+    ticks += profile->op_ticks[op];
+  double tick_scale = ticks > 0 ? 100.0 / ticks : 0;
+
+  printf("Profile: %llu instructions\n", (unsigned long long)total);
+  printf("Drawing: %.1f%% of instructions, %.1f%% of handler time\n",
+         profile->op_count[OP_DRW_VX_VY_NIBBLE] * scale,
+         profile->op_ticks[OP_DRW_VX_VY_NIBBLE] * tick_scale);
+
+  printf("Handlers by time:\n");
+  count = find_top(profile->op_ticks, OP_COUNT, top);
+  for (int i = 0; i < count; i++) {
+    int op = top[i];
+    printf("  %-18s %12llu  %5.1f%% of instructions  %5.1f%% of time  "
+           "%6.1f ns each\n",
+           OP_NAMES[op], (unsigned long long)profile->op_count[op],
+           profile->op_count[op] * scale, profile->op_ticks[op] * tick_scale,
+           profile->op_ticks[op] * ns / profile->op_count[op]);
+  }
+
+  printf("Hottest addresses:\n");
+  count = find_top(profile->pc_count, MEMORY_SIZE, top);
+  for (int i = 0; i < count; i++) {
+    int pc = top[i];
+    printf("  0x%03X %12llu  %5.1f%%\n", pc,
+           (unsigned long long)profile->pc_count[pc],
+           profile->pc_count[pc] * scale);
+  }
+
+  Loop *loops = malloc(MEMORY_SIZE * sizeof(Loop));
+  if (loops == NULL)
+    return;
+  count = find_loops(profile, loops);
+  printf("Hottest loops:\n");
+  for (int i = 0; i < count && i < PROFILE_TOP; i++)
+    printf("  0x%03X-0x%03X %12llu iterations  %5.1f%% of instructions\n",
+           loops[i].start, loops[i].end,
+           (unsigned long long)loops[i].iterations,
+           loops[i].instructions * scale);
+  free(loops);
+}
+
+/**
+ * @brief Writes the counters as a single JSON object.
+ *
+ * Handlers are listed with their count and total time, addresses and loops
+ * only if they ran, loops the most instructions executed first.
+ *
+ * @param profile The counters.
+ * @param filename The file to write.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int profile_save(const Profile *profile, const char *filename) {
+  Loop *loops = malloc(MEMORY_SIZE * sizeof(Loop));
+  FILE *file = fopen(filename, "w");
+  if (loops == NULL || file == NULL) {
+    log_error("Could not write profile: %s", filename);
+    free(loops);
+    if (file != NULL)
+      fclose(file);
+    return ERR;
+  }
+
+  double ns = ns_per_tick(profile);
+  fprintf(file, "{\"instructions\":%llu,\"handlers\":[",
+          (unsigned long long)total_instructions(profile));
+  for (int op = 0; op < OP_COUNT; op++)
+    fprintf(file, "%s{\"name\":\"%s\",\"count\":%llu,\"ns\":%.0f}",
+            op > 0 ? "," : "", OP_NAMES[op],
+            (unsigned long long)profile->op_count[op],
+            profile->op_ticks[op] * ns);
+
+  fprintf(file, "],\"pcs\":[");
+  bool first = true;
+  for (int pc = 0; pc < MEMORY_SIZE; pc++) {
+    if (profile->pc_count[pc] == 0)
+      continue;
+    fprintf(file, "%s{\"pc\":%d,\"count\":%llu}", first ? "" : ",", pc,
+            (unsigned long long)profile->pc_count[pc]);
+    first = false;
+  }
+
+  fprintf(file, "],\"loops\":[");
+  int count = find_loops(profile, loops);
+  for (int i = 0; i < count; i++)
+    fprintf(file,
+            "%s{\"start\":%d,\"end\":%d,\"iterations\":%llu,"
+            "\"instructions\":%llu}",
+            i > 0 ? "," : "", loops[i].start, loops[i].end,
+            (unsigned long long)loops[i].iterations,
+            (unsigned long long)loops[i].instructions);
+  fprintf(file, "]}\n");
+
+  free(loops);
+  int status = ferror(file) ? ERR : SUCCESS;
+  if (fclose(file) != 0)
+    status = ERR;
+  if (status != SUCCESS)
+    log_error("Could not write profile: %s", filename);
+  return status;
+}
\ No newline at end of file
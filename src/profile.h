@@ -0,0 +1,52 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "chip8.h"
+#include "dispatch.h"
+
+// Entries listed in each part of the text report
+#define PROFILE_TOP 10
+
+/*
+ * Execution counters of one Chip8 instance, only compiled in with
+ * -DCHIP8_PROFILE (make PROFILE=1). While they are collected, instructions
+ * are interpreted one at a time whatever the engine selected, and each
+ * handler is timed with the CPU's timestamp counter.
+ */
+typedef struct Profile {
+  uint64_t op_count[OP_COUNT]; // Instructions executed by each handler
+  uint64_t op_ticks[OP_COUNT]; // Timestamp ticks spent in each handler
+  uint64_t pc_count[MEMORY_SIZE];
+  // Backward jumps taken from each address, and where they went
+  uint64_t loop_count[MEMORY_SIZE];
+  uint16_t loop_target[MEMORY_SIZE];
+  uint64_t overhead;     // Ticks measured around a handler that does nothing
+  uint64_t start_ticks;  // Timestamp and clock when collection started, to
+  double start_seconds;  // convert ticks into time
+} Profile;
+
+/// @brief Allocate zeroed counters
+/// @return The counters, or NULL if allocation fails
+Profile *profile_create(void);
+
+/// @brief Free a set of counters
+/// @param profile The counters to free
+void profile_destroy(Profile *profile);
+
+/// @brief Execute up to max_cycles instructions, counting each of them
+/// @param c8 The Chip8 instance, with counters attached
+/// @param max_cycles The maximum number of instructions to execute
+/// @return The number of instructions executed, fewer if the instance stops
+int profile_run(Chip8 *c8, int max_cycles);
+
+/// @brief Print the handlers, addresses and loops that ran the most
+/// @param profile The counters
+void print_profile(const Profile *profile);
+
+/// @brief Write every counter as JSON
+/// @param profile The counters
+/// @param filename The file to write
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int profile_save(const Profile *profile, const char *filename);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#include "quirks.h"
+#include "chip8_types.h"
+
+#define QUIRKS_ENTRY(name, profile, vf_reset, shift_vy, index, clip,          \
+                     jump_vx, schip, xochip)                                   \
+  [profile] = {#name, vf_reset, shift_vy, index, clip, jump_vx, schip, xochip},
+
+const Quirks quirk_profiles[QUIRKS_COUNT] = {QUIRK_PROFILES(QUIRKS_ENTRY)};
+
+int parse_quirks(const char *name, QuirkProfile *profile) {
+  for (int p = 0; p < QUIRKS_COUNT; p++) {
+    if (strcmp(name, quirk_profiles[p].name) == 0) {
+      *profile = p;
+      return SUCCESS;
+    }
+  }
+
+  return ERR;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef QUIRKS_H
+#define QUIRKS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Sets of behaviours that differ between CHIP-8 interpreters
+typedef enum {
+  QUIRKS_DEFAULT, // As this emulator has always behaved
+  QUIRKS_VIP,     // The original COSMAC VIP interpreter
+  QUIRKS_CHIP48,  // CHIP-48 on the HP-48
+  QUIRKS_SCHIP,   // SUPER-CHIP 1.1
+  QUIRKS_XOCHIP,  // XO-CHIP, as Octo runs it
+  QUIRKS_COUNT
+} QuirkProfile;
+
+// How FX55 and FX65 leave I
+typedef enum {
+  INDEX_UNCHANGED,    // I is left as it was
+  INDEX_ADD_X,        // I += X
+  INDEX_ADD_X_PLUS_1, // I += X + 1, past the last register
+} IndexQuirk;
+
+/*
+ * The quirks of every profile, one entry per profile in QuirkProfile order:
+ *
+ *   X(name, profile, vf_reset, shift_vy, index, clip, jump_vx, schip, xochip)
+ *
+ * vf_reset -> Bit n is set if 8XYn resets VF (1 -> OR, 2 -> AND, 3 -> XOR)
+ * shift_vy -> 8XY6 and 8XYE shift Vy into Vx instead of shifting Vx
+ * index -> How FX55 and FX65 leave I
+ * clip -> DXYN clips sprites at the edges instead of wrapping them around
+ * jump_vx -> BXNN jumps to XNN + Vx instead of NNN + V0
+ * schip -> The SUPER-CHIP instructions and large font are available,
+ *          otherwise 00CN and 00FB-00FF are SYS jumps and FX30, FX75 and
+ *          FX85 are unknown opcodes, as they always were
+ * xochip -> The XO-CHIP instructions, 64 KB of memory, a second display
+ *           plane and audio patterns, otherwise 00DN is a SYS jump, 5XY2
+ *           and 5XY3 compare like 5XY0 and F000, FN01, F002 and FX3A are
+ *           unknown opcodes
+ *
+ * instructions.c compiles the handlers these affect once per profile with
+ * the quirks as constants, so a profile costs nothing per instruction.
+ */
+#define QUIRK_PROFILES(X)                                                      \
+  X(default, QUIRKS_DEFAULT, 0x2, false, INDEX_ADD_X_PLUS_1, false, false,     \
+    false, false)                                                              \
+  X(vip, QUIRKS_VIP, 0xE, true, INDEX_ADD_X_PLUS_1, true, false, false, false) \
+  X(chip48, QUIRKS_CHIP48, 0x0, false, INDEX_ADD_X, true, true, false, false)  \
+  X(schip, QUIRKS_SCHIP, 0x0, false, INDEX_UNCHANGED, true, true, true, false) \
+  X(xochip, QUIRKS_XOCHIP, 0x0, true, INDEX_ADD_X_PLUS_1, false, false, true,  \
+    true)
+
+// The quirks of a profile, for code generated outside the handlers
+typedef struct {
+  const char *name;
+  uint8_t vf_reset;
+  bool shift_vy;
+  IndexQuirk index;
+  bool clip;
+  bool jump_vx;
+  bool schip;
+  bool xochip;
+} Quirks;
+
+// Quirks of every profile, indexed by QuirkProfile
+extern const Quirks quirk_profiles[QUIRKS_COUNT];
+
+/// @brief Look a quirk profile up by name
+/// @param name The name, e.g. "vip"
+/// @param profile Set to the profile
+/// @return Status of the operation (0 -> Success, 1 -> Unknown name)
+int parse_quirks(const char *name, QuirkProfile *profile);
+
+#endif
\ No newline at end of file
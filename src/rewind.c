@@ -0,0 +1,276 @@
+#include "rewind.h"
+#include "bytes.h"
+#include "scheduler.h"
+
+// Unchanged bytes that end a run of changed ones, shorter gaps are cheaper
+// to store as changes than to start a new run for
+#define MIN_GAP 4
+
+/**
+ * @brief Stores a state as the XOR against a keyframe.
+ *
+ * The delta is a list of runs, each a u16 count of unchanged bytes to skip,
+ * a u16 count of changed bytes and the XOR of those bytes. Unchanged bytes
+ * at the end are left out.
+ *
+ * @param out Where the delta is written, 2 * size bytes at most.
+ * @param key The keyframe.
+ * @param state The state to encode.
+ * @param size The size of the state and the keyframe in bytes.
+ * @return The size of the delta in bytes.
+ */
+static size_t encode_delta(uint8_t *out, const uint8_t *key,
+                           const uint8_t *state, size_t size) {
+  uint8_t *p = out;
+  size_t i = 0;
+
+  while (i < size) {
+    size_t skip = i;
+    // Most of a state is unchanged, so skip it a word at a time
+    while (i + 8 <= size) {
+      uint64_t a, b;
+      memcpy(&a, &state[i], 8);
+      memcpy(&b, &key[i], 8);
+      if (a != b)
+        break;
+      i += 8;
+    }
+    while (i < size && state[i] == key[i])
+      i++;
+    if (i == size)
+      break;
+
+    // Extend the run over gaps shorter than MIN_GAP
+    size_t start = i, end = i;
+    while (end < size) {
+      size_t gap = end;
+      while (gap < size && gap - end < MIN_GAP && state[gap] == key[gap])
+        gap++;
+      if (gap - end >= MIN_GAP || gap == size)
+        break;
+      end = gap + 1;
+    }
+
+    // Counts are u16, an XO-CHIP state can need more: skips that long are
+    // split over runs with no changed bytes, and long runs are cut short
+    while (start - skip > UINT16_MAX) {
+      put16(&p, UINT16_MAX);
+      put16(&p, 0);
+      skip += UINT16_MAX;
+    }
+    if (end - start > UINT16_MAX)
+      end = start + UINT16_MAX;
+
+    put16(&p, start - skip);
+    put16(&p, end - start);
+    for (size_t j = start; j < end; j++)
+      *p++ = state[j] ^ key[j];
+    i = end;
+  }
+
+  return p - out;
+}
+
+/**
+ * @brief Rebuilds a state from its keyframe and delta.
+ *
+ * @param out Where the state is written, state_size bytes.
+ * @param key The keyframe.
+ * @param state_size The size of the keyframe in bytes.
+ * @param delta The delta.
+ * @param size The size of the delta in bytes.
+ */
+static void decode_delta(uint8_t *out, const uint8_t *key, size_t state_size,
+                         const uint8_t *delta, size_t size) {
+  const uint8_t *p = delta, *end = delta + size;
+  size_t pos = 0;
+
+  memcpy(out, key, state_size);
+  while (p < end) {
+    pos += get16(&p);
+    uint16_t len = get16(&p);
+    for (uint16_t j = 0; j < len; j++)
+      out[pos++] ^= *p++;
+  }
+}
+
+RewindBuffer *rewind_create(int seconds) {
+  RewindBuffer *history = NULL;
+
+  if (seconds <= 0) {
+    log_error("Rewind length must be positive.");
+    return NULL;
+  }
+
+  history = calloc(1, sizeof(RewindBuffer));
+  if (history == NULL) {
+    log_error("Error: Failed to allocate memory for rewind.");
+    return NULL;
+  }
+
+  // One segment more than the frames need, as the oldest segment is only
+  // partly within the window once the newest one starts to fill up
+  int frames = seconds * 60;
+  history->segment_count =
+      (frames + REWIND_KEYFRAME_INTERVAL - 1) / REWIND_KEYFRAME_INTERVAL + 1;
+  history->segments = calloc(history->segment_count, sizeof(RewindSegment));
+  if (history->segments == NULL) {
+    log_error("Error: Failed to allocate memory for rewind.");
+    free(history);
+    return NULL;
+  }
+
+  return history;
+}
+
+void rewind_destroy(RewindBuffer *history) {
+  if (history == NULL)
+    return;
+  for (int s = 0; s < history->segment_count; s++)
+    free(history->segments[s].data);
+  free(history->segments);
+  free(history);
+}
+
+/**
+ * @brief Makes room for another frame at the end of a segment.
+ *
+ * @param segment The segment.
+ * @param state_size The size of a state in bytes.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int reserve_frame(RewindSegment *segment, size_t state_size) {
+  // A delta is never more than twice the size of a state
+  size_t needed = segment->used + 2 * state_size;
+  if (needed <= segment->capacity)
+    return SUCCESS;
+
+  size_t capacity = segment->capacity ? segment->capacity * 2 : needed;
+  while (capacity < needed)
+    capacity *= 2;
+  uint8_t *data = realloc(segment->data, capacity);
+  if (data == NULL) {
+    log_error("Error: Failed to allocate memory for rewind.");
+    return ERR;
+  }
+  segment->data = data;
+  segment->capacity = capacity;
+  return SUCCESS;
+}
+
+/**
+ * @brief Append the state of a Chip8 instance as the newest frame.
+ *
+ * The first frame of a segment is stored as a keyframe, the others as
+ * deltas against it. Once every segment is in use, the oldest one is
+ * emptied and reused. A state of another size, after switching to or from
+ * XO-CHIP, cannot be stored against the frames before it, so the history
+ * starts over.
+ *
+ * @param history The history.
+ * @param c8 A pointer to the Chip8 instance.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int rewind_capture(RewindBuffer *history, const Chip8 *c8) {
+  double start = scheduler_clock();
+  size_t state_size = save_state_size(c8);
+
+  if (state_size != history->state_size) {
+    for (int s = 0; s < history->segment_count; s++)
+      history->segments[s].frames = 0;
+    history->segments[0].used = 0;
+    history->newest = history->oldest = 0;
+    history->state_size = state_size;
+  }
+
+  RewindSegment *segment = &history->segments[history->newest];
+  if (segment->frames == REWIND_KEYFRAME_INTERVAL) {
+    history->newest = (history->newest + 1) % history->segment_count;
+    if (history->newest == history->oldest)
+      history->oldest = (history->oldest + 1) % history->segment_count;
+    segment = &history->segments[history->newest];
+    segment->frames = 0;
+    segment->used = 0;
+  }
+
+  if (reserve_frame(segment, state_size) != SUCCESS)
+    return ERR;
+
+  segment->offsets[segment->frames] = segment->used;
+  if (segment->frames == 0) {
+    segment->used = save_state(c8, segment->data);
+  } else {
+    save_state(c8, history->scratch);
+    segment->used += encode_delta(segment->data + segment->used, segment->data,
+                                  history->scratch, state_size);
+  }
+  segment->frames++;
+
+  // A full segment is not appended to again, so give back its headroom
+  if (segment->frames == REWIND_KEYFRAME_INTERVAL) {
+    uint8_t *data = realloc(segment->data, segment->used);
+    if (data != NULL) {
+      segment->data = data;
+      segment->capacity = segment->used;
+    }
+  }
+
+  history->captures++;
+  history->capture_time += scheduler_clock() - start;
+  return SUCCESS;
+}
+
+/**
+ * @brief Drop the newest frame and restore the one before it.
+ *
+ * The newest frame is the state the instance is already in, so stepping
+ * back restores the frame before it.
+ *
+ * @param history The history.
+ * @param c8 A pointer to the Chip8 instance.
+ * @return Status of the operation (1 -> no earlier frame is left).
+ */
+int rewind_step(RewindBuffer *history, Chip8 *c8) {
+  RewindSegment *segment = &history->segments[history->newest];
+
+  if (segment->frames < 2 && history->newest == history->oldest)
+    return ERR;
+
+  segment->frames--;
+  segment->used = segment->offsets[segment->frames];
+  if (segment->frames == 0) {
+    history->newest =
+        (history->newest + history->segment_count - 1) % history->segment_count;
+    segment = &history->segments[history->newest];
+  }
+
+  int frame = segment->frames - 1;
+  if (frame == 0)
+    return load_state(c8, segment->data, history->state_size);
+
+  uint32_t offset = segment->offsets[frame];
+  decode_delta(history->scratch, segment->data, history->state_size,
+               segment->data + offset, segment->used - offset);
+  return load_state(c8, history->scratch, history->state_size);
+}
+
+void rewind_get_stats(const RewindBuffer *history, RewindStats *stats) {
+  stats->frames = 0;
+  stats->bytes = sizeof(RewindBuffer) +
+                 history->segment_count * sizeof(RewindSegment);
+  for (int s = 0; s < history->segment_count; s++) {
+    stats->frames += history->segments[s].frames;
+    stats->bytes += history->segments[s].capacity;
+  }
+  stats->capture_usecs =
+      history->captures ? history->capture_time / history->captures * 1e6 : 0;
+}
+
+void print_rewind_stats(const RewindBuffer *history) {
+  RewindStats stats;
+  rewind_get_stats(history, &stats);
+
+  printf("Rewind: %llu frames (%.1f s) in %.2f MB, %.2f us per capture\n",
+         (unsigned long long)stats.frames, stats.frames / 60.0,
+         stats.bytes / (1024.0 * 1024.0), stats.capture_usecs);
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "savestate.h"
+
+// Frames between two full snapshots, every other frame is stored as a delta
+#define REWIND_KEYFRAME_INTERVAL 60
+
+// A keyframe and the deltas of the frames that follow it
+typedef struct {
+  uint8_t *data;      // Keyframe, then the deltas one after the other
+  size_t used;        // Bytes of data in use
+  size_t capacity;    // Bytes of data allocated, reused when overwritten
+  int frames;         // Frames stored, the keyframe included
+  uint32_t offsets[REWIND_KEYFRAME_INTERVAL]; // Start of each frame in data
+} RewindSegment;
+
+/*
+ * History of the last frames as a ring of segments. Each frame is the save
+ * state captured after it, stored as an XOR against its segment's keyframe
+ * with runs of zero bytes (unchanged state) run-length encoded. The oldest
+ * segment is overwritten as a whole once the ring is full.
+ */
+typedef struct {
+  RewindSegment *segments;
+  int segment_count;
+  int newest;          // Segment holding the newest frame
+  int oldest;          // Segment holding the oldest frame
+  uint64_t captures;   // Frames captured so far
+  double capture_time; // Seconds spent capturing them
+  size_t state_size;   // Bytes of every state in the history
+  uint8_t scratch[SAVESTATE_MAX_SIZE];
+} RewindBuffer;
+
+// Memory use and cost of a rewind buffer
+typedef struct {
+  uint64_t frames;      // Frames that can be stepped back through
+  size_t bytes;         // Bytes allocated for them
+  double capture_usecs; // Average time to capture a frame
+} RewindStats;
+
+/// @brief Allocate an empty history
+/// @param seconds How many seconds of 60 Hz frames to keep
+/// @return The history, or NULL if seconds is not positive or allocation
+/// fails
+RewindBuffer *rewind_create(int seconds);
+
+/// @brief Free a history and all of its frames
+/// @param history The history to free
+void rewind_destroy(RewindBuffer *history);
+
+/// @brief Append the state of a Chip8 instance as the newest frame
+/// @param history The history
+/// @param c8 The Chip8 instance, after running a frame
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int rewind_capture(RewindBuffer *history, const Chip8 *c8);
+
+/// @brief Drop the newest frame and restore the one before it
+/// @param history The history
+/// @param c8 The Chip8 instance to restore
+/// @return Status of the operation (1 -> no earlier frame is left)
+int rewind_step(RewindBuffer *history, Chip8 *c8);
+
+/// @brief Measure the memory use and capture cost of a history
+/// @param history The history
+/// @param stats Filled in with the measurements
+void rewind_get_stats(const RewindBuffer *history, RewindStats *stats);
+
+/// @brief Print the memory use and capture cost of a history
+/// @param history The history
+void print_rewind_stats(const RewindBuffer *history);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "savestate.h"
+#include "bytes.h"
+
+/**
+ * @brief Serialize the machine state of a Chip8 instance.
+ *
+ * Only state that determines how the machine continues is written, field
+ * by field, so the format does not depend on struct layout, padding or the
+ * byte order of the host.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param out The buffer to write to, save_state_size bytes.
+ * @return The size of the save state in bytes.
+ */
+size_t save_state(const Chip8 *c8, uint8_t *out) {
+  bool xochip = quirk_profiles[c8->quirks].xochip;
+  uint32_t payload_size =
+      SAVESTATE_PAYLOAD_SIZE + (xochip ? SAVESTATE_XOCHIP_SIZE : 0);
+  uint8_t *p = out;
+
+  memcpy(p, SAVESTATE_MAGIC, 4);
+  p += 4;
+  put16(&p, SAVESTATE_VERSION);
+  put16(&p, (c8->quirks << SAVESTATE_PROFILE_SHIFT) |
+                (xochip ? SAVESTATE_XOCHIP : 0));
+  put32(&p, payload_size);
+
+  uint8_t *payload = p;
+  memcpy(p, c8->memory, MEMORY_SIZE);
+  p += MEMORY_SIZE;
+  memcpy(p, c8->registers, sizeof(c8->registers));
+  p += sizeof(c8->registers);
+  for (int i = 0; i < STACKSIZE; i++)
+    put16(&p, c8->stack[i]);
+  put16(&p, c8->IRegister);
+  put16(&p, c8->pc);
+  put8(&p, c8->sp);
+  put8(&p, c8->delay_timer);
+  put8(&p, c8->sound_timer);
+  put16(&p, get_keypad_mask(c8));
+  put32(&p, c8->rng_state);
+  put8(&p, c8->hires);
+  for (int i = 0; i < DISPLAY_WORDS; i++)
+    put64(&p, c8->buffer[i]);
+  memcpy(p, c8->rpl, RPL_FLAGS);
+  p += RPL_FLAGS;
+  put8(&p, c8->awaited_key);
+  if (xochip) {
+    put8(&p, c8->planes);
+    put8(&p, c8->pitch);
+    memcpy(p, c8->audio_pattern, AUDIO_PATTERN_SIZE);
+    p += AUDIO_PATTERN_SIZE;
+    memcpy(p, &c8->rpl[RPL_FLAGS], XO_RPL_FLAGS - RPL_FLAGS);
+    p += XO_RPL_FLAGS - RPL_FLAGS;
+    for (int i = 0; i < DISPLAY_WORDS; i++)
+      put64(&p, c8->buffer[DISPLAY_WORDS + i]);
+    memcpy(p, &c8->memory[MEMORY_SIZE], XO_MEMORY_SIZE - MEMORY_SIZE);
+    p += XO_MEMORY_SIZE - MEMORY_SIZE;
+  }
+
+  put64(&p, fnv1a(FNV_OFFSET, payload, payload_size));
+  return p - out;
+}
+
+size_t save_state_size(const Chip8 *c8) {
+  return quirk_profiles[c8->quirks].xochip ? SAVESTATE_MAX_SIZE
+                                           : SAVESTATE_SIZE;
+}
+
+/**
+ * @brief Restore the machine state of a Chip8 instance.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param data The save state.
+ * @param size The size of the save state in bytes.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int load_state(Chip8 *c8, const uint8_t *data, size_t size) {
+  const uint8_t *p = data;
+
+  if (size < SAVESTATE_HEADER_SIZE || memcmp(p, SAVESTATE_MAGIC, 4) != 0) {
+    log_error("Not a save state.");
+    return ERR;
+  }
+  p += 4;
+
+  uint16_t version = get16(&p);
+  uint16_t flags = get16(&p);
+  uint32_t payload_size = get32(&p);
+  bool xochip = flags & SAVESTATE_XOCHIP;
+  uint16_t profile = flags >> SAVESTATE_PROFILE_SHIFT;
+  uint16_t known = version == SAVESTATE_VERSION ? 0xFF00 | SAVESTATE_XOCHIP
+                   : version == 2               ? SAVESTATE_XOCHIP
+                                                : 0;
+  if (version < 1 || version > SAVESTATE_VERSION || (flags & ~known) != 0 ||
+      (version == SAVESTATE_VERSION &&
+       (profile >= QUIRKS_COUNT || quirk_profiles[profile].xochip != xochip))) {
+    log_error("Unsupported save state version: %u", version);
+    return ERR;
+  }
+  if (version == SAVESTATE_VERSION && profile != c8->quirks) {
+    log_error("Save state was made under the %s quirks, use --quirks %s.",
+              quirk_profiles[profile].name, quirk_profiles[profile].name);
+    return ERR;
+  }
+  if (xochip && !quirk_profiles[c8->quirks].xochip) {
+    log_error("Save state was made under XO-CHIP, use --quirks xochip.");
+    return ERR;
+  }
+  uint32_t expected = version == 1   ? SAVESTATE_V1_PAYLOAD_SIZE
+                      : version == 2 ? SAVESTATE_V2_PAYLOAD_SIZE
+                                     : SAVESTATE_PAYLOAD_SIZE;
+  if (xochip)
+    expected += SAVESTATE_XOCHIP_SIZE;
+  if (payload_size != expected ||
+      size != SAVESTATE_HEADER_SIZE + expected + 8) {
+    log_error("Save state is truncated or has the wrong size.");
+    return ERR;
+  }
+
+  const uint8_t *payload = p;
+  const uint8_t *check = payload + payload_size;
+  if (get64(&check) != fnv1a(FNV_OFFSET, payload, payload_size)) {
+    log_error("Save state is corrupted.");
+    return ERR;
+  }
+  if (payload[MEMORY_SIZE + sizeof(c8->registers) + STACKSIZE * 2 + 4] >=
+      STACKSIZE) {
+    log_error("Save state has an invalid stack pointer.");
+    return ERR;
+  }
+  int8_t awaited_key = -1;
+  if (version == SAVESTATE_VERSION)
+    awaited_key = (int8_t)payload[SAVESTATE_PAYLOAD_SIZE - 1];
+  if (awaited_key < -1 || awaited_key > 0xF) {
+    log_error("Save state waits on an invalid key.");
+    return ERR;
+  }
+
+  memcpy(c8->memory, p, MEMORY_SIZE);
+  p += MEMORY_SIZE;
+  memcpy(c8->registers, p, sizeof(c8->registers));
+  p += sizeof(c8->registers);
+  for (int i = 0; i < STACKSIZE; i++)
+    c8->stack[i] = get16(&p);
+  c8->IRegister = get16(&p);
+  c8->pc = get16(&p);
+  c8->sp = get8(&p);
+  c8->delay_timer = get8(&p);
+  c8->sound_timer = get8(&p);
+  set_keypad_mask(c8, get16(&p));
+  c8->rng_state = get32(&p);
+  if (version == 1) {
+    memset(c8->buffer, 0, sizeof(c8->buffer));
+    c8->hires = false;
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+      c8->buffer[y] = get64(&p);
+  } else {
+    c8->hires = get8(&p) != 0;
+    for (int i = 0; i < DISPLAY_WORDS; i++)
+      c8->buffer[i] = get64(&p);
+    memcpy(c8->rpl, p, RPL_FLAGS);
+    p += RPL_FLAGS;
+    if (version == SAVESTATE_VERSION)
+      p++;
+  }
+  c8->awaited_key = awaited_key;
+
+  // A state without the XO-CHIP section leaves none of its state behind
+  if (xochip) {
+    c8->planes = get8(&p) & ((1 << DISPLAY_PLANES) - 1);
+    c8->pitch = get8(&p);
+    memcpy(c8->audio_pattern, p, AUDIO_PATTERN_SIZE);
+    p += AUDIO_PATTERN_SIZE;
+    memcpy(&c8->rpl[RPL_FLAGS], p, XO_RPL_FLAGS - RPL_FLAGS);
+    p += XO_RPL_FLAGS - RPL_FLAGS;
+    for (int i = 0; i < DISPLAY_WORDS; i++)
+      c8->buffer[DISPLAY_WORDS + i] = get64(&p);
+    memcpy(&c8->memory[MEMORY_SIZE], p, XO_MEMORY_SIZE - MEMORY_SIZE);
+  } else {
+    c8->planes = 1;
+    c8->pitch = DEFAULT_PITCH;
+    memset(c8->audio_pattern, DEFAULT_AUDIO_PATTERN, AUDIO_PATTERN_SIZE);
+    memset(&c8->rpl[RPL_FLAGS], 0, XO_RPL_FLAGS - RPL_FLAGS);
+    memset(&c8->buffer[DISPLAY_WORDS], 0,
+           (DISPLAY_PLANES - 1) * DISPLAY_WORDS * sizeof(uint64_t));
+    if (c8->memory_size > MEMORY_SIZE)
+      memset(&c8->memory[MEMORY_SIZE], 0, c8->memory_size - MEMORY_SIZE);
+  }
+
+  // Code may have changed anywhere, and the whole display must be redrawn
+  memory_written(c8, 0, MEMORY_SIZE);
+  rehash(c8);
+  mark_display_dirty(c8);
+  c8->draw = true;
+  c8->opcode = 0;
+  return SUCCESS;
+}
+
+int save_state_file(const Chip8 *c8, const char *filename) {
+  uint8_t *state = malloc(SAVESTATE_MAX_SIZE);
+  if (state == NULL) {
+    log_error("Error: Failed to allocate memory for save state.");
+    return ERR;
+  }
+
+  FILE *fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    log_error("Failed to open save state file: %s", filename);
+    free(state);
+    return ERR;
+  }
+
+  size_t size = save_state(c8, state);
+  size_t written = fwrite(state, 1, size, fp);
+  free(state);
+  if (fclose(fp) != 0 || written != size) {
+    log_error("Failed to write save state file: %s", filename);
+    return ERR;
+  }
+  return SUCCESS;
+}
+
+uint8_t *read_state_file(const char *filename, size_t *size) {
+  FILE *fp = fopen(filename, "rb");
+  uint8_t *data = NULL;
+
+  if (fp == NULL) {
+    log_error("Failed to open save state file: %s", filename);
+    return NULL;
+  }
+
+  data = malloc(SAVESTATE_MAX_SIZE + 1);
+  if (data == NULL) {
+    log_error("Error: Failed to allocate memory for save state.");
+    fclose(fp);
+    return NULL;
+  }
+
+  // Read one byte more than a state holds, to detect oversized files
+  *size = fread(data, 1, SAVESTATE_MAX_SIZE + 1, fp);
+  fclose(fp);
+  return data;
+}
+
+int load_state_file(Chip8 *c8, const char *filename) {
+  size_t size;
+  uint8_t *data = read_state_file(filename, &size);
+  if (data == NULL)
+    return ERR;
+
+  int status = load_state(c8, data, size);
+  free(data);
+  if (status == SUCCESS)
+    log_info("Loaded save state: %s", filename);
+  return status;
+}
+
+bool is_state_file(const char *filename) {
+  char magic[4];
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL)
+    return false;
+
+  bool match = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+               memcmp(magic, SAVESTATE_MAGIC, sizeof(magic)) == 0;
+  fclose(fp);
+  return match;
+}
\ No newline at end of file
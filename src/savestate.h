@@ -0,0 +1,98 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include "chip8.h"
+
+// File signature and format version of a save state
+#define SAVESTATE_MAGIC "C8SS"
+#define SAVESTATE_VERSION 3
+
+// Header flag of a state saved under XO-CHIP
+#define SAVESTATE_XOCHIP 0x1
+// The quirk profile a state was saved under is the high byte of the flags
+#define SAVESTATE_PROFILE_SHIFT 8
+
+/*
+ * Layout of a save state, every value little-endian:
+ *
+ *   magic "C8SS" | u16 version | u16 flags | u32 payload size
+ *   payload:
+ *     memory[MEMORY_SIZE] | V0..VF | u16 stack[STACKSIZE] | u16 I | u16 PC
+ *     | u8 SP | u8 delay timer | u8 sound timer | u16 keypad mask
+ *     | u32 RNG state | u8 high resolution | u64 display[DISPLAY_WORDS]
+ *     | u8 rpl[RPL_FLAGS] | i8 key FX0A waits to see released (-1 -> none)
+ *     if flags has SAVESTATE_XOCHIP:
+ *     | u8 planes | u8 pitch | u8 audio pattern[AUDIO_PATTERN_SIZE]
+ *     | u8 rpl[RPL_FLAGS..XO_RPL_FLAGS] | u64 second plane[DISPLAY_WORDS]
+ *     | memory[MEMORY_SIZE..XO_MEMORY_SIZE]
+ *   u64 FNV-1a hash of the payload
+ *
+ * States of the other profiles have no SAVESTATE_XOCHIP flag and are
+ * SAVESTATE_SIZE bytes. A state only loads under the profile it was saved
+ * with. Version 2 states, which record no profile and no key awaited by
+ * FX0A, load under any profile, except XO-CHIP ones outside XO-CHIP.
+ * Version 1 states, which end the
+ * payload with u64 rows[SCREEN_HEIGHT] of a low resolution display, can
+ * still be loaded.
+ */
+#define SAVESTATE_HEADER_SIZE 12
+#define SAVESTATE_REGISTERS_SIZE                                               \
+  (MEMORY_SIZE + 16 + STACKSIZE * 2 + 2 + 2 + 1 + 1 + 1 + 2 + 4)
+#define SAVESTATE_PAYLOAD_SIZE                                                 \
+  (SAVESTATE_REGISTERS_SIZE + 1 + DISPLAY_WORDS * 8 + RPL_FLAGS + 1)
+#define SAVESTATE_SIZE (SAVESTATE_HEADER_SIZE + SAVESTATE_PAYLOAD_SIZE + 8)
+#define SAVESTATE_XOCHIP_SIZE                                                  \
+  (1 + 1 + AUDIO_PATTERN_SIZE + XO_RPL_FLAGS - RPL_FLAGS + DISPLAY_WORDS * 8 + \
+   XO_MEMORY_SIZE - MEMORY_SIZE)
+// Size of the largest save state, one saved under XO-CHIP
+#define SAVESTATE_MAX_SIZE (SAVESTATE_SIZE + SAVESTATE_XOCHIP_SIZE)
+#define SAVESTATE_V2_PAYLOAD_SIZE (SAVESTATE_PAYLOAD_SIZE - 1)
+#define SAVESTATE_V1_PAYLOAD_SIZE                                              \
+  (SAVESTATE_REGISTERS_SIZE + SCREEN_HEIGHT * 8)
+#define SAVESTATE_V1_SIZE                                                      \
+  (SAVESTATE_HEADER_SIZE + SAVESTATE_V1_PAYLOAD_SIZE + 8)
+
+/// @brief Get the size of the save state of a Chip8 instance
+/// @param c8 The Chip8 instance
+/// @return SAVESTATE_MAX_SIZE under XO-CHIP, SAVESTATE_SIZE otherwise
+size_t save_state_size(const Chip8 *c8);
+
+/// @brief Serialize the machine state of a Chip8 instance
+/// @param c8 The Chip8 instance to capture
+/// @param out The buffer to write to, save_state_size bytes
+/// @return The size of the save state in bytes
+size_t save_state(const Chip8 *c8, uint8_t *out);
+
+/// @brief Restore the machine state of a Chip8 instance
+/// The state is validated before anything is changed, so on error the
+/// instance is left as it was.
+/// @param c8 The Chip8 instance to restore
+/// @param data The save state
+/// @param size The size of the save state in bytes
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int load_state(Chip8 *c8, const uint8_t *data, size_t size);
+
+/// @brief Write the machine state of a Chip8 instance to a file
+/// @param c8 The Chip8 instance to capture
+/// @param filename The file to write
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int save_state_file(const Chip8 *c8, const char *filename);
+
+/// @brief Restore the machine state of a Chip8 instance from a file
+/// @param c8 The Chip8 instance to restore
+/// @param filename The file to read
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int load_state_file(Chip8 *c8, const char *filename);
+
+/// @brief Read a save state file into a newly allocated buffer
+/// @param filename The file to read
+/// @param size Set to the size of the save state in bytes
+/// @return The save state, or NULL if the file is not a save state
+uint8_t *read_state_file(const char *filename, size_t *size);
+
+/// @brief Checks if a file starts with the save state signature
+/// @param filename The file to check
+/// @return true if the file looks like a save state
+bool is_state_file(const char *filename);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "scheduler.h"
+
+double scheduler_clock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint32_t frame_cycles(uint32_t ips, uint64_t frame) {
+  return (frame + 1) * ips / TIMER_HZ - frame * ips / TIMER_HZ;
+}
+
+void scheduler_init(Scheduler *s, uint32_t ips, double now) {
+  memset(s, 0, sizeof(Scheduler));
+  s->ips = ips;
+  s->speed = 1;
+  s->origin = now;
+  s->last = now;
+}
+
+/**
+ * @brief Runs instructions frame by frame, ticking the timers at the end of
+ * each frame.
+ *
+ * @param s The scheduler.
+ * @param c8 A pointer to the Chip8 instance.
+ * @param budget The number of instructions to run.
+ * @param hooks Called at the edges of every frame, or NULL.
+ * @return The number of frames completed.
+ */
+static int run_cycles(Scheduler *s, Chip8 *c8, uint64_t budget,
+                      const FrameHooks *hooks) {
+  int frames = 0;
+
+  while (budget > 0 && c8->running) {
+    if (s->frame_done == 0 && hooks != NULL && hooks->frame_start != NULL)
+      hooks->frame_start(c8, hooks->ctx);
+
+    uint32_t left = frame_cycles(s->ips, s->frame) - s->frame_done;
+    uint32_t slice = budget < left ? budget : left;
+    cycle_cpu(c8, slice);
+    budget -= slice;
+    s->frame_done += slice;
+
+    if (slice == left) {
+      update_timers(c8);
+      s->frame++;
+      s->frame_done = 0;
+      frames++;
+      if (hooks != NULL && hooks->frame_end != NULL)
+        hooks->frame_end(c8, hooks->ctx);
+    }
+  }
+
+  return frames;
+}
+
+/**
+ * @brief Gets the instructions run so far.
+ *
+ * @param s The scheduler.
+ * @return The number of instructions since emulated time started.
+ */
+static uint64_t position(const Scheduler *s) {
+  return s->frame * s->ips / TIMER_HZ + s->frame_done;
+}
+
+double scheduler_tick_time(const Scheduler *s, uint32_t ticks) {
+  uint64_t cycle = (s->frame + ticks) * s->ips / TIMER_HZ;
+  return s->origin + cycle / (s->ips * s->speed);
+}
+
+/**
+ * @brief Run the instructions and timer ticks owed for the host time passed.
+ *
+ * A stall longer than SCHEDULER_MAX_LAG is only partly caught up, so a slow
+ * host runs the game slower instead of falling further behind every frame.
+ *
+ * @param s The scheduler.
+ * @param c8 A pointer to the Chip8 instance.
+ * @param now The current clock reading.
+ * @param hooks Called at the edges of every frame, or NULL.
+ * @return The number of frames completed.
+ */
+int scheduler_run(Scheduler *s, Chip8 *c8, double now,
+                  const FrameHooks *hooks) {
+  double elapsed = now - s->last;
+  if (elapsed > SCHEDULER_MAX_LAG) {
+    s->origin += elapsed - SCHEDULER_MAX_LAG;
+    s->dropped += elapsed - SCHEDULER_MAX_LAG;
+  }
+  s->last = now;
+
+  double due = (now - s->origin) * s->ips * s->speed;
+  uint64_t done = position(s);
+  if (due <= done)
+    return 0;
+  return run_cycles(s, c8, (uint64_t)due - done, hooks);
+}
+
+/**
+ * @brief Moves the clock origin so the instructions run so far are exactly
+ * the ones due now.
+ *
+ * @param s The scheduler.
+ * @param now The current clock reading.
+ */
+static void rebase(Scheduler *s, double now) {
+  s->origin = now - position(s) / (s->ips * s->speed);
+  s->last = now;
+}
+
+/**
+ * @brief Run whole emulated frames as fast as possible for a while.
+ *
+ * The clock is read once per frame, so the time spent overshoots by at most
+ * one frame.
+ *
+ * @param s The scheduler.
+ * @param c8 A pointer to the Chip8 instance.
+ * @param seconds The host time to spend.
+ * @param hooks Called at the edges of every frame, or NULL.
+ * @return The number of frames completed.
+ */
+int scheduler_run_unbounded(Scheduler *s, Chip8 *c8, double seconds,
+                            const FrameHooks *hooks) {
+  double start = scheduler_clock(), now;
+  int frames = 0;
+
+  do {
+    frames += run_cycles(s, c8, frame_cycles(s->ips, s->frame) - s->frame_done,
+                         hooks);
+    now = scheduler_clock();
+  } while (c8->running && now - start < seconds);
+
+  rebase(s, now);
+  return frames;
+}
+
+void scheduler_set_speed(Scheduler *s, double speed, double now) {
+  if (speed == s->speed)
+    return;
+  s->speed = speed;
+  rebase(s, now);
+}
+
+void scheduler_finish_frame(Scheduler *s, Chip8 *c8, const FrameHooks *hooks) {
+  if (s->frame_done > 0)
+    run_cycles(s, c8, frame_cycles(s->ips, s->frame) - s->frame_done, hooks);
+}
+
+void scheduler_skip(Scheduler *s, double now) {
+  s->origin += now - s->last;
+  s->last = now;
+}
+
+void scheduler_step_back(Scheduler *s, double now) {
+  if (s->frame > 0)
+    s->frame--;
+  s->frame_done = 0;
+  rebase(s, now);
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "chip8.h"
+
+// Rate of the delay and sound timers, in ticks per emulated second
+#define TIMER_HZ 60
+// Instructions per second when none is given, one CYCLES_PER_FRAME per tick
+#define DEFAULT_IPS (CYCLES_PER_FRAME * TIMER_HZ)
+// Most host time caught up in one call, the rest of a stall is dropped
+#define SCHEDULER_MAX_LAG 0.1
+
+/*
+ * Emulated time is counted in instructions. Timer tick t happens after
+ * instruction floor(t * ips / TIMER_HZ), so the timers run at exactly 60 Hz
+ * of emulated time for any rate, and the instructions between two ticks
+ * form an emulated frame. Instructions owed are counted from the clock
+ * reading emulated time started at, not summed per call, so fractions of an
+ * instruction carry over and rounding never drifts.
+ */
+typedef struct {
+  uint32_t ips;
+  double speed;        // Multiple of ips run per host second
+  double origin;       // Clock reading at which instruction 0 was due
+  double last;         // Clock reading of the last call
+  uint64_t frame;      // Emulated frame being run
+  uint32_t frame_done; // Instructions of that frame already run
+  double dropped;      // Host seconds dropped to avoid catching up on them
+} Scheduler;
+
+// Called at the edges of every emulated frame
+typedef struct {
+  // Before the first instruction of a frame
+  void (*frame_start)(Chip8 *c8, void *ctx);
+  // After the timer tick that ends a frame
+  void (*frame_end)(Chip8 *c8, void *ctx);
+  void *ctx;
+} FrameHooks;
+
+/// @brief Read the monotonic clock
+/// @return The current time in seconds
+double scheduler_clock(void);
+
+/// @brief Count the instructions of an emulated frame
+/// @param ips The instructions per second
+/// @param frame The frame number, from 0
+/// @return The number of instructions between its start and its timer tick
+uint32_t frame_cycles(uint32_t ips, uint64_t frame);
+
+/// @brief Start scheduling at the beginning of an emulated frame
+/// @param s The scheduler
+/// @param ips The instructions per second to run, at least 1
+/// @param now The current clock reading
+void scheduler_init(Scheduler *s, uint32_t ips, double now);
+
+/// @brief Get the clock reading at which a coming timer tick is due
+/// @param s The scheduler
+/// @param ticks The tick, 1 -> the one that ends the current frame
+/// @return The clock reading, valid until the speed or the origin changes
+double scheduler_tick_time(const Scheduler *s, uint32_t ticks);
+
+/// @brief Run the instructions and timer ticks owed for the host time passed
+/// @param s The scheduler
+/// @param c8 The Chip8 instance to run
+/// @param now The current clock reading
+/// @param hooks Called at the edges of every emulated frame, or NULL
+/// @return The number of emulated frames completed
+int scheduler_run(Scheduler *s, Chip8 *c8, double now,
+                  const FrameHooks *hooks);
+
+/// @brief Run whole emulated frames as fast as possible for a while
+/// The clock is moved along afterwards, so the time spent is not caught up.
+/// @param s The scheduler
+/// @param c8 The Chip8 instance to run
+/// @param seconds The host time to spend, at least one frame is run
+/// @param hooks Called at the edges of every emulated frame, or NULL
+/// @return The number of emulated frames completed
+int scheduler_run_unbounded(Scheduler *s, Chip8 *c8, double seconds,
+                            const FrameHooks *hooks);
+
+/// @brief Change how fast emulated time passes relative to host time
+/// @param s The scheduler
+/// @param speed The multiple of the instructions per second to run, above 0
+/// @param now The current clock reading
+void scheduler_set_speed(Scheduler *s, double speed, double now);
+
+/// @brief Run the rest of the current emulated frame, if one was started
+/// @param s The scheduler
+/// @param c8 The Chip8 instance to run
+/// @param hooks Called at the end of the frame, or NULL
+void scheduler_finish_frame(Scheduler *s, Chip8 *c8, const FrameHooks *hooks);
+
+/// @brief Let host time pass without running, e.g. while paused
+/// @param s The scheduler
+/// @param now The current clock reading
+void scheduler_skip(Scheduler *s, double now);
+
+/// @brief Move back a frame after rewind_step restored an earlier one
+/// A partly run frame is abandoned along with the last completed one, and
+/// the next run starts the frame after the restored one.
+/// @param s The scheduler
+/// @param now The current clock reading
+void scheduler_step_back(Scheduler *s, double now);
+
+#endif
\ No newline at end of file
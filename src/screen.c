@@ -1,10 +1,18 @@
 #include "screen.h"
 #include "debug.h"
 
-#define SCREEN_WIDTH 64
-#define SCREEN_HEIGHT 32
-
-int WIDTH, HEIGHT, x_scale, y_scale;
+// Staging pixels and the texture they are uploaded to, one texel per pixel.
+// A 64x32 display uses the top left corner of the texture.
+static Color pixels[HIRES_WIDTH * HIRES_HEIGHT];
+static Texture2D texture;
+// Resolution of the display the texture holds
+static bool shown_hires;
+// Set once the window was drawn to
+static bool drawn;
+// Colour of a pixel by the planes it is set in, bit p for plane p. Only
+// XO-CHIP draws to the second plane.
+static const Color palette[1 << DISPLAY_PLANES] = {BLACK, RAYWHITE, ORANGE,
+                                                   BROWN};
 
 /**
  * Initialises the Chip8 screen
@@ -14,31 +22,97 @@ int WIDTH, HEIGHT, x_scale, y_scale;
  * @param fps Chip8 framerate
  */
 void init_screen(int W, int H, int fps) {
+  SetConfigFlags(FLAG_WINDOW_RESIZABLE);
   InitWindow(W, H, "Chip8 Emulator");
   SetTargetFPS(fps);
   ClearBackground(BLACK);
 
-  x_scale = floor(W / SCREEN_WIDTH);
-  y_scale = floor(H / SCREEN_HEIGHT);
+  Image image = GenImageColor(HIRES_WIDTH, HIRES_HEIGHT, BLACK);
+  texture = LoadTextureFromImage(image);
+  UnloadImage(image);
+  SetTextureFilter(texture, TEXTURE_FILTER_POINT);
 }
 
 /**
- * Update the grahpics of the screen with the contents of the next frame buffer
+ * Upload the rows of a frame that changed to the screen texture
+ * The rows in the mask are expanded into RGBA texels and the span covering
+ * them is sent to the GPU with a single texture update. Every row is
+ * uploaded when the resolution changes.
  *
- * @param buffer Chip8 frame buffer
+ * @param frame The display as in Chip8.buffer
+ * @param hires true if the display is 128x64, false if it is 64x32
+ * @param rows Mask of the rows that changed, as from take_dirty_rows
+ * @return true if the texture changed
  */
-void update_screen(uint32_t buffer[]) {
-  for (int x = 0; x < SCREEN_WIDTH; x++) {
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-      if (buffer[x + (y * SCREEN_WIDTH)] == 1)
-        DrawRectangle(x * x_scale, y * y_scale, x_scale, y_scale, RAYWHITE);
-      else
-        DrawRectangle(x * x_scale, y * y_scale, x_scale, y_scale, BLACK);
+bool update_screen(const uint64_t frame[DISPLAY_PLANES * DISPLAY_WORDS],
+                   bool hires, uint64_t rows) {
+  int width = hires ? HIRES_WIDTH : SCREEN_WIDTH;
+  int height = hires ? HIRES_HEIGHT : SCREEN_HEIGHT;
+  int stride = width / 64; // Words per row
+
+  if (hires != shown_hires)
+    rows = ~0ull;
+  rows &= ~0ull >> (64 - height);
+  shown_hires = hires;
+  if (rows == 0)
+    return false;
+
+  int first = __builtin_ctzll(rows);
+  int last = 63 - __builtin_clzll(rows);
+
+  for (int y = first; y <= last; y++) {
+    if (!(rows & (1ull << y)))
+      continue;
+
+    Color *texel = &pixels[y * width];
+    for (int x = 0; x < width; x++) {
+      int word = y * stride + x / 64, colour = 0;
+      for (int p = 0; p < DISPLAY_PLANES; p++)
+        colour |= ((frame[p * DISPLAY_WORDS + word] >> (63 - x % 64)) & 1) << p;
+      texel[x] = palette[colour];
     }
   }
 
-  if (is_debugger_enabled())
+  Rectangle span = {0, first, width, last - first + 1};
+  UpdateTextureRec(texture, span, &pixels[first * width]);
+  return true;
+}
+
+/**
+ * Draw the screen texture as one quad, scaled by the same factor on both
+ * axes so pixels stay square, and centred in the window
+ */
+void draw_screen(void) {
+  float width = GetScreenWidth(), height = GetScreenHeight();
+  float columns = shown_hires ? HIRES_WIDTH : SCREEN_WIDTH;
+  float rows = shown_hires ? HIRES_HEIGHT : SCREEN_HEIGHT;
+  float scale = fminf(width / columns, height / rows);
+  Rectangle source = {0, 0, columns, rows};
+  Rectangle dest = {(width - columns * scale) / 2, (height - rows * scale) / 2,
+                    columns * scale, rows * scale};
+
+  drawn = true;
+  ClearBackground(BLACK);
+  DrawTexturePro(texture, source, dest, (Vector2){0, 0}, 0, WHITE);
+
+  if (is_debugger_enabled()) {
     DrawFPS(0, 0);
+    DrawText(TextFormat("%.2f ms", GetFrameTime() * 1000), 0, 20, 20, GREEN);
+  }
+}
+
+/**
+ * Check if the window must be drawn although the texture did not change
+ * The debug overlay changes every frame, and a new or resized window has
+ * to be laid out again.
+ *
+ * @return true if draw_screen should be called
+ */
+bool screen_needs_redraw(void) {
+  return !drawn || IsWindowResized() || is_debugger_enabled();
 }
 
-void close_screen(void) { CloseWindow(); }
\ No newline at end of file
+void close_screen(void) {
+  UnloadTexture(texture);
+  CloseWindow();
+}
\ No newline at end of file
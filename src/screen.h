@@ -4,9 +4,13 @@
 #include "math.h"
 #include "raylib.h"
 #include "stdint.h"
+#include "chip8.h"
 
 void init_screen(int W, int H, int fps);
 void close_screen(void);
-void update_screen(uint32_t buffer[]);
+bool update_screen(const uint64_t frame[DISPLAY_PLANES * DISPLAY_WORDS],
+                   bool hires, uint64_t rows);
+void draw_screen(void);
+bool screen_needs_redraw(void);
 
 #endif
\ No newline at end of file
@@ -1,45 +1,74 @@
 #include "speaker.h"
+#include "tone.h"
 
-/**
- * Initialises the Chip8 speaker system
- * First initialise the audio device which will play sound.
- * Lastly, loads the SFX resource file and pass it to the Chip8 instance.
- * 
- * @param c8 The Chip8 instance
- */
-void init_speaker(Chip8 *c8) {
-  InitAudioDevice();
-  c8->sfx = LoadSound(SFX);
-}
+// Samples per callback, small so the tone starts soon after the sound timer
+#define BUFFER_SAMPLES 256
+
+// The stream is owned by the frontend so the Chip8 core stays free of raylib
+static AudioStream stream;
+static Tone tone;
+static const SoundState *tone_sound;
 
 /**
- * Handles the sound event for the Chip8 speaker system
- * First checks if the sound timer has reached 0.
- * If so, play the sound.
- * 
- * @param c8 The Chip8 instance
+ * Fills the next buffer of the audio stream, called on the audio thread
+ * Under XO-CHIP the audio pattern is played instead of the plain tone.
+ *
+ * Sample i of the buffer is taken to play at the time of the call plus
+ * i / TONE_SAMPLE_RATE, plus the output latency of the device, which
+ * delays the start and the end of the tone alike. The tone stops on the
+ * sample at which the sound timer runs out, give or take the jitter of the
+ * callback, but only starts with the buffer after the sound timer is set.
+ *
+ * @param buffer The buffer, mono 16-bit samples
+ * @param frames The number of samples to write
  */
-void handle_sound(Chip8 *c8) {
-  if (c8->sound_timer == 0) {
-    PauseSound(c8->sfx);
+static void fill_audio(void *buffer, unsigned int frames) {
+  double left = atomic_load_explicit(&tone_sound->until, memory_order_relaxed) -
+                scheduler_clock();
+  unsigned int gate = 0;
+  if (left > 0)
+    gate = left * TONE_SAMPLE_RATE < frames ? left * TONE_SAMPLE_RATE : frames;
+
+  if (!atomic_load_explicit(&tone_sound->pattern, memory_order_relaxed)) {
+    tone_render(&tone, buffer, frames, gate);
     return;
   }
 
-  if (!IsSoundPlaying(c8->sfx))
-    PlaySound(c8->sfx);
-  else
-    ResumeSound(c8->sfx);
+  uint8_t pattern[TONE_PATTERN_BYTES];
+  for (int w = 0; w < 2; w++) {
+    uint64_t bits =
+        atomic_load_explicit(&tone_sound->bits[w], memory_order_relaxed);
+    for (int i = 0; i < 8; i++)
+      pattern[w * 8 + i] = bits >> (56 - 8 * i);
+  }
+  tone_render_pattern(
+      &tone, buffer, frames, gate, pattern,
+      atomic_load_explicit(&tone_sound->pitch, memory_order_relaxed));
+}
+
+/**
+ * Initialises the Chip8 speaker system
+ * First initialise the audio device which will play sound.
+ * Lastly, starts a stream that synthesizes the tone while the gate is set.
+ *
+ * @param sound The sound requested by the emulation thread
+ */
+void init_speaker(const SoundState *sound) {
+  tone_sound = sound;
+  InitAudioDevice();
+  SetAudioStreamBufferSizeDefault(BUFFER_SAMPLES);
+  stream = LoadAudioStream(TONE_SAMPLE_RATE, 16, 1);
+  SetAudioStreamCallback(stream, fill_audio);
+  PlayAudioStream(stream);
 }
 
 /**
  * Closes the Chip8 speaker system
- * First unload the SFX Sound.
+ * First stop and unload the stream.
  * Lastly, closes the audio device.
- * 
- * @param c8 The Chip8 instance
  */
-void close_speaker(Chip8 *c8) {
-  StopSound(c8->sfx);
-  UnloadSound(c8->sfx);
+void close_speaker(void) {
+  StopAudioStream(stream);
+  UnloadAudioStream(stream);
   CloseAudioDevice();
 }
\ No newline at end of file
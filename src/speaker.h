@@ -1,11 +1,10 @@
 #ifndef SPEAKER_H
 #define SPEAKER_H
 
+#include "emulator.h"
 #include "raylib.h"
-#include "chip8.h"
 
-void init_speaker(Chip8 *c8);
-void handle_sound(Chip8 *c8);
-void close_speaker(Chip8 *c8);
+void init_speaker(const SoundState *sound);
+void close_speaker(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "text.h"
+#include <string.h>
+
+void write_json_string(FILE *out, const char *s) {
+  fputc('"', out);
+  for (; *s != '\0'; s++) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', out);
+    fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+char *next_field(char **cursor) {
+  char *p = *cursor + strspn(*cursor, " \t\r\n");
+  char *field;
+
+  if (*p == '\0' || *p == '#')
+    return NULL;
+
+  if (*p == '"') {
+    field = ++p;
+    p = strchr(p, '"');
+    if (p == NULL)
+      return NULL;
+  } else {
+    field = p;
+    p += strcspn(p, " \t\r\n");
+  }
+
+  if (*p != '\0')
+    *p++ = '\0';
+  *cursor = p;
+  return field;
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <stdio.h>
+
+// Text formats shared by the command-line tools
+
+/// @brief Write a string as a JSON string literal
+/// @param out The stream to write to
+/// @param s The string, file names may hold quotes and backslashes
+void write_json_string(FILE *out, const char *s);
+
+/// @brief Split the next field off a line of a batch manifest or golden file
+/// Fields are separated by whitespace, a field in double quotes may hold
+/// spaces, and # starts a comment.
+/// @param cursor Points into the line, advanced past the field
+/// @return The field (NUL terminated in place), or NULL at the end of the
+///         line
+char *next_field(char **cursor);
+
+#endif
\ No newline at end of file
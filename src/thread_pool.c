@@ -0,0 +1,151 @@
+#include "thread_pool.h"
+#include "chip8_types.h"
+#include "logger.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+/*
+ * Each worker owns a range of job indices packed into one atomic word:
+ * the head in the low 32 bits and the tail in the high 32 bits. The owner
+ * takes jobs from the head and thieves take them from the tail, both with
+ * a compare-and-swap on the whole word, so a job is handed out only once.
+ */
+typedef struct {
+  _Atomic uint64_t range;
+  char padding[56]; // Keep every queue on its own cache line
+} WorkQueue;
+
+typedef struct {
+  WorkQueue *queues;
+  int count;
+  JobFn fn;
+  void *ctx;
+} Pool;
+
+typedef struct {
+  Pool *pool;
+  int id;
+} Worker;
+
+#define RANGE(head, tail) (((uint64_t)(tail) << 32) | (uint32_t)(head))
+#define HEAD(range) ((uint32_t)(range))
+#define TAIL(range) ((uint32_t)((range) >> 32))
+
+// Take the job at the head of a queue
+static bool pop_front(WorkQueue *queue, size_t *job) {
+  uint64_t range = atomic_load(&queue->range);
+
+  while (HEAD(range) < TAIL(range)) {
+    uint64_t next = RANGE(HEAD(range) + 1, TAIL(range));
+    if (atomic_compare_exchange_weak(&queue->range, &range, next)) {
+      *job = HEAD(range);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Take the job at the tail of another worker's queue
+static bool steal_back(WorkQueue *queue, size_t *job) {
+  uint64_t range = atomic_load(&queue->range);
+
+  while (HEAD(range) < TAIL(range)) {
+    uint64_t next = RANGE(HEAD(range), TAIL(range) - 1);
+    if (atomic_compare_exchange_weak(&queue->range, &range, next)) {
+      *job = TAIL(range) - 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Runs the jobs of its own queue, then steals until every queue is
+ * empty.
+ *
+ * @param arg The Worker to run.
+ * @return NULL.
+ */
+static void *worker_main(void *arg) {
+  Worker *worker = arg;
+  Pool *pool = worker->pool;
+  size_t job;
+
+  for (;;) {
+    if (pop_front(&pool->queues[worker->id], &job)) {
+      pool->fn(job, pool->ctx);
+      continue;
+    }
+
+    bool stolen = false;
+    for (int i = 1; i < pool->count && !stolen; i++) {
+      int victim = (worker->id + i) % pool->count;
+      stolen = steal_back(&pool->queues[victim], &job);
+    }
+    if (!stolen)
+      return NULL;
+    pool->fn(job, pool->ctx);
+  }
+}
+
+int default_thread_count(void) {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int)count : 1;
+}
+
+/**
+ * @brief Run jobs on a work-stealing thread pool and wait for all of them.
+ *
+ * @param job_count The number of jobs.
+ * @param thread_count The number of worker threads.
+ * @param fn The function that runs a job.
+ * @param ctx Passed to every call of fn.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int run_jobs(size_t job_count, int thread_count, JobFn fn, void *ctx) {
+  if (job_count > UINT32_MAX) {
+    log_error("Error: Too many jobs for the thread pool.");
+    return ERR;
+  }
+  if (thread_count < 1)
+    thread_count = 1;
+  if ((size_t)thread_count > job_count)
+    thread_count = job_count > 0 ? job_count : 1;
+
+  Pool pool = {NULL, thread_count, fn, ctx};
+  pool.queues = aligned_alloc(64, thread_count * sizeof(WorkQueue));
+  Worker *workers = malloc(thread_count * sizeof(Worker));
+  pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+  if (pool.queues == NULL || workers == NULL || threads == NULL) {
+    log_error("Error: Failed to allocate memory for the thread pool.");
+    free(pool.queues);
+    free(workers);
+    free(threads);
+    return ERR;
+  }
+
+  // Split the jobs into contiguous, evenly sized ranges
+  for (int i = 0; i < thread_count; i++) {
+    size_t head = job_count * i / thread_count;
+    size_t tail = job_count * (i + 1) / thread_count;
+    atomic_init(&pool.queues[i].range, RANGE(head, tail));
+    workers[i].pool = &pool;
+    workers[i].id = i;
+  }
+
+  // The calling thread works as worker 0
+  int started = 1;
+  for (int i = 1; i < thread_count; i++, started++) {
+    if (pthread_create(&threads[i], NULL, worker_main, &workers[i]) != 0)
+      break;
+  }
+  worker_main(&workers[0]);
+  for (int i = 1; i < started; i++)
+    pthread_join(threads[i], NULL);
+
+  free(pool.queues);
+  free(workers);
+  free(threads);
+  return SUCCESS;
+}
\ No newline at end of file
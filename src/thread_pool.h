@@ -0,0 +1,23 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+// A job run by the pool, job is the index of the job to run
+typedef void (*JobFn)(size_t job, void *ctx);
+
+/// @brief Number of worker threads to use when none is requested
+/// @return The number of online processors (at least 1)
+int default_thread_count(void);
+
+/// @brief Run jobs 0 to job_count - 1 on a work-stealing thread pool
+/// Jobs are split evenly between the workers up front; a worker that runs
+/// out of jobs steals from the back of another worker's queue.
+/// @param job_count The number of jobs
+/// @param thread_count The number of worker threads
+/// @param fn The function that runs a job
+/// @param ctx Passed to every call of fn
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int run_jobs(size_t job_count, int thread_count, JobFn fn, void *ctx);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "tone.h"
+
+// Samples per period of the square wave
+#define PERIOD (TONE_SAMPLE_RATE / TONE_FREQUENCY)
+// Length of the audio pattern, in 1/65536 bits
+#define PATTERN_LENGTH ((uint32_t)TONE_PATTERN_BYTES * 8 << 16)
+// Ratio between two pitch steps, 2^(1/48)
+#define PITCH_STEP 1.0145453349375237
+
+// Moves the volume one step towards on or off
+static int ramp(Tone *tone, bool on) {
+  int target = on ? TONE_RAMP_SAMPLES : 0;
+
+  if (tone->gain < target)
+    tone->gain++;
+  else if (tone->gain > target)
+    tone->gain--;
+  return tone->gain;
+}
+
+void tone_render(Tone *tone, int16_t *out, unsigned int count,
+                 unsigned int gate) {
+  for (unsigned int i = 0; i < count; i++) {
+    int gain = ramp(tone, i < gate);
+    int level = tone->phase < PERIOD / 2 ? TONE_AMPLITUDE : -TONE_AMPLITUDE;
+    out[i] = level * gain / TONE_RAMP_SAMPLES;
+
+    // The wave keeps running while silent, so it never restarts mid-period
+    tone->phase = (tone->phase + 1) % PERIOD;
+  }
+}
+
+// Bits of the pattern played per sample at a pitch, in 1/65536 bits. At
+// most 191 steps from the default pitch, so no libm is needed.
+static uint32_t pattern_step(uint8_t pitch) {
+  double rate = TONE_PATTERN_RATE;
+
+  for (int i = TONE_PATTERN_PITCH; i < pitch; i++)
+    rate *= PITCH_STEP;
+  for (int i = pitch; i < TONE_PATTERN_PITCH; i++)
+    rate /= PITCH_STEP;
+  return rate * 65536 / TONE_SAMPLE_RATE;
+}
+
+void tone_render_pattern(Tone *tone, int16_t *out, unsigned int count,
+                         unsigned int gate,
+                         const uint8_t pattern[TONE_PATTERN_BYTES],
+                         uint8_t pitch) {
+  uint32_t step = pattern_step(pitch);
+
+  for (unsigned int i = 0; i < count; i++) {
+    int gain = ramp(tone, i < gate);
+    uint32_t bit = tone->position >> 16;
+    int set = (pattern[bit / 8] >> (7 - bit % 8)) & 1;
+    int level = set ? TONE_AMPLITUDE : -TONE_AMPLITUDE;
+    out[i] = level * gain / TONE_RAMP_SAMPLES;
+
+    tone->position = (tone->position + step) % PATTERN_LENGTH;
+  }
+}
\ No newline at end of file
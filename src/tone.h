@@ -0,0 +1,52 @@
+#ifndef TONE_H
+#define TONE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Output format of the synthesized tone
+#define TONE_SAMPLE_RATE 44100
+#define TONE_FREQUENCY 440
+#define TONE_AMPLITUDE 8000
+// Samples the volume takes to fade in or out, 2 ms
+#define TONE_RAMP_SAMPLES (TONE_SAMPLE_RATE / 500)
+// XO-CHIP audio pattern: 128 bits played at TONE_PATTERN_RATE bits per
+// second at pitch TONE_PATTERN_PITCH, an octave higher every 48 steps
+#define TONE_PATTERN_BYTES 16
+#define TONE_PATTERN_RATE 4000
+#define TONE_PATTERN_PITCH 64
+
+// A square wave that fades in and out instead of switching abruptly
+typedef struct {
+  uint32_t phase;    // Position in the period, in samples
+  int gain;          // Current volume, 0 to TONE_RAMP_SAMPLES
+  uint32_t position; // Position in the audio pattern, in 1/65536 bits
+} Tone;
+
+/// @brief Fill a buffer with the tone
+/// The gate is open for the first samples of the buffer and closed after
+/// them, so the tone can stop at any sample. The volume moves one step per
+/// sample towards open or closed, so it fades without a click.
+/// @param tone The tone
+/// @param out The buffer, mono 16-bit samples
+/// @param count The number of samples to write
+/// @param gate The number of samples the tone should sound for, from the
+///        start of the buffer, count or more -> the whole buffer
+void tone_render(Tone *tone, int16_t *out, unsigned int count,
+                 unsigned int gate);
+
+/// @brief Fill a buffer with an XO-CHIP audio pattern
+/// The pattern loops MSB first, fading in and out like tone_render.
+/// @param tone The tone
+/// @param out The buffer, mono 16-bit samples
+/// @param count The number of samples to write
+/// @param gate The number of samples the pattern should sound for, as for
+///        tone_render
+/// @param pattern The audio pattern
+/// @param pitch The pitch register, TONE_PATTERN_PITCH for TONE_PATTERN_RATE
+void tone_render_pattern(Tone *tone, int16_t *out, unsigned int count,
+                         unsigned int gate,
+                         const uint8_t pattern[TONE_PATTERN_BYTES],
+                         uint8_t pitch);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "trace.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Records are written to the file as they are laid out in memory
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Execution traces are only supported on little-endian hosts"
+#endif
+_Static_assert(sizeof(TraceRecord) == 16, "Trace records must be 16 bytes");
+
+/**
+ * @brief Maps the next window of a trace file, growing the file to hold it.
+ *
+ * @param trace The trace being recorded.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int next_window(Trace *trace) {
+  uint64_t offset = 0;
+
+  if (trace->window != NULL) {
+    trace->records += trace->next - (TraceRecord *)trace->window;
+    if (trace->window_offset == 0)
+      trace->records -= TRACE_HEADER_SIZE / sizeof(TraceRecord);
+    munmap(trace->window, TRACE_WINDOW_SIZE);
+    trace->window = NULL;
+    offset = trace->window_offset + TRACE_WINDOW_SIZE;
+  }
+
+  if (ftruncate(trace->fd, offset + TRACE_WINDOW_SIZE) != 0)
+    return ERR;
+  uint8_t *window = mmap(NULL, TRACE_WINDOW_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, trace->fd, offset);
+  if (window == MAP_FAILED)
+    return ERR;
+
+  trace->window = window;
+  trace->window_offset = offset;
+  trace->next = (TraceRecord *)(offset == 0 ? window + TRACE_HEADER_SIZE
+                                            : window);
+  trace->end = (TraceRecord *)(window + TRACE_WINDOW_SIZE);
+  return SUCCESS;
+}
+
+/**
+ * @brief Creates a trace file and attaches it to a Chip8 instance.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param filename The file to write.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+int trace_start(Chip8 *c8, const char *filename) {
+  Trace *trace = calloc(1, sizeof(Trace));
+  if (trace == NULL) {
+    log_error("Failed to allocate memory for the trace.");
+    return ERR;
+  }
+
+  trace->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (trace->fd < 0) {
+    log_error("Could not create trace file: %s", filename);
+    free(trace);
+    return ERR;
+  }
+  if (next_window(trace) != SUCCESS) {
+    log_error("Could not map trace file: %s", filename);
+    close(trace->fd);
+    free(trace);
+    return ERR;
+  }
+
+  trace_stop(c8);
+  c8->trace = trace;
+  return SUCCESS;
+}
+
+/**
+ * @brief Writes the header of a trace, cuts the file down to the records
+ * written and detaches it.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ */
+void trace_stop(Chip8 *c8) {
+  Trace *trace = c8->trace;
+  if (trace == NULL)
+    return;
+
+  uint64_t count = trace->records;
+  if (trace->window != NULL) {
+    count += trace->next - (TraceRecord *)trace->window;
+    if (trace->window_offset == 0)
+      count -= TRACE_HEADER_SIZE / sizeof(TraceRecord);
+    munmap(trace->window, TRACE_WINDOW_SIZE);
+  }
+
+  uint8_t header[TRACE_HEADER_SIZE] = TRACE_MAGIC;
+  uint16_t version = TRACE_VERSION, record_size = sizeof(TraceRecord);
+  memcpy(header + 4, &version, 2);
+  memcpy(header + 6, &record_size, 2);
+  memcpy(header + 8, &count, 8);
+  if (pwrite(trace->fd, header, TRACE_HEADER_SIZE, 0) != TRACE_HEADER_SIZE ||
+      ftruncate(trace->fd, TRACE_HEADER_SIZE + count * sizeof(TraceRecord)))
+    log_error("Could not finish the trace file.");
+
+  close(trace->fd);
+  free(trace);
+  c8->trace = NULL;
+}
+
+/**
+ * @brief Interprets instructions one at a time, appending a record of each
+ * to the mapped window.
+ *
+ * The registers are compared as two words before and after every
+ * instruction to find the ones it changed. If the file cannot be grown, the
+ * trace is finished and the rest runs untraced.
+ *
+ * @param c8 A pointer to the Chip8 instance.
+ * @param max_cycles The maximum number of instructions to execute.
+ * @return The number of instructions executed, fewer if the instance stops.
+ */
+int trace_run(Chip8 *c8, int max_cycles) {
+  Trace *trace = c8->trace;
+
+  int cycle;
+  for (cycle = 0; cycle < max_cycles && c8->running; cycle++) {
+    if (trace->next == trace->end && next_window(trace) != SUCCESS) {
+      log_error("Could not grow the trace file, tracing stopped.");
+      trace_stop(c8);
+      return cycle + cycle_cpu(c8, max_cycles - cycle);
+    }
+
+    uint64_t before[2], after[2];
+    memcpy(before, c8->registers, sizeof(before));
+
+    TraceRecord *record = trace->next++;
+    record->cycle = trace->cycle++;
+    record->pc = c8->pc;
+    fetch_opcode(c8);
+    execute_instruction(c8);
+    record->opcode = c8->opcode;
+    record->i = c8->IRegister;
+
+    memcpy(after, c8->registers, sizeof(after));
+    uint64_t low = before[0] ^ after[0], high = before[1] ^ after[1];
+    if ((low | high) == 0) {
+      record->reg = TRACE_NO_REGISTER;
+      record->value = 0;
+      continue;
+    }
+
+    // Registers are bytes, so the lowest set bit gives the lowest register
+    int reg = low ? __builtin_ctzll(low) / 8 : 8 + __builtin_ctzll(high) / 8;
+    if (low)
+      low &= ~(0xFFull << (reg * 8));
+    else
+      high &= ~(0xFFull << ((reg - 8) * 8));
+    record->reg = reg | ((low | high) ? TRACE_MORE_REGISTERS : 0);
+    record->value = c8->registers[reg];
+  }
+  return cycle;
+}
+
+/**
+ * @brief Maps a whole trace file read-only and checks its header.
+ *
+ * @param filename The file to read.
+ * @param count Set to the number of records.
+ * @param size Set to the number of bytes mapped.
+ * @return The file contents, or NULL on error.
+ */
+const uint8_t *trace_map(const char *filename, uint64_t *count, size_t *size) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    log_error("Could not open trace file: %s", filename);
+    return NULL;
+  }
+
+  struct stat st;
+  uint8_t *data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= TRACE_HEADER_SIZE)
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    log_error("Could not map trace file: %s", filename);
+    return NULL;
+  }
+
+  uint16_t version, record_size;
+  memcpy(&version, data + 4, 2);
+  memcpy(&record_size, data + 6, 2);
+  memcpy(count, data + 8, 8);
+  if (memcmp(data, TRACE_MAGIC, 4) != 0 || version != TRACE_VERSION ||
+      record_size != sizeof(TraceRecord) ||
+      *count > (st.st_size - TRACE_HEADER_SIZE) / sizeof(TraceRecord)) {
+    log_error("Not a trace file, or an unfinished one: %s", filename);
+    munmap(data, st.st_size);
+    return NULL;
+  }
+
+  *size = st.st_size;
+  return data;
+}
+
+void trace_unmap(const uint8_t *data, size_t size) {
+  munmap((void *)data, size);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "chip8.h"
+
+// File signature and format version of an execution trace
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+
+/*
+ * Layout of an execution trace, every value little-endian:
+ *
+ *   magic "C8TR" | u16 version | u16 record size (16) | u64 record count
+ *   records, one per instruction executed:
+ *     u64 cycle | u16 PC | u16 opcode | u16 I after | u8 register | u8 value
+ *
+ * register is the lowest register the instruction changed, with
+ * TRACE_MORE_REGISTERS set if it changed others too, or TRACE_NO_REGISTER,
+ * and value is what that register holds afterwards.
+ */
+#define TRACE_HEADER_SIZE 16
+#define TRACE_NO_REGISTER 0xFF
+#define TRACE_MORE_REGISTERS 0x10
+
+// Bytes of the file mapped at a time while recording
+#define TRACE_WINDOW_SIZE (64 << 20)
+
+typedef struct {
+  uint64_t cycle;
+  uint16_t pc;
+  uint16_t opcode;
+  uint16_t i;
+  uint8_t reg;
+  uint8_t value;
+} TraceRecord;
+
+// A trace being recorded through a window mapped over the end of its file
+typedef struct Trace {
+  int fd;
+  uint8_t *window;
+  uint64_t window_offset; // File offset of the window
+  TraceRecord *next;      // Where the next record goes
+  TraceRecord *end;       // End of the window
+  uint64_t records;       // Records in earlier windows
+  uint64_t cycle;         // Instructions executed since the trace started
+} Trace;
+
+/// @brief Start recording every instruction a Chip8 instance executes
+/// While a trace is recorded, instructions are executed one at a time by
+/// the interpreter whatever the engine selected.
+/// @param c8 The Chip8 instance
+/// @param filename The file to write, replaced if it exists
+/// @return Status of the operation (0 -> Success, 1 -> Error)
+int trace_start(Chip8 *c8, const char *filename);
+
+/// @brief Stop recording and finish the trace file, if one is recorded
+/// @param c8 The Chip8 instance
+void trace_stop(Chip8 *c8);
+
+/// @brief Execute up to max_cycles instructions, recording each of them
+/// @param c8 The Chip8 instance, with a trace started
+/// @param max_cycles The maximum number of instructions to execute
+/// @return The number of instructions executed, fewer if the instance stops
+int trace_run(Chip8 *c8, int max_cycles);
+
+/// @brief Map a trace file for reading
+/// @param filename The file to read
+/// @param count Set to the number of records
+/// @param size Set to the number of bytes mapped, for trace_unmap
+/// @return The file contents, records from TRACE_HEADER_SIZE on, or NULL if
+/// the file is not a trace
+const uint8_t *trace_map(const char *filename, uint64_t *count, size_t *size);
+
+/// @brief Unmap a trace file mapped by trace_map
+/// @param data The file contents
+/// @param size The number of bytes mapped
+void trace_unmap(const uint8_t *data, size_t size);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "trace.h"
+#include <ctype.h>
+
+// Which records are printed
+typedef struct {
+  uint16_t pc_low, pc_high;
+  uint16_t opcode_mask, opcode_value;
+  uint64_t cycle_low, cycle_high;
+  uint64_t limit; // 0 -> no limit
+} TraceFilter;
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s <trace> [--pc LOW-HIGH] [--opcode PATTERN] "
+          "[--cycles FIRST-LAST] [--limit N]\n"
+          "PC ranges are hexadecimal, e.g. --pc 200-2ff. An opcode pattern "
+          "is four hexadecimal digits, any other character matching any "
+          "digit, e.g. --opcode 8xy4 or --opcode dxyn\n",
+          prog);
+}
+
+/**
+ * @brief Parses a range of the form LOW-HIGH, or a single value.
+ *
+ * @param arg The range.
+ * @param base The base of the numbers.
+ * @param low Set to the first value in the range.
+ * @param high Set to the last value in the range.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int parse_range(const char *arg, int base, uint64_t *low,
+                       uint64_t *high) {
+  char *end;
+  *low = strtoull(arg, &end, base);
+  if (end == arg)
+    return ERR;
+  if (*end == '\0') {
+    *high = *low;
+    return SUCCESS;
+  }
+  if (*end != '-')
+    return ERR;
+
+  arg = end + 1;
+  *high = strtoull(arg, &end, base);
+  return end == arg || *end != '\0' || *high < *low ? ERR : SUCCESS;
+}
+
+/**
+ * @brief Parses an opcode pattern into a mask of the digits that must match
+ * and their values.
+ *
+ * @param arg The pattern, four characters.
+ * @param filter Filled in with the mask and the value.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int parse_opcode(const char *arg, TraceFilter *filter) {
+  if (strlen(arg) != 4)
+    return ERR;
+
+  filter->opcode_mask = 0;
+  filter->opcode_value = 0;
+  for (int i = 0; i < 4; i++) {
+    filter->opcode_mask <<= 4;
+    filter->opcode_value <<= 4;
+    if (isxdigit((unsigned char)arg[i])) {
+      char digit[2] = {arg[i], '\0'};
+      filter->opcode_mask |= 0xF;
+      filter->opcode_value |= strtoul(digit, NULL, 16);
+    }
+  }
+  return SUCCESS;
+}
+
+/**
+ * @brief Writes the assembly form of an opcode.
+ *
+ * @param opcode The opcode.
+ * @param out The buffer to write to.
+ * @param size The size of the buffer.
+ */
+static void disassemble(uint16_t opcode, char *out, size_t size) {
+  int x = (opcode >> 8) & 0xF, y = (opcode >> 4) & 0xF, n = opcode & 0xF;
+  int kk = opcode & 0xFF, nnn = opcode & 0xFFF;
+  static const char *const ALU[16] = {"LD",   "OR",  "AND", "XOR", "ADD",
+                                      "SUB",  "SHR", "SUBN", NULL, NULL,
+                                      NULL,   NULL,  NULL,  NULL,  "SHL"};
+
+  switch (opcode >> 12) {
+  case 0x0:
+    if (opcode == 0x00E0)
+      snprintf(out, size, "CLS");
+    else if (opcode == 0x00EE)
+      snprintf(out, size, "RET");
+    else
+      snprintf(out, size, "SYS %03X", nnn);
+    return;
+  case 0x1:
+    snprintf(out, size, "JP %03X", nnn);
+    return;
+  case 0x2:
+    snprintf(out, size, "CALL %03X", nnn);
+    return;
+  case 0x3:
+    snprintf(out, size, "SE V%X, %02X", x, kk);
+    return;
+  case 0x4:
+    snprintf(out, size, "SNE V%X, %02X", x, kk);
+    return;
+  case 0x5:
+    snprintf(out, size, "SE V%X, V%X", x, y);
+    return;
+  case 0x6:
+    snprintf(out, size, "LD V%X, %02X", x, kk);
+    return;
+  case 0x7:
+    snprintf(out, size, "ADD V%X, %02X", x, kk);
+    return;
+  case 0x8:
+    if (ALU[n] != NULL) {
+      snprintf(out, size, "%s V%X, V%X", ALU[n], x, y);
+      return;
+    }
+    break;
+  case 0x9:
+    snprintf(out, size, "SNE V%X, V%X", x, y);
+    return;
+  case 0xA:
+    snprintf(out, size, "LD I, %03X", nnn);
+    return;
+  case 0xB:
+    snprintf(out, size, "JP V0, %03X", nnn);
+    return;
+  case 0xC:
+    snprintf(out, size, "RND V%X, %02X", x, kk);
+    return;
+  case 0xD:
+    snprintf(out, size, "DRW V%X, V%X, %X", x, y, n);
+    return;
+  case 0xE:
+    if (kk == 0x9E || kk == 0xA1) {
+      snprintf(out, size, "%s V%X", kk == 0x9E ? "SKP" : "SKNP", x);
+      return;
+    }
+    break;
+  case 0xF: {
+    static const struct {
+      uint8_t kk;
+      const char *format;
+    } MISC[] = {{0x07, "LD V%X, DT"}, {0x0A, "LD V%X, K"},
+                {0x15, "LD DT, V%X"}, {0x18, "LD ST, V%X"},
+                {0x1E, "ADD I, V%X"}, {0x29, "LD F, V%X"},
+                {0x33, "LD B, V%X"},  {0x55, "LD [I], V%X"},
+                {0x65, "LD V%X, [I]"}};
+    for (size_t i = 0; i < sizeof(MISC) / sizeof(MISC[0]); i++) {
+      if (MISC[i].kk == kk) {
+        snprintf(out, size, MISC[i].format, x);
+        return;
+      }
+    }
+    break;
+  }
+  }
+  snprintf(out, size, "???");
+}
+
+int main(int argc, char **argv) {
+  TraceFilter filter = {0, 0xFFFF, 0, 0, 0, UINT64_MAX, 0};
+  uint64_t low, high;
+
+  if (argc < 2) {
+    usage(argv[0]);
+    return ERR;
+  }
+
+  for (int i = 2; i < argc; i++) {
+    int parsed = ERR;
+    if (strcmp(argv[i], "--pc") == 0 && i + 1 < argc) {
+      parsed = parse_range(argv[++i], 16, &low, &high);
+      filter.pc_low = low;
+      filter.pc_high = high > 0xFFFF ? 0xFFFF : high;
+    } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      parsed = parse_range(argv[++i], 10, &low, &high);
+      filter.cycle_low = low;
+      filter.cycle_high = high;
+    } else if (strcmp(argv[i], "--opcode") == 0 && i + 1 < argc) {
+      parsed = parse_opcode(argv[++i], &filter);
+    } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+      filter.limit = strtoull(argv[++i], NULL, 10);
+      parsed = SUCCESS;
+    }
+
+    if (parsed != SUCCESS) {
+      usage(argv[0]);
+      return ERR;
+    }
+  }
+
+  uint64_t count;
+  size_t size;
+  const uint8_t *data = trace_map(argv[1], &count, &size);
+  if (data == NULL)
+    return ERR;
+
+  // Records are in cycle order, so the first one wanted can be found
+  // without scanning the ones before it
+  const TraceRecord *records = (const TraceRecord *)(data + TRACE_HEADER_SIZE);
+  uint64_t first = 0, last = count;
+  while (first < last) {
+    uint64_t mid = first + (last - first) / 2;
+    if (records[mid].cycle < filter.cycle_low)
+      first = mid + 1;
+    else
+      last = mid;
+  }
+
+  uint64_t printed = 0;
+  char text[24];
+  for (uint64_t r = first; r < count; r++) {
+    const TraceRecord *record = &records[r];
+    if (record->cycle > filter.cycle_high)
+      break;
+    if (record->pc < filter.pc_low || record->pc > filter.pc_high ||
+        (record->opcode & filter.opcode_mask) != filter.opcode_value)
+      continue;
+
+    disassemble(record->opcode, text, sizeof(text));
+    printf("%12llu  %03X  %04X  %-16s I=%03X", (unsigned long long)record->cycle,
+           record->pc, record->opcode, text, record->i);
+    if (record->reg != TRACE_NO_REGISTER)
+      printf("  V%X=%02X%s", record->reg & 0xF, record->value,
+             (record->reg & TRACE_MORE_REGISTERS) ? " +" : "");
+    printf("\n");
+
+    if (filter.limit > 0 && ++printed >= filter.limit)
+      break;
+  }
+
+  trace_unmap(data, size);
+  return SUCCESS;
+}
\ No newline at end of file
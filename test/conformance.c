@@ -0,0 +1,326 @@
+#include "../src/chip8.h"
+#include "../src/input_script.h"
+#include "../src/text.h"
+#include "../src/thread_pool.h"
+
+// Checkpoints a case can have
+#define MAX_CHECKPOINTS 8
+// Engines every case is run on, the first one writes the golden hashes
+static const CpuMode MODES[] = {CPU_INTERPRETER, CPU_CACHED, CPU_JIT};
+static const char *const MODE_NAMES[] = {"interpreter", "cached", "jit"};
+#define MODE_COUNT (sizeof(MODES) / sizeof(MODES[0]))
+
+/*
+ * A ROM run headless from reset with scripted keypad input, and the
+ * framebuffer hash expected at the end of each checkpoint frame:
+ *
+ *   name  rom  input script (- for none)  [quirks=profile]  frame:hash ...
+ */
+typedef struct {
+  char *name;
+  char *rom;
+  char *script; // NULL -> no input
+  QuirkProfile quirks;
+  int line;     // Line of the golden file, rewritten by --update
+  int checkpoint_count;
+  uint32_t frames[MAX_CHECKPOINTS]; // Ascending
+  uint64_t expected[MAX_CHECKPOINTS];
+  uint64_t actual[MODE_COUNT][MAX_CHECKPOINTS];
+  bool ran[MODE_COUNT];
+} Case;
+
+typedef struct {
+  Case *cases;
+  size_t case_count;
+  char **lines; // The golden file as read, for --update
+  int line_count;
+  bool jit; // The JIT is only available on x86-64 hosts
+} Conformance;
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage: %s <golden file> [--update] [-j threads]\n", prog);
+}
+
+/**
+ * @brief Parses one case of the golden file.
+ *
+ * @param line The line, split in place.
+ * @param test Filled in with the case.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int parse_case(char *line, Case *test) {
+  char *cursor = line, *field, *end;
+  char *name = next_field(&cursor);
+  char *rom = next_field(&cursor);
+  char *script = next_field(&cursor);
+
+  if (name == NULL || rom == NULL || script == NULL)
+    return ERR;
+
+  test->quirks = QUIRKS_DEFAULT;
+  test->checkpoint_count = 0;
+  while ((field = next_field(&cursor)) != NULL) {
+    if (strncmp(field, "quirks=", 7) == 0) {
+      if (test->checkpoint_count > 0 ||
+          parse_quirks(field + 7, &test->quirks) != SUCCESS)
+        return ERR;
+      continue;
+    }
+
+    int c = test->checkpoint_count;
+    if (c == MAX_CHECKPOINTS)
+      return ERR;
+    test->frames[c] = strtoul(field, &end, 10);
+    if (*end != ':' || test->frames[c] == 0 ||
+        (c > 0 && test->frames[c] <= test->frames[c - 1]))
+      return ERR;
+    test->expected[c] = strtoull(end + 1, NULL, 16);
+    test->checkpoint_count++;
+  }
+  if (test->checkpoint_count == 0)
+    return ERR;
+
+  test->name = strdup(name);
+  test->rom = strdup(rom);
+  test->script = strcmp(script, "-") == 0 ? NULL : strdup(script);
+  return SUCCESS;
+}
+
+/**
+ * @brief Reads the golden file, keeping every line for --update.
+ *
+ * @param conf Filled in with the cases.
+ * @param filename The golden file.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int load_golden(Conformance *conf, const char *filename) {
+  FILE *fp = fopen(filename, "r");
+  char line[1024];
+  int capacity = 0;
+
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to open golden file: %s\n", filename);
+    return ERR;
+  }
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (conf->line_count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      char **lines = realloc(conf->lines, capacity * sizeof(char *));
+      Case *cases = realloc(conf->cases, capacity * sizeof(Case));
+      if (lines != NULL)
+        conf->lines = lines;
+      if (cases != NULL)
+        conf->cases = cases;
+      if (lines == NULL || cases == NULL) {
+        fclose(fp);
+        return ERR;
+      }
+    }
+
+    int number = conf->line_count++;
+    char scratch[sizeof(line)];
+    conf->lines[number] = strdup(line);
+    strcpy(scratch, line);
+    char *cursor = scratch;
+    if (next_field(&cursor) == NULL)
+      continue;
+
+    Case *test = &conf->cases[conf->case_count];
+    memset(test, 0, sizeof(Case));
+    test->line = number;
+    strcpy(scratch, line);
+    if (parse_case(scratch, test) != SUCCESS) {
+      fprintf(stderr, "Invalid golden line %s:%d\n", filename, number + 1);
+      fclose(fp);
+      return ERR;
+    }
+    conf->case_count++;
+  }
+
+  fclose(fp);
+  return SUCCESS;
+}
+
+/**
+ * @brief Runs one case on one engine, hashing the framebuffer at each
+ * checkpoint.
+ *
+ * @param job The case times MODE_COUNT plus the engine.
+ * @param ctx The Conformance.
+ */
+static void run_case(size_t job, void *ctx) {
+  Conformance *conf = ctx;
+  Case *test = &conf->cases[job / MODE_COUNT];
+  size_t mode = job % MODE_COUNT;
+  InputScript script = {0};
+
+  if (MODES[mode] == CPU_JIT && !conf->jit)
+    return;
+
+  Chip8 *c8 = initialize();
+  if (c8 == NULL)
+    return;
+  if (set_quirks(c8, test->quirks) != SUCCESS ||
+      set_cpu_mode(c8, MODES[mode]) != SUCCESS ||
+      load_rom(c8, test->rom) != SUCCESS ||
+      (test->script != NULL &&
+       load_input_script(&script, test->script) != SUCCESS)) {
+    destroy(c8);
+    return;
+  }
+
+  uint32_t frame = 0;
+  for (int c = 0; c < test->checkpoint_count; c++) {
+    for (; frame < test->frames[c] && c8->running; frame++) {
+      apply_input_script(&script, c8, frame);
+      run_frame(c8, CYCLES_PER_FRAME);
+    }
+    test->actual[mode][c] = framebuffer_hash(c8);
+  }
+  test->ran[mode] = true;
+
+  free_input_script(&script);
+  destroy(c8);
+}
+
+/**
+ * @brief Compares every run with the golden hashes and reports the
+ * mismatches.
+ *
+ * @param conf The finished cases.
+ * @param update Compare the engines with the interpreter instead.
+ * @return The number of failed checkpoints.
+ */
+static int check_results(const Conformance *conf, bool update) {
+  int failures = 0;
+
+  for (size_t i = 0; i < conf->case_count; i++) {
+    const Case *test = &conf->cases[i];
+    for (size_t mode = 0; mode < MODE_COUNT; mode++) {
+      if (MODES[mode] == CPU_JIT && !conf->jit)
+        continue;
+      if (!test->ran[mode]) {
+        fprintf(stderr, "FAIL %s (%s): could not run\n", test->name,
+                MODE_NAMES[mode]);
+        failures++;
+        continue;
+      }
+
+      for (int c = 0; c < test->checkpoint_count; c++) {
+        uint64_t expected = update ? test->actual[0][c] : test->expected[c];
+        if (test->actual[mode][c] == expected)
+          continue;
+        fprintf(stderr,
+                "FAIL %s (%s): frame %u framebuffer %016llx, expected "
+                "%016llx\n",
+                test->name, MODE_NAMES[mode], test->frames[c],
+                (unsigned long long)test->actual[mode][c],
+                (unsigned long long)expected);
+        failures++;
+      }
+    }
+  }
+  return failures;
+}
+
+/**
+ * @brief Rewrites the golden file with the hashes of the interpreter runs.
+ *
+ * @param conf The finished cases.
+ * @param filename The golden file.
+ * @return Status of the operation (0 -> Success, 1 -> Error).
+ */
+static int save_golden(const Conformance *conf, const char *filename) {
+  FILE *fp = fopen(filename, "w");
+  size_t next = 0;
+
+  if (fp == NULL) {
+    fprintf(stderr, "Failed to write golden file: %s\n", filename);
+    return ERR;
+  }
+
+  for (int line = 0; line < conf->line_count; line++) {
+    if (next == conf->case_count || conf->cases[next].line != line) {
+      fputs(conf->lines[line], fp);
+      continue;
+    }
+
+    const Case *test = &conf->cases[next++];
+    bool quote = strchr(test->rom, ' ') != NULL;
+    fprintf(fp, "%s %s%s%s %s", test->name, quote ? "\"" : "", test->rom,
+            quote ? "\"" : "", test->script != NULL ? test->script : "-");
+    if (test->quirks != QUIRKS_DEFAULT)
+      fprintf(fp, " quirks=%s", quirk_profiles[test->quirks].name);
+    for (int c = 0; c < test->checkpoint_count; c++)
+      fprintf(fp, " %u:%016llx", test->frames[c],
+              (unsigned long long)test->actual[0][c]);
+    fprintf(fp, "\n");
+  }
+
+  return fclose(fp) == 0 ? SUCCESS : ERR;
+}
+
+static void free_conformance(Conformance *conf) {
+  for (size_t i = 0; i < conf->case_count; i++) {
+    free(conf->cases[i].name);
+    free(conf->cases[i].rom);
+    free(conf->cases[i].script);
+  }
+  for (int line = 0; line < conf->line_count; line++)
+    free(conf->lines[line]);
+  free(conf->cases);
+  free(conf->lines);
+}
+
+int main(int argc, char **argv) {
+  Conformance conf = {0};
+  int threads = default_thread_count();
+  bool update = false;
+
+  if (argc < 2) {
+    usage(argv[0]);
+    return ERR;
+  }
+
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--update") == 0) {
+      update = true;
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else {
+      usage(argv[0]);
+      return ERR;
+    }
+  }
+
+  if (load_golden(&conf, argv[1]) != SUCCESS) {
+    free_conformance(&conf);
+    return ERR;
+  }
+
+  // Probe the JIT once rather than letting every job fail
+  Chip8 *probe = initialize();
+  conf.jit = probe != NULL && set_cpu_mode(probe, CPU_JIT) == SUCCESS;
+  destroy(probe);
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  run_jobs(conf.case_count * MODE_COUNT, threads, run_case, &conf);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  int failures = check_results(&conf, update);
+  int checkpoints = 0;
+  for (size_t i = 0; i < conf.case_count; i++)
+    checkpoints += conf.cases[i].checkpoint_count;
+
+  printf("Conformance: %zu cases, %d checkpoints, %d failed, %.3f s\n",
+         conf.case_count, checkpoints, failures,
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+  int status = failures > 0 ? ERR : SUCCESS;
+  if (update && status == SUCCESS)
+    status = save_golden(&conf, argv[1]);
+  free_conformance(&conf);
+  return status;
+}
\ No newline at end of file
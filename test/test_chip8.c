@@ -1,5 +1,17 @@
 #include "../src/chip8.h"
 #include "../src/debug.h"
+#include "../src/dispatch.h"
+#include "../src/emulator.h"
+#include "../src/headless.h"
+#include "../src/lockstep.h"
+#include "../src/logger.h"
+#include "../src/movie.h"
+#include "../src/profile.h"
+#include "../src/rewind.h"
+#include "../src/savestate.h"
+#include "../src/scheduler.h"
+#include "../src/tone.h"
+#include "../src/trace.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,10 +59,25 @@ void test_fx29(Chip8 *c8);
 void test_fx33(Chip8 *c8);
 void test_fx55(Chip8 *c8);
 void test_fx65(Chip8 *c8);
+void test_dirty_rows(Chip8 *c8);
+void test_block_cache_smc(Chip8 *c8);
+void test_cpu_modes_match(Chip8 *c8);
+void test_lockstep(Chip8 *c8);
+void test_savestate(Chip8 *c8);
+void test_rewind(Chip8 *c8);
+void test_movie(Chip8 *c8);
+void test_scheduler(Chip8 *c8);
+void test_emulation(Chip8 *c8);
+void test_tone(Chip8 *c8);
+void test_logger(Chip8 *c8);
+void test_trace(Chip8 *c8);
+void test_profile(Chip8 *c8);
+void test_hash(Chip8 *c8);
+void test_quirks(Chip8 *c8);
+void test_schip(Chip8 *c8);
+void test_xochip(Chip8 *c8);
 
 int main() {
-  srand(1);
-
   Chip8 *chip8 = initialize();
   if (chip8 == NULL) {
     return ERR;
@@ -91,10 +118,27 @@ int main() {
   test_fx33(chip8);
   test_fx55(chip8);
   test_fx65(chip8);
+  test_dirty_rows(chip8);
+  test_block_cache_smc(chip8);
+  test_cpu_modes_match(chip8);
+  test_lockstep(chip8);
+  test_savestate(chip8);
+  test_rewind(chip8);
+  test_movie(chip8);
+  test_scheduler(chip8);
+  test_emulation(chip8);
+  test_tone(chip8);
+  test_logger(chip8);
+  test_trace(chip8);
+  test_profile(chip8);
+  test_hash(chip8);
+  test_quirks(chip8);
+  test_schip(chip8);
+  test_xochip(chip8);
 
   printf("All tests passsed...");
 
-  free(chip8);
+  destroy(chip8);
   return 0;
 }
 
@@ -107,7 +151,16 @@ void test_0xxx(Chip8 *c8) {
 }
 
 void test_00e0(Chip8 *c8) {
-  // TODO: Add test to check if the screen is cleared
+  c8->buffer[0] = ~0ULL;
+  c8->buffer[SCREEN_HEIGHT - 1] = 1;
+  c8->opcode = 0x00E0;
+  execute_instruction(c8);
+
+  for (int y = 0; y < SCREEN_HEIGHT; y++) {
+    for (int x = 0; x < SCREEN_WIDTH; x++)
+      custom_assert(!get_pixel(c8, x, y), "0x00E0: Screen not cleared");
+  }
+  custom_assert(c8->pc == 0x202, "0x00E0: PC not incremented");
   reset(c8);
 }
 
@@ -405,12 +458,25 @@ void test_bnnn(Chip8 *c8) {
 }
 
 void test_cxkk(Chip8 *c8) {
-  c8->opcode = 0xC123;
+  uint8_t expected[16];
+
+  // The same seed gives the same sequence
+  seed_random(c8, 1234);
+  for (int i = 0; i < 16; i++)
+    expected[i] = next_random(c8);
+  seed_random(c8, 1234);
+
+  for (int i = 0; i < 16; i++) {
+    c8->opcode = 0xC123;
+    execute_instruction(c8);
+    custom_assert(c8->registers[1] == (expected[i] & 0x23),
+                  "0xC000: Reg 1 not correctly set");
+    custom_assert((c8->registers[1] & ~0x23) == 0,
+                  "0xC000: Random byte not masked by kk");
+  }
 
-  srand(1);
-  execute_instruction(c8);
-  srand(1);
-  custom_assert(c8->registers[1] == 0x23, "0xC000: Reg 1 not correctly set");
+  custom_assert(c8->pc == 0x200 + 2 * 16, "0xC000: PC not incremented");
+  seed_random(c8, 1);
   reset(c8);
 }
 
@@ -420,10 +486,33 @@ void test_dxyn(Chip8 *c8) {
   c8->memory[0x300] = 0b11110000;
   execute_instruction(c8);
 
-  // Todo: How to test screen buffer?
   custom_assert(c8->pc == 0x202, "0xD000: PC not incremented");
   custom_assert(c8->registers[0xF] == 0x0, "0xD000: Overflow flag set");
   custom_assert(c8->draw == true, "0xD000: Draw flag not set");
+  for (int x = 0; x < 8; x++) {
+    custom_assert(get_pixel(c8, x, 0) == (x < 4), "0xD000: Wrong pixel drawn");
+    custom_assert(!get_pixel(c8, x, 1), "0xD000: Pixel drawn on empty row");
+  }
+
+  // Drawing the same sprite again erases it and reports a collision
+  execute_instruction(c8);
+  custom_assert(c8->registers[0xF] == 0x1, "0xD000: Collision not detected");
+  custom_assert(c8->buffer[0] == 0, "0xD000: Sprite not erased");
+  reset(c8);
+
+  // Sprites wrap around both edges of the screen
+  c8->opcode = 0xD121;
+  c8->IRegister = 0x300;
+  c8->memory[0x300] = 0b11000011;
+  c8->registers[1] = SCREEN_WIDTH - 2 + SCREEN_WIDTH; // Wraps to x = 62
+  c8->registers[2] = SCREEN_HEIGHT + 3;               // Wraps to y = 3
+  execute_instruction(c8);
+  custom_assert(get_pixel(c8, 62, 3) && get_pixel(c8, 63, 3),
+                "0xD000: Sprite not drawn at the right edge");
+  custom_assert(get_pixel(c8, 4, 3) && get_pixel(c8, 5, 3),
+                "0xD000: Sprite did not wrap to the left edge");
+  custom_assert(!get_pixel(c8, 0, 3) && !get_pixel(c8, 61, 3),
+                "0xD000: Wrapped sprite drawn in the wrong place");
   reset(c8);
 }
 
@@ -458,13 +547,19 @@ void test_fx07(Chip8 *c8) {
 }
 
 void test_fx0a(Chip8 *c8) {
-  // LD Vx, Key
-  c8->opcode = 0xF00A;
-  c8->keypad[0x0] = true;
-  execute_instruction(c8);
-
-  custom_assert(c8->registers[0] == 0x0, "0xF00A: Reg 0 not correctly set");
-  custom_assert(c8->pc == 0x202, "0xF00A: PC not incremented");
+  // LD Vx, Key: a held key satisfies one FX0A, once it is released
+  const uint8_t program[] = {0xF3, 0x0A, 0xF4, 0x0A, 0x12, 0x04};
+  load_rom_data(c8, program, sizeof(program));
+  c8->keypad[0x7] = true;
+  cycle_cpu(c8, 100);
+  custom_assert(c8->pc == 0x200 && c8->awaited_key == 0x7,
+                "0xF30A: Completed while the key is held");
+
+  c8->keypad[0x7] = false;
+  cycle_cpu(c8, 100);
+  custom_assert(c8->registers[3] == 0x7, "0xF30A: Reg 3 not correctly set");
+  custom_assert(c8->pc == 0x202 && c8->registers[4] == 0,
+                "0xF40A: Released key satisfied a second FX0A");
   reset(c8);
 }
 
@@ -574,6 +669,21 @@ void test_fx55(Chip8 *c8) {
     custom_assert(c8->memory[reg] == c8->registers[reg],
                   "0xF055: Register not stored correctly");
   }
+
+  // Addresses past the end of memory wrap around to 0
+  const uint8_t saved[3] = {c8->memory[MEMORY_SIZE - 1], c8->memory[0],
+                            c8->memory[1]};
+  rehash(c8);
+  c8->IRegister = MEMORY_SIZE - 1;
+  c8->opcode = 0xF255;
+  execute_instruction(c8);
+  custom_assert(c8->memory[MEMORY_SIZE - 1] == c8->registers[0] &&
+                    c8->memory[0] == c8->registers[1] &&
+                    c8->memory[1] == c8->registers[2] &&
+                    machine_hash(c8) == machine_hash_full(c8),
+                "0xF055: Write past the end of memory not wrapped");
+  for (int i = 0; i < 3; i++)
+    write_memory(c8, MEMORY_SIZE - 1 + i, saved[i]);
 }
 
 void test_fx65(Chip8 *c8) {
@@ -588,4 +698,1143 @@ void test_fx65(Chip8 *c8) {
                   "0xF065: Register not loaded correctly");
   }
   reset(c8);
+}
+
+void test_dirty_rows(Chip8 *c8) {
+  take_dirty_rows(c8);
+  custom_assert(take_dirty_rows(c8) == 0, "Dirty rows: not cleared");
+
+  // A 2-row sprite at y = 3 dirties rows 3 and 4
+  c8->opcode = 0xD012;
+  c8->IRegister = 0x300;
+  c8->memory[0x300] = 0xFF;
+  c8->memory[0x301] = 0x81;
+  c8->registers[1] = 3;
+  execute_instruction(c8);
+  custom_assert(take_dirty_rows(c8) == 0x18, "Dirty rows: wrong rows");
+
+  // Drawn and erased within one frame: nothing to present
+  execute_instruction(c8);
+  execute_instruction(c8);
+  custom_assert(take_dirty_rows(c8) == 0, "Dirty rows: unchanged rows kept");
+
+  // Clearing only reports the rows that were lit
+  c8->opcode = 0x00E0;
+  execute_instruction(c8);
+  custom_assert(take_dirty_rows(c8) == 0x18, "Dirty rows: CLS rows wrong");
+
+  // A display replaced as a whole reports every row, even unchanged ones
+  mark_display_dirty(c8);
+  custom_assert(take_dirty_rows(c8) == 0xFFFFFFFF,
+                "Dirty rows: Rows dropped after a redraw");
+  custom_assert(take_dirty_rows(c8) == 0, "Dirty rows: Redraw not cleared");
+  reset(c8);
+}
+
+// Copy a program into memory at the start of the program space
+static void load_program(Chip8 *c8, const uint16_t *program, int length) {
+  for (int i = 0; i < length; i++) {
+    c8->memory[PROGRAM_MEM + i * 2] = program[i] >> 8;
+    c8->memory[PROGRAM_MEM + i * 2 + 1] = program[i] & 0xFF;
+  }
+  memory_written(c8, PROGRAM_MEM, length * 2);
+}
+
+// Engines checked against the interpreter
+static const CpuMode ENGINES[] = {CPU_CACHED, CPU_JIT};
+#define ENGINE_COUNT (sizeof(ENGINES) / sizeof(ENGINES[0]))
+
+void test_block_cache_smc(Chip8 *c8) {
+  // The program rewrites its first instruction (V2 = 1 -> V2 = 9) with FX55
+  const uint16_t program[] = {0x6201, 0xA200, 0x6062, 0x6109, 0xF155, 0x1200};
+
+  for (size_t e = 0; e < ENGINE_COUNT; e++) {
+    custom_assert(set_cpu_mode(c8, ENGINES[e]) == SUCCESS,
+                  "SMC: Failed to select engine");
+    load_program(c8, program, 6);
+
+    cycle_cpu(c8, 6);
+    custom_assert(c8->registers[2] == 0x1, "SMC: first pass failed");
+    custom_assert(c8->pc == 0x200, "SMC: jump not taken");
+
+    cycle_cpu(c8, 1);
+    custom_assert(c8->registers[2] == 0x9,
+                  "SMC: stale code executed after FX55 write");
+
+    set_cpu_mode(c8, CPU_INTERPRETER);
+    reset(c8);
+  }
+}
+
+// Create an instance running the given engine
+static Chip8 *create_engine(CpuMode mode) {
+  Chip8 *c8 = initialize();
+  if (c8 == NULL || set_cpu_mode(c8, mode) != SUCCESS) {
+    fprintf(stderr, "Failed to create engine %d\n", mode);
+    exit(EXIT_FAILURE);
+  }
+  return c8;
+}
+
+// Check that an engine left the same machine state as the interpreter
+static void assert_same_state(Chip8 *c8, Chip8 *actual, const char *what) {
+  if (c8->pc != actual->pc || c8->IRegister != actual->IRegister ||
+      c8->sp != actual->sp || c8->delay_timer != actual->delay_timer ||
+      c8->sound_timer != actual->sound_timer ||
+      memcmp(c8->registers, actual->registers, sizeof(c8->registers)) != 0 ||
+      memcmp(c8->stack, actual->stack, sizeof(c8->stack)) != 0 ||
+      c8->memory_size != actual->memory_size ||
+      memcmp(c8->memory, actual->memory, c8->memory_size) != 0 ||
+      memcmp(c8->buffer, actual->buffer, sizeof(c8->buffer)) != 0) {
+    fprintf(stderr, "Engine %d diverged from the interpreter: %s\n",
+            actual->mode, what);
+    custom_assert(false, "Engines: state mismatch");
+  }
+}
+
+// ROMs shipped in roms/
+static const char *ROMS[] = {"roms/4-flags.ch8",
+                             "roms/Space Invaders [David Winter].ch8",
+                             "roms/cavern.ch8",
+                             "roms/chip8-test-rom-with-audio.ch8",
+                             "roms/chip8-test-suite.ch8",
+                             "roms/chipquarium.ch8",
+                             "roms/delay_timer_test.ch8",
+                             "roms/heart_monitor.ch8",
+                             "roms/random_number_test.ch8",
+                             "roms/test_opcode.ch8"};
+#define ROM_COUNT (sizeof(ROMS) / sizeof(ROMS[0]))
+
+// Fill code with random instructions for a quirk profile, to cover VF
+// corner cases (x or y = F)
+static void random_program(uint16_t code[256], QuirkProfile profile) {
+  const OpHandler *handlers = op_handlers[profile];
+
+  for (int i = 0; i < 256; i++) {
+    Op op;
+    do {
+      code[i] = rand() & 0xFFFF;
+      op = decode_opcode(code[i]);
+      // Leave out ops that block, leave the program, touch the stack (the
+      // ROMs cover those) or walk I past the end of memory, and SUPER-CHIP
+      // and XO-CHIP ops the profile runs as SYS jumps or unknown opcodes
+    } while (op == OP_UNKNOWN || op == OP_SYS_ADDR || op == OP_JP_V0_ADDR ||
+             op == OP_CALL_ADDR || op == OP_RET || op == OP_LD_VX_K ||
+             op == OP_ADD_I_VX || op == OP_LD_B_VX || op == OP_LD_I_VX ||
+             op == OP_LD_VX_I || op == OP_EXIT ||
+             handlers[op] == handlers[OP_SYS_ADDR] ||
+             handlers[op] == handlers[OP_UNKNOWN]);
+
+    // Keep jumps inside the program
+    if (op == OP_JP_ADDR)
+      code[i] = (code[i] & 0xF000) | (PROGRAM_MEM + (code[i] & 0x1FE));
+  }
+  code[254] = code[255] = 0x1200;
+}
+
+void test_cpu_modes_match(Chip8 *c8) {
+  // Every bundled ROM, compared after every frame
+  for (size_t r = 0; r < ROM_COUNT; r++) {
+    for (size_t e = 0; e < ENGINE_COUNT; e++) {
+      Chip8 *expected = create_engine(CPU_INTERPRETER);
+      Chip8 *actual = create_engine(ENGINES[e]);
+      load_rom(expected, ROMS[r]);
+      load_rom(actual, ROMS[r]);
+
+      for (int frame = 0; frame < 600; frame++) {
+        run_frame(expected, CYCLES_PER_FRAME);
+        run_frame(actual, CYCLES_PER_FRAME);
+        assert_same_state(expected, actual, ROMS[r]);
+      }
+
+      destroy(expected);
+      destroy(actual);
+    }
+  }
+
+  // Random programs, to cover VF corner cases (x or y = F) and odd budgets,
+  // under every quirk profile
+  srand(42);
+  for (int program = 0; program < 200; program++) {
+    uint16_t code[256];
+    random_program(code, program % QUIRKS_COUNT);
+
+    for (size_t e = 0; e < ENGINE_COUNT; e++) {
+      Chip8 *expected = create_engine(CPU_INTERPRETER);
+      Chip8 *actual = create_engine(ENGINES[e]);
+      set_quirks(expected, program % QUIRKS_COUNT);
+      set_quirks(actual, program % QUIRKS_COUNT);
+      load_program(expected, code, 256);
+      load_program(actual, code, 256);
+      expected->keypad[program & 0xF] = actual->keypad[program & 0xF] = true;
+
+      for (int budget = 1; budget < 40; budget++) {
+        int executed = cycle_cpu(expected, budget);
+        custom_assert(cycle_cpu(actual, budget) == executed,
+                      "CPU modes: Executed instruction counts differ");
+        assert_same_state(expected, actual, "random program");
+      }
+
+      destroy(expected);
+      destroy(actual);
+    }
+  }
+  reset(c8);
+}
+
+// Run lanes that differ in seed and held keys, each checked by the lockstep
+// verification against its own scalar run
+static void run_lockstep(Chip8 *c8, const uint8_t *image, size_t size,
+                         int frames, QuirkProfile quirks) {
+  Lockstep *ls = lockstep_create(LOCKSTEP_LANES, true);
+  custom_assert(ls != NULL, "Lockstep: Failed to create lanes");
+  lockstep_set_quirks(ls, quirks);
+  custom_assert(lockstep_load_rom(ls, image, size) == SUCCESS,
+                "Lockstep: Failed to load ROM");
+
+  for (int l = 0; l < LOCKSTEP_LANES; l++)
+    lockstep_seed(ls, l, l);
+
+  for (int frame = 0; frame < frames; frame++) {
+    for (int l = 0; l < LOCKSTEP_LANES; l++)
+      set_keypad_mask(lockstep_lane(ls, l),
+                      frame % 40 < 20 ? 1u << (l % 16) : 0);
+    custom_assert(lockstep_run_frame(ls, CYCLES_PER_FRAME) == SUCCESS,
+                  "Lockstep: lane diverged from its scalar run");
+  }
+
+  if (lockstep_simd_supported())
+    custom_assert(ls->simd_ops > 0, "Lockstep: SIMD path never taken");
+  lockstep_destroy(ls);
+}
+
+void test_lockstep(Chip8 *c8) {
+  for (size_t r = 0; r < ROM_COUNT; r++) {
+    size_t size;
+    uint8_t *image = read_rom(ROMS[r], &size);
+    custom_assert(image != NULL, "Lockstep: Failed to read ROM");
+    run_lockstep(c8, image, size, 120, QUIRKS_DEFAULT);
+    free(image);
+  }
+
+  // Every lane patches its first instruction (V1 = 0) with its own random
+  // byte, so lanes at the same PC execute different opcodes
+  const uint8_t smc[] = {0x61, 0x00, 0xC0, 0xFF, 0xA2,
+                         0x01, 0xF0, 0x55, 0x12, 0x00};
+  run_lockstep(c8, smc, sizeof(smc), 10, QUIRKS_DEFAULT);
+
+  srand(7);
+  for (int program = 0; program < 50; program++) {
+    uint16_t code[256];
+    uint8_t image[512];
+    random_program(code, program % QUIRKS_COUNT);
+    for (int i = 0; i < 256; i++) {
+      image[i * 2] = code[i] >> 8;
+      image[i * 2 + 1] = code[i] & 0xFF;
+    }
+    run_lockstep(c8, image, sizeof(image), 10, program % QUIRKS_COUNT);
+  }
+
+  // Lanes that draw a 1 execute 00FD after 5 instructions, the others spin,
+  // and a stopped lane neither counts instructions nor ticks its timers
+  const uint8_t stop[] = {0x61, 0x05, 0xF1, 0x15, 0xC0, 0x01,
+                          0x30, 0x00, 0x00, 0xFD, 0x12, 0x0A};
+  Lockstep *ls = lockstep_create(LOCKSTEP_LANES, true);
+  custom_assert(ls != NULL, "Lockstep: Failed to create lanes");
+  lockstep_set_quirks(ls, QUIRKS_SCHIP);
+  lockstep_load_rom(ls, stop, sizeof(stop));
+  for (int l = 0; l < LOCKSTEP_LANES; l++)
+    lockstep_seed(ls, l, l);
+  for (int frame = 0; frame < 2; frame++)
+    custom_assert(lockstep_run_frame(ls, CYCLES_PER_FRAME) == SUCCESS,
+                  "Lockstep: lane diverged after 00FD");
+
+  int stopped = 0;
+  for (int l = 0; l < LOCKSTEP_LANES; l++) {
+    const Chip8 *lane = lockstep_lane(ls, l);
+    bool ran = lane->running;
+    stopped += !ran;
+    custom_assert(ls->cycles[l] == (ran ? 2 * CYCLES_PER_FRAME : 5),
+                  "Lockstep: Wrong instruction count after 00FD");
+    custom_assert(lane->delay_timer == (ran ? 3 : 4),
+                  "Lockstep: Stopped lane timers ticked");
+  }
+  custom_assert(stopped > 0 && stopped < LOCKSTEP_LANES,
+                "Lockstep: Seeds did not split the lanes");
+  lockstep_destroy(ls);
+  reset(c8);
+}
+
+void test_savestate(Chip8 *c8) {
+  static uint8_t state[SAVESTATE_SIZE];
+  Chip8 *original = create_engine(CPU_INTERPRETER);
+  load_rom(original, ROMS[1]);
+  original->keypad[5] = true;
+  for (int frame = 0; frame < 100; frame++)
+    run_frame(original, CYCLES_PER_FRAME);
+
+  save_state(original, state);
+  custom_assert(memcmp(state, SAVESTATE_MAGIC, 4) == 0,
+                "Save state: Wrong magic");
+  custom_assert(state[4] == SAVESTATE_VERSION && state[5] == 0,
+                "Save state: Version not little-endian");
+
+  // Restore into an engine that already translated code of another ROM
+  Chip8 *restored = create_engine(CPU_JIT);
+  load_rom(restored, ROMS[2]);
+  run_frame(restored, CYCLES_PER_FRAME);
+  custom_assert(load_state(restored, state, sizeof(state)) == SUCCESS,
+                "Save state: Failed to load");
+  custom_assert(state_hash(restored) == state_hash(original),
+                "Save state: Restored state differs");
+  custom_assert(restored->keypad[5], "Save state: Keypad not restored");
+
+  for (int frame = 0; frame < 100; frame++) {
+    run_frame(original, CYCLES_PER_FRAME);
+    run_frame(restored, CYCLES_PER_FRAME);
+  }
+  assert_same_state(original, restored, "save state");
+
+  // Damaged states are rejected without touching the instance
+  uint64_t before = state_hash(restored);
+  state[100] ^= 1;
+  custom_assert(load_state(restored, state, sizeof(state)) == ERR,
+                "Save state: Corrupted state loaded");
+  state[100] ^= 1;
+  state[4] = SAVESTATE_VERSION + 1;
+  custom_assert(load_state(restored, state, sizeof(state)) == ERR,
+                "Save state: Unknown version loaded");
+  state[4] = SAVESTATE_VERSION;
+  custom_assert(load_state(restored, state, sizeof(state) - 1) == ERR,
+                "Save state: Truncated state loaded");
+  custom_assert(state_hash(restored) == before,
+                "Save state: Failed load changed the instance");
+
+  // A state only loads under the quirk profile it was saved with, except a
+  // version 2 state, which records neither the profile nor the key FX0A
+  // waits on
+  static uint8_t v2[SAVESTATE_SIZE - 1];
+  uint32_t v2_payload = SAVESTATE_V2_PAYLOAD_SIZE;
+  memcpy(v2, state, sizeof(v2) - 8);
+  v2[4] = 2;
+  v2[7] = 0;
+  for (int i = 0; i < 4; i++)
+    v2[8 + i] = v2_payload >> (i * 8);
+  uint64_t v2_hash = fnv1a(FNV_OFFSET, &v2[SAVESTATE_HEADER_SIZE], v2_payload);
+  for (int i = 0; i < 8; i++)
+    v2[sizeof(v2) - 8 + i] = v2_hash >> (i * 8);
+
+  custom_assert(state[7] == QUIRKS_DEFAULT, "Save state: Profile not saved");
+  set_quirks(restored, QUIRKS_VIP);
+  custom_assert(load_state(restored, state, sizeof(state)) == ERR,
+                "Save state: Loaded under another profile");
+  custom_assert(load_state(restored, v2, sizeof(v2)) == SUCCESS &&
+                    restored->awaited_key == -1,
+                "Save state: Version 2 state not loaded");
+  state[7] = QUIRKS_XOCHIP;
+  custom_assert(load_state(restored, state, sizeof(state)) == ERR,
+                "Save state: Profile disagrees with the XO-CHIP flag");
+
+  // A key held through FX0A is still awaited after a restore
+  set_quirks(restored, QUIRKS_DEFAULT);
+  original->awaited_key = 0x7;
+  save_state(original, state);
+  custom_assert(load_state(restored, state, sizeof(state)) == SUCCESS &&
+                    restored->awaited_key == 0x7,
+                "Save state: Key awaited by FX0A not restored");
+
+  destroy(original);
+  destroy(restored);
+  reset(c8);
+}
+
+void test_rewind(Chip8 *c8) {
+  const int FRAMES = 500;
+  uint64_t hashes[FRAMES];
+  RewindStats stats;
+
+  custom_assert(rewind_create(0) == NULL, "Rewind: Empty history created");
+
+  // Keep 3 seconds, so the ring wraps around several times
+  RewindBuffer *history = rewind_create(3);
+  Chip8 *game = initialize();
+  load_rom(game, ROMS[1]);
+  custom_assert(rewind_step(history, game) == ERR,
+                "Rewind: Stepped back without history");
+
+  for (int frame = 0; frame < FRAMES; frame++) {
+    game->keypad[5] = frame % 50 < 25;
+    run_frame(game, CYCLES_PER_FRAME);
+    hashes[frame] = state_hash(game);
+    custom_assert(rewind_capture(history, game) == SUCCESS,
+                  "Rewind: Failed to capture");
+  }
+
+  rewind_get_stats(history, &stats);
+  custom_assert(stats.frames >= 3 * 60 && stats.frames < (uint64_t)FRAMES,
+                "Rewind: Wrong number of frames kept");
+
+  // Every kept frame comes back, newest first, then the history runs out
+  for (uint64_t step = 1; step < stats.frames; step++) {
+    custom_assert(rewind_step(history, game) == SUCCESS,
+                  "Rewind: Failed to step back");
+    custom_assert(state_hash(game) == hashes[FRAMES - 1 - step],
+                  "Rewind: Restored the wrong frame");
+  }
+  custom_assert(rewind_step(history, game) == ERR,
+                "Rewind: Stepped back past the oldest frame");
+
+  // Captures after rewinding continue from the restored frame
+  run_frame(game, CYCLES_PER_FRAME);
+  uint64_t resumed = state_hash(game);
+  rewind_capture(history, game);
+  run_frame(game, CYCLES_PER_FRAME);
+  rewind_capture(history, game);
+  rewind_step(history, game);
+  custom_assert(state_hash(game) == resumed,
+                "Rewind: Lost a frame captured after rewinding");
+
+  rewind_destroy(history);
+  destroy(game);
+  reset(c8);
+}
+
+void test_movie(Chip8 *c8) {
+  const char *FILENAME = "build/test_movie.c8m";
+  const uint32_t SEED = 1234;
+  RunStats stats;
+
+  // A live session: random keys, with RND drawing from the seeded generator
+  Chip8 *live = initialize();
+  seed_random(live, SEED);
+  load_rom(live, ROMS[1]);
+  Movie *movie = movie_create(live, SEED, DEFAULT_IPS);
+  uint32_t keys = 0x2545F491;
+  for (int frame = 0; frame < 3000; frame++) {
+    if (frame % 20 == 0)
+      keys = keys * 1103515245 + 12345;
+    movie_record(movie, keys >> 16);
+    set_keypad_mask(live, keys >> 16);
+    run_frame(live, CYCLES_PER_FRAME);
+  }
+  custom_assert(movie_save(movie, live, FILENAME) == SUCCESS,
+                "Movie: Failed to save");
+  movie_destroy(movie);
+
+  movie = movie_load(FILENAME);
+  custom_assert(movie != NULL && movie->frame_count == 3000 &&
+                    movie->seed == SEED,
+                "Movie: Failed to load");
+
+  Chip8 *replay = create_engine(CPU_JIT);
+  seed_random(replay, movie->seed);
+  load_rom(replay, ROMS[1]);
+  custom_assert(replay_movie(replay, movie, &stats) == SUCCESS,
+                "Movie: Replay diverged");
+  assert_same_state(live, replay, "movie replay");
+
+  // A replay from another ROM is refused
+  Chip8 *other = initialize();
+  seed_random(other, movie->seed);
+  load_rom(other, ROMS[2]);
+  custom_assert(replay_movie(other, movie, &stats) == ERR,
+                "Movie: Replayed on the wrong ROM");
+
+  // A frame count larger than the file is refused before anything is read
+  FILE *fp = fopen(FILENAME, "r+b");
+  const uint8_t huge[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+  custom_assert(fp != NULL && fseek(fp, 12, SEEK_SET) == 0 &&
+                    fwrite(huge, 1, sizeof(huge), fp) == sizeof(huge),
+                "Movie: Failed to corrupt the frame count");
+  fclose(fp);
+  custom_assert(movie_load(FILENAME) == NULL,
+                "Movie: Loaded with a frame count past the end of the file");
+
+  movie_destroy(movie);
+  remove(FILENAME);
+  destroy(live);
+  destroy(replay);
+  destroy(other);
+  reset(c8);
+}
+
+static void count_frame(Chip8 *c8, void *ctx) {
+  (void)c8;
+  (*(int *)ctx)++;
+}
+
+void test_scheduler(Chip8 *c8) {
+  Scheduler s;
+  int frames = 0;
+  FrameHooks hooks = {NULL, count_frame, &frames};
+
+  // Ticks split the rate evenly, whatever it is
+  uint64_t total = 0;
+  for (int frame = 0; frame < TIMER_HZ; frame++)
+    total += frame_cycles(700, frame);
+  custom_assert(total == 700, "Scheduler: Frames do not add up to the rate");
+
+  // 10 s at 144 Hz, under one instruction per host frame at 100 IPS
+  Chip8 *game = initialize();
+  load_rom(game, ROMS[1]);
+  game->delay_timer = 255;
+  scheduler_init(&s, 100, 0);
+  for (int host = 1; host <= 1440; host++)
+    scheduler_run(&s, game, host / 144.0, &hooks);
+  custom_assert(s.frame == 600 && frames == 600,
+                "Scheduler: Timers not ticked at 60 Hz");
+  custom_assert(game->delay_timer == 0,
+                "Scheduler: Timers not ticked");
+
+  // The sound timer runs out at the clock reading of its last tick
+  game->sound_timer = 3;
+  double until = scheduler_tick_time(&s, game->sound_timer);
+  custom_assert(until > 10.0499 && until < 10.0501,
+                "Scheduler: Wrong time of a coming tick");
+  scheduler_run(&s, game, until - 0.001, &hooks);
+  custom_assert(game->sound_timer == 1, "Scheduler: Sound timer ran out early");
+  scheduler_run(&s, game, until + 1e-9, &hooks);
+  custom_assert(game->sound_timer == 0, "Scheduler: Sound timer ran out late");
+
+  // A stall is caught up only partly
+  scheduler_run(&s, game, 20.0, &hooks);
+  custom_assert(s.frame == 609 && s.dropped > 9.8,
+                "Scheduler: Caught up on a stall");
+
+  // Turbo runs a multiple of the frames, and unbounded turbo does not make
+  // the normal speed catch up on the time it took
+  scheduler_init(&s, 600, 0);
+  scheduler_set_speed(&s, 4, 0);
+  for (int host = 1; host <= 60; host++)
+    scheduler_run(&s, game, host / 60.0, NULL);
+  custom_assert(s.frame == 240, "Scheduler: Turbo ran the wrong frames");
+  scheduler_set_speed(&s, 1, 1.0);
+  scheduler_run(&s, game, 1.0625, NULL);
+  custom_assert(s.frame == 243, "Scheduler: Speed change lost time");
+  uint64_t before = s.frame;
+  custom_assert(scheduler_run_unbounded(&s, game, 0.001, NULL) > 0,
+                "Scheduler: Unbounded turbo ran nothing");
+  custom_assert(scheduler_run(&s, game, s.last, NULL) == 0 && s.frame > before,
+                "Scheduler: Caught up after unbounded turbo");
+
+  // Uneven host frames run the same emulated frames as a headless run
+  Chip8 *windowed = initialize();
+  Chip8 *headless = initialize();
+  load_rom(windowed, ROMS[1]);
+  load_rom(headless, ROMS[1]);
+  scheduler_init(&s, 1000, 0);
+  double now = 0;
+  while (s.frame < 300) {
+    now += (s.frame % 3 + 1) / 97.0;
+    scheduler_run(&s, windowed, now, NULL);
+  }
+  scheduler_finish_frame(&s, windowed, NULL);
+  RunStats stats;
+  run_headless(headless, 1000, 0, s.frame, NULL, &stats);
+  assert_same_state(windowed, headless, "scheduler");
+
+  destroy(game);
+  destroy(windowed);
+  destroy(headless);
+  reset(c8);
+}
+
+static void *publish_frames(void *arg) {
+  FrameExchange *exchange = arg;
+  for (uint64_t number = 1; number <= 200000; number++) {
+    Frame *frame = frame_exchange_back(exchange);
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+      frame->rows[y] = number;
+    frame->number = number;
+    frame_exchange_publish(exchange);
+  }
+  return NULL;
+}
+
+void test_emulation(Chip8 *c8) {
+  // Frames are never torn or handed over out of order
+  static FrameExchange exchange;
+  pthread_t writer;
+  uint64_t last = 0;
+  frame_exchange_init(&exchange);
+  pthread_create(&writer, NULL, publish_frames, &exchange);
+  while (last < 200000) {
+    const Frame *frame = frame_exchange_acquire(&exchange);
+    if (frame == NULL)
+      continue;
+    custom_assert(frame->number > last, "Emulation: Frame handed over twice");
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+      custom_assert(frame->rows[y] == frame->number,
+                    "Emulation: Frame torn");
+    last = frame->number;
+  }
+  pthread_join(writer, NULL);
+
+  // The thread keeps time on its own and takes keys from the host
+  Chip8 *game = initialize();
+  load_rom(game, ROMS[1]);
+  static Emulation emu;
+  emu.c8 = game;
+  emu.ips = DEFAULT_IPS;
+  emulation_start(&emu, false);
+  atomic_store(&emu.controls.keys, 1u << 5);
+  double start = scheduler_clock();
+  uint64_t shown = 0, dirty = 0;
+  // Updated from the dirty rows of each frame only, like the screen texture
+  uint64_t texture[SCREEN_HEIGHT] = {0};
+  const Frame *frame = NULL;
+  bool stopped = false;
+  while (!stopped || frame != NULL) {
+    if (!stopped && scheduler_clock() - start >= 0.2) {
+      // Frames published until then are still checked
+      emulation_stop(&emu);
+      stopped = true;
+    }
+    frame = frame_exchange_acquire(&emu.frames);
+    if (frame == NULL)
+      continue;
+    shown = frame->number;
+    dirty |= frame->dirty;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+      if (frame->dirty & (1ull << y))
+        texture[y] = frame->rows[y];
+    }
+    custom_assert(memcmp(texture, frame->rows, sizeof(texture)) == 0,
+                  "Emulation: Changed rows not marked dirty");
+  }
+  custom_assert(emu.scheduler.frame >= 3 && emu.scheduler.frame <= 18,
+                "Emulation: Not run at 60 Hz");
+  custom_assert(shown > 0 && dirty != 0, "Emulation: No frame handed over");
+  custom_assert(game->keypad[5], "Emulation: Keys not picked up");
+
+  destroy(game);
+  reset(c8);
+}
+
+void test_tone(Chip8 *c8) {
+  Tone tone = {0};
+  int16_t out[1024];
+
+  tone_render(&tone, out, 256, 0);
+  for (int i = 0; i < 256; i++)
+    custom_assert(out[i] == 0, "Tone: Sound while off");
+
+  // Fades in from the first sample, then plays at full volume
+  tone_render(&tone, out, 1024, 1024);
+  custom_assert(out[0] != 0, "Tone: Gate picked up late");
+  for (int i = 0; i < 1024; i++) {
+    int gain = i < TONE_RAMP_SAMPLES ? i + 1 : TONE_RAMP_SAMPLES;
+    int limit = TONE_AMPLITUDE * gain / TONE_RAMP_SAMPLES;
+    custom_assert(abs(out[i]) <= limit, "Tone: No fade in");
+    if (i >= TONE_RAMP_SAMPLES)
+      custom_assert(abs(out[i]) == TONE_AMPLITUDE, "Tone: Wrong volume");
+  }
+
+  // Fades out from the sample the gate closes on, then stays silent
+  tone_render(&tone, out, 1024, 100);
+  for (int i = 0; i < 100; i++)
+    custom_assert(abs(out[i]) == TONE_AMPLITUDE, "Tone: Gate closed early");
+  custom_assert(out[100] != 0, "Tone: Cut off without a fade");
+  for (int i = 100; i < 100 + TONE_RAMP_SAMPLES; i++)
+    custom_assert(abs(out[i]) < TONE_AMPLITUDE, "Tone: Gate closed late");
+  for (int i = 100 + TONE_RAMP_SAMPLES - 1; i < 1024; i++)
+    custom_assert(out[i] == 0, "Tone: Fade out too long");
+
+  reset(c8);
+}
+
+static void *log_messages(void *arg) {
+  int thread = *(int *)arg;
+  for (int i = 0; i < 4; i++)
+    log_debug("Logger test: thread %d, message %d", thread, i);
+  return NULL;
+}
+
+static int counted;
+static int count(void) { return ++counted; }
+
+void test_logger(Chip8 *c8) {
+  // Messages below the threshold are skipped before their arguments
+  log_set_level(LOG_LEVEL_NONE);
+  log_error("Logger test: %d", count());
+  custom_assert(counted == 0, "Logger: Arguments of a hidden message run");
+
+  // Threads log at the same time without losing messages
+  pthread_t threads[4];
+  int ids[4];
+  log_set_level(LOG_LEVEL_DEBUG);
+  for (int i = 0; i < 4; i++) {
+    ids[i] = i;
+    pthread_create(&threads[i], NULL, log_messages, &ids[i]);
+  }
+  for (int i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+  log_flush();
+  custom_assert(log_dropped() == 0, "Logger: Messages dropped");
+
+  log_set_level(LOG_LEVEL_ERROR);
+  reset(c8);
+}
+
+void test_trace(Chip8 *c8) {
+  const char *FILENAME = "build/test_trace.c8t";
+  // LD V0, 05; LD V1, 03; ADD V0, V1; LD I, 300; LD V1, [I]
+  const uint8_t rom[] = {0x60, 0x05, 0x61, 0x03, 0x80,
+                         0x14, 0xA3, 0x00, 0xF1, 0x65};
+
+  load_rom_data(c8, rom, sizeof(rom));
+  c8->memory[0x300] = 0x11;
+  c8->memory[0x301] = 0x04;
+  custom_assert(trace_start(c8, FILENAME) == SUCCESS, "Trace: Not started");
+  cycle_cpu(c8, 5);
+  trace_stop(c8);
+  custom_assert(c8->trace == NULL, "Trace: Not stopped");
+  custom_assert(c8->registers[0] == 0x11, "Trace: Program not executed");
+
+  uint64_t count;
+  size_t size;
+  const uint8_t *data = trace_map(FILENAME, &count, &size);
+  custom_assert(data != NULL && count == 5, "Trace: Records missing");
+  const TraceRecord *records = (const TraceRecord *)(data + TRACE_HEADER_SIZE);
+
+  custom_assert(records[0].cycle == 0 && records[0].pc == 0x200 &&
+                    records[0].opcode == 0x6005,
+                "Trace: Wrong instruction recorded");
+  custom_assert(records[0].reg == 0 && records[0].value == 0x05,
+                "Trace: Wrong register recorded");
+  custom_assert(records[2].reg == 0 && records[2].value == 0x08,
+                "Trace: Wrong result recorded");
+  custom_assert(records[3].reg == TRACE_NO_REGISTER &&
+                    records[3].i == 0x300,
+                "Trace: Wrong I recorded");
+  // V0 and V1 both change, V0 is recorded
+  custom_assert(records[4].cycle == 4 &&
+                    records[4].reg == (0 | TRACE_MORE_REGISTERS) &&
+                    records[4].value == 0x11,
+                "Trace: Several changed registers not flagged");
+
+  trace_unmap(data, size);
+  remove(FILENAME);
+  reset(c8);
+}
+
+void test_profile(Chip8 *c8) {
+  // LD V0, 00; loop: ADD V0, 01; JP loop
+  const uint8_t rom[] = {0x60, 0x00, 0x70, 0x01, 0x12, 0x02};
+  Profile *profile = profile_create();
+  custom_assert(profile != NULL, "Profile: Not allocated");
+
+  load_rom_data(c8, rom, sizeof(rom));
+  Profile *built_in = c8->profile;
+  c8->profile = profile;
+  profile_run(c8, 7);
+  c8->profile = built_in;
+
+  custom_assert(c8->registers[0] == 3, "Profile: Program not executed");
+  custom_assert(profile->op_count[OP_LD_VX_BYTE] == 1 &&
+                    profile->op_count[OP_ADD_VX_BYTE] == 3 &&
+                    profile->op_count[OP_JP_ADDR] == 3,
+                "Profile: Wrong handler counts");
+  custom_assert(profile->pc_count[0x200] == 1 &&
+                    profile->pc_count[0x202] == 3 &&
+                    profile->pc_count[0x204] == 3,
+                "Profile: Wrong address counts");
+  custom_assert(profile->loop_count[0x204] == 3 &&
+                    profile->loop_target[0x204] == 0x202,
+                "Profile: Loop not found");
+
+  profile_destroy(profile);
+  reset(c8);
+}
+
+void test_hash(Chip8 *c8) {
+  uint8_t state[SAVESTATE_SIZE];
+  const uint64_t initial = machine_hash(c8);
+  custom_assert(initial == machine_hash_full(c8) &&
+                    display_hash(c8) == display_hash_full(c8),
+                "Hash: Wrong after reset");
+
+  // DRW V0, V1, 5 with the font sprite of 0, clipped at the right edge
+  c8->registers[0] = 62;
+  c8->registers[1] = 3;
+  c8->IRegister = 0;
+  c8->opcode = 0xD015;
+  execute_instruction(c8);
+  custom_assert(display_hash(c8) != 0 &&
+                    display_hash(c8) == display_hash_full(c8),
+                "Hash: Wrong after DRW");
+
+  // FX33 and FX55 write to memory
+  c8->registers[2] = 254;
+  c8->IRegister = 0x300;
+  c8->opcode = 0xF233;
+  execute_instruction(c8);
+  c8->opcode = 0xF255;
+  execute_instruction(c8);
+  custom_assert(machine_hash(c8) == machine_hash_full(c8),
+                "Hash: Wrong after FX33/FX55");
+  const uint64_t written = machine_hash(c8);
+  write_memory(c8, 0x400, 1);
+  custom_assert(machine_hash(c8) != written &&
+                    machine_hash(c8) == machine_hash_full(c8),
+                "Hash: Memory write not hashed");
+  write_memory(c8, 0x400, 0);
+  custom_assert(machine_hash(c8) == written,
+                "Hash: Undone write not undone in the hash");
+
+  // Restoring a state restores its hashes
+  save_state(c8, state);
+  c8->opcode = 0x00E0;
+  execute_instruction(c8);
+  custom_assert(display_hash(c8) == 0 &&
+                    display_hash(c8) == display_hash_full(c8),
+                "Hash: Wrong after CLS");
+  custom_assert(load_state(c8, state, sizeof(state)) == SUCCESS &&
+                    machine_hash(c8) == written &&
+                    display_hash(c8) == display_hash_full(c8),
+                "Hash: Wrong after load_state");
+
+  reset(c8);
+  custom_assert(machine_hash(c8) == machine_hash_full(c8) &&
+                    display_hash(c8) == display_hash_full(c8),
+                "Hash: Wrong after reset");
+}
+
+void test_quirks(Chip8 *c8) {
+  // Expected results per profile: default, vip, chip48, schip, xochip
+  const uint8_t and_vf[] = {5, 0, 5, 5, 5};
+  const uint8_t shr_v0[] = {0x02, 0x40, 0x02, 0x02, 0x40};
+  const uint16_t fx55_i[] = {0x303, 0x303, 0x302, 0x300, 0x303};
+  const uint16_t bnnn_pc[] = {0x222, 0x222, 0x228, 0x228, 0x222};
+  const bool wraps[] = {true, false, false, false, true};
+  custom_assert(QUIRKS_COUNT == 5, "Quirks: Expectations out of date");
+
+  for (int q = 0; q < QUIRKS_COUNT; q++) {
+    QuirkProfile profile;
+    custom_assert(parse_quirks(quirk_profiles[q].name, &profile) == SUCCESS &&
+                      (int)profile == q,
+                  "Quirks: Profile name not found");
+    set_quirks(c8, q);
+
+    // AND V0, V1 with VF = 5
+    c8->registers[0xF] = 5;
+    c8->opcode = 0x8012;
+    execute_instruction(c8);
+    custom_assert(c8->registers[0xF] == and_vf[q], "Quirks: AND VF reset");
+
+    // SHR V0, V1 with V0 = 0x04, V1 = 0x81
+    c8->registers[0] = 0x04;
+    c8->registers[1] = 0x81;
+    c8->opcode = 0x8016;
+    execute_instruction(c8);
+    custom_assert(c8->registers[0] == shr_v0[q] &&
+                      c8->registers[0xF] == quirk_profiles[q].shift_vy,
+                  "Quirks: SHR source");
+
+    // LD [I], V2 at I = 0x300
+    c8->IRegister = 0x300;
+    c8->opcode = 0xF255;
+    execute_instruction(c8);
+    custom_assert(c8->IRegister == fx55_i[q], "Quirks: FX55 index");
+
+    // JP V0, 0x220 with V0 = 2 and V2 = 8
+    c8->registers[0] = 2;
+    c8->registers[2] = 8;
+    c8->opcode = 0xB220;
+    execute_instruction(c8);
+    custom_assert(c8->pc == bnnn_pc[q], "Quirks: BNNN register");
+
+    // DRW V0, V1, 5 of a 4 pixel wide sprite at (62, 30)
+    memset(&c8->memory[0x310], 0xF0, 5);
+    c8->registers[0] = 62;
+    c8->registers[1] = 30;
+    c8->IRegister = 0x310;
+    c8->opcode = 0xD015;
+    execute_instruction(c8);
+    custom_assert(c8->buffer[30] == (wraps[q] ? 0xC000000000000003ULL
+                                              : 0x0000000000000003ULL),
+                  "Quirks: DRW at the right edge");
+    custom_assert((c8->buffer[0] != 0) == wraps[q],
+                  "Quirks: DRW at the bottom edge");
+
+    reset(c8);
+  }
+  set_quirks(c8, QUIRKS_DEFAULT);
+}
+
+void test_schip(Chip8 *c8) {
+  // Other profiles still run 00FF as a SYS jump
+  c8->opcode = 0x00FF;
+  execute_instruction(c8);
+  custom_assert(c8->pc == 0x0FF && !c8->hires, "SCHIP: 00FF is not SYS");
+  reset(c8);
+
+  // Earlier tests poke memory directly
+  rehash(c8);
+  set_quirks(c8, QUIRKS_SCHIP);
+  custom_assert(memcmp(&c8->memory[LARGE_FONT_MEM], large_sprite_data,
+                       LARGE_FONTSIZE) == 0,
+                "SCHIP: Large font not loaded");
+
+  c8->opcode = 0x00FF;
+  execute_instruction(c8);
+  custom_assert(c8->hires && c8->pc == 0x202, "SCHIP: HIGH");
+
+  // DRW V0, V1, 0 of a 16x16 sprite at (60, 62), clipped at the bottom
+  for (int i = 0; i < 32; i++)
+    write_memory(c8, 0x310 + i, 0xFF);
+  c8->registers[0] = 60;
+  c8->registers[1] = 62;
+  c8->IRegister = 0x310;
+  c8->opcode = 0xD010;
+  execute_instruction(c8);
+  custom_assert(c8->buffer[124] == 0xF &&
+                    c8->buffer[125] == 0xFFF0000000000000ULL &&
+                    c8->buffer[126] == 0xF && c8->buffer[0] == 0 &&
+                    c8->registers[0xF] == 0,
+                "SCHIP: 16x16 DRW");
+  custom_assert(get_pixel(c8, 75, 63) && !get_pixel(c8, 76, 63) &&
+                    !get_pixel(c8, 59, 62),
+                "SCHIP: 16x16 DRW pixels");
+
+  // Scroll right and left 4 pixels, across the middle of the rows
+  c8->opcode = 0x00FB;
+  execute_instruction(c8);
+  custom_assert(c8->buffer[124] == 0 &&
+                    c8->buffer[125] == 0xFFFF000000000000ULL,
+                "SCHIP: Scroll right");
+  c8->opcode = 0x00FC;
+  execute_instruction(c8);
+  custom_assert(c8->buffer[124] == 0xF &&
+                    c8->buffer[125] == 0xFFF0000000000000ULL,
+                "SCHIP: Scroll left");
+
+  // Scroll down 1 row, the last row falls off
+  c8->opcode = 0x00C1;
+  execute_instruction(c8);
+  custom_assert(c8->buffer[124] == 0 && c8->buffer[125] == 0 &&
+                    c8->buffer[126] == 0xF &&
+                    c8->buffer[127] == 0xFFF0000000000000ULL,
+                "SCHIP: Scroll down");
+  custom_assert(display_hash(c8) == display_hash_full(c8),
+                "SCHIP: Display hash out of date");
+
+  // The high resolution display survives a save state
+  static uint8_t state[SAVESTATE_SIZE];
+  uint64_t hash = machine_hash_full(c8);
+  save_state(c8, state);
+  set_resolution(c8, false);
+  custom_assert(load_state(c8, state, sizeof(state)) == SUCCESS &&
+                    c8->hires && machine_hash(c8) == hash,
+                "SCHIP: Save state");
+
+  // LD HF, V2 with V2 = 3
+  c8->registers[2] = 3;
+  c8->opcode = 0xF230;
+  execute_instruction(c8);
+  custom_assert(c8->IRegister == LARGE_FONT_MEM + 30, "SCHIP: FX30");
+
+  // LD R, V3 and LD V3, R
+  for (int i = 0; i < 4; i++)
+    c8->registers[i] = i + 1;
+  c8->opcode = 0xF375;
+  execute_instruction(c8);
+  memset(c8->registers, 0, 4);
+  c8->opcode = 0xF385;
+  execute_instruction(c8);
+  custom_assert(c8->registers[0] == 1 && c8->registers[3] == 4 &&
+                    c8->rpl[4] == 0,
+                "SCHIP: FX75/FX85");
+
+  // LOW clears the display
+  c8->opcode = 0x00FE;
+  execute_instruction(c8);
+  custom_assert(!c8->hires && c8->buffer[127] == 0 &&
+                    display_hash(c8) == display_hash_full(c8),
+                "SCHIP: LOW");
+
+  c8->opcode = 0x00FD;
+  execute_instruction(c8);
+  custom_assert(!c8->running, "SCHIP: EXIT");
+
+  reset(c8);
+  custom_assert(c8->rpl[3] == 4, "SCHIP: RPL flags lost on reset");
+  memset(c8->rpl, 0, sizeof(c8->rpl));
+  set_quirks(c8, QUIRKS_DEFAULT);
+  custom_assert(c8->memory[LARGE_FONT_MEM] == 0,
+                "SCHIP: Large font left in memory");
+}
+
+void test_xochip(Chip8 *c8) {
+  // Other profiles keep 00DN a SYS jump and the XO-CHIP F opcodes unknown
+  const OpHandler *handlers = op_handlers[QUIRKS_DEFAULT];
+  custom_assert(decode_opcode(0x00D1) == OP_SCU_NIBBLE &&
+                    handlers[OP_SCU_NIBBLE] == handlers[OP_SYS_ADDR] &&
+                    handlers[OP_LD_I_LONG] == handlers[OP_UNKNOWN] &&
+                    handlers[OP_LD_I_VX_VY] == handlers[OP_SE_VX_VY],
+                "XO-CHIP: Opcodes decoded under other profiles");
+
+  // ROMs larger than 4 KB only fit in XO-CHIP memory
+  static uint8_t rom[MEMORY_SIZE];
+  custom_assert(load_rom_data(c8, rom, sizeof(rom)) == ERR,
+                "XO-CHIP: Large ROM loaded into 4 KB");
+  reset(c8);
+  rehash(c8);
+  custom_assert(set_quirks(c8, QUIRKS_XOCHIP) == SUCCESS &&
+                    c8->memory_size == XO_MEMORY_SIZE &&
+                    load_rom_data(c8, rom, sizeof(rom)) == SUCCESS,
+                "XO-CHIP: Large ROM not loaded");
+  custom_assert(memcmp(&c8->memory[LARGE_FONT_MEM], large_sprite_data,
+                       XO_LARGE_FONTSIZE) == 0 &&
+                    machine_hash(c8) == machine_hash_full(c8),
+                "XO-CHIP: Memory not set up");
+
+  // I = 0xE000, V0..V2 saved there and loaded back in reverse, then a skip
+  // over the 4 bytes of F000 NNNN
+  const uint16_t program[] = {0xF000, 0xE000, 0x6011, 0x6122, 0x6233, 0x5022,
+                              0x5203, 0x3033, 0xF000, 0x0000, 0xF301};
+  for (int mode = 0; mode <= (int)ENGINE_COUNT; mode++) {
+    custom_assert(set_cpu_mode(c8, mode ? ENGINES[mode - 1]
+                                        : CPU_INTERPRETER) == SUCCESS,
+                  "XO-CHIP: Failed to select engine");
+    load_program(c8, program, 11);
+    rehash(c8);
+    cycle_cpu(c8, 8);
+    custom_assert(c8->IRegister == 0xE000 && c8->memory[0xE000] == 0x11 &&
+                      c8->memory[0xE002] == 0x33,
+                  "XO-CHIP: F000 and 5XY2");
+    custom_assert(c8->registers[0] == 0x33 && c8->registers[2] == 0x11,
+                  "XO-CHIP: 5XY3");
+    custom_assert(c8->pc == 0x216 && c8->planes == 3,
+                  "XO-CHIP: Skip over F000 NNNN");
+    set_cpu_mode(c8, CPU_INTERPRETER);
+    reset(c8);
+  }
+
+  // FX55 at I = 0xFFFF wraps around and rewrites the translated code at 0
+  // (V3 = 1 -> V3 = 9), which must be thrown away like any other write
+  const uint16_t wrapping[] = {0x6301, 0xF000, 0xFFFF, 0x6163,
+                               0x6209, 0xF255, 0x1000};
+  uint8_t font[sizeof(wrapping)];
+  memcpy(font, c8->memory, sizeof(font));
+  for (size_t e = 0; e < ENGINE_COUNT; e++) {
+    custom_assert(set_cpu_mode(c8, ENGINES[e]) == SUCCESS,
+                  "XO-CHIP: Failed to select engine");
+    for (size_t i = 0; i < sizeof(wrapping) / 2; i++) {
+      write_memory(c8, i * 2, wrapping[i] >> 8);
+      write_memory(c8, i * 2 + 1, wrapping[i] & 0xFF);
+    }
+    memory_written(c8, 0, sizeof(wrapping));
+    c8->pc = 0;
+    cycle_cpu(c8, 7);
+    custom_assert(c8->memory[0xFFFF] == 0 && c8->memory[1] == 0x09 &&
+                      c8->registers[3] == 9 && c8->pc == 2,
+                  "XO-CHIP: Stale code run after a wrapping write");
+    set_cpu_mode(c8, CPU_INTERPRETER);
+    reset(c8);
+  }
+  for (size_t i = 0; i < sizeof(font); i++)
+    write_memory(c8, i, font[i]);
+  memory_written(c8, 0, sizeof(font));
+  custom_assert(machine_hash(c8) == machine_hash_full(c8),
+                "XO-CHIP: Hash wrong after a wrapping write");
+
+  // DRW V0, V1, 1 into both planes, one sprite after the other
+  take_dirty_rows(c8);
+  write_memory(c8, 0x310, 0xF0);
+  write_memory(c8, 0x311, 0x0F);
+  c8->planes = 3;
+  c8->registers[0] = c8->registers[1] = 0;
+  c8->IRegister = 0x310;
+  c8->opcode = 0xD011;
+  execute_instruction(c8);
+  custom_assert(c8->buffer[0] == 0xF000000000000000ULL &&
+                    c8->buffer[DISPLAY_WORDS] == 0x0F00000000000000ULL &&
+                    c8->registers[0xF] == 0,
+                "XO-CHIP: DRW into both planes");
+  custom_assert(take_dirty_rows(c8) == 1, "XO-CHIP: Dirty rows");
+
+  // Plane 2 alone draws the first sprite, and a collision there sets VF
+  c8->planes = 2;
+  execute_instruction(c8);
+  custom_assert(c8->buffer[0] == 0xF000000000000000ULL &&
+                    c8->buffer[DISPLAY_WORDS] == 0xFF00000000000000ULL &&
+                    c8->registers[0xF] == 0,
+                "XO-CHIP: DRW into plane 2");
+  execute_instruction(c8);
+  custom_assert(c8->buffer[DISPLAY_WORDS] == 0x0F00000000000000ULL &&
+                    c8->registers[0xF] == 1,
+                "XO-CHIP: DRW collision in plane 2");
+
+  // Draw one row lower, scroll plane 2 up by 1 row, then clear only it
+  c8->registers[1] = 1;
+  execute_instruction(c8);
+  c8->opcode = 0x00D1;
+  execute_instruction(c8);
+  custom_assert(c8->buffer[DISPLAY_WORDS] == 0xF000000000000000ULL &&
+                    c8->buffer[DISPLAY_WORDS + 1] == 0 &&
+                    c8->buffer[0] == 0xF000000000000000ULL,
+                "XO-CHIP: Scroll up");
+  c8->opcode = 0x00E0;
+  execute_instruction(c8);
+  custom_assert(c8->buffer[DISPLAY_WORDS] == 0 && c8->buffer[0] != 0 &&
+                    display_hash(c8) == display_hash_full(c8),
+                "XO-CHIP: CLS of plane 2");
+
+  // DRW V0, V1, 0 is 16x16 in low resolution too
+  c8->planes = 1;
+  c8->opcode = 0x00E0;
+  execute_instruction(c8);
+  for (int i = 0; i < 32; i++)
+    write_memory(c8, 0x320 + i, 0xFF);
+  c8->IRegister = 0x320;
+  c8->opcode = 0xD010;
+  execute_instruction(c8);
+  custom_assert(c8->buffer[1] == 0xFFFF000000000000ULL &&
+                    c8->buffer[16] == 0xFFFF000000000000ULL &&
+                    c8->buffer[17] == 0,
+                "XO-CHIP: 16x16 DRW in low resolution");
+
+  // Audio pattern, pitch and all 16 RPL flags
+  c8->IRegister = 0x320;
+  c8->opcode = 0xF002;
+  execute_instruction(c8);
+  c8->registers[5] = 0x70;
+  c8->opcode = 0xF53A;
+  execute_instruction(c8);
+  custom_assert(c8->audio_pattern[15] == 0xFF && c8->pitch == 0x70,
+                "XO-CHIP: Audio pattern and pitch");
+  c8->registers[0xF] = 0xAB;
+  c8->opcode = 0xFF75;
+  execute_instruction(c8);
+  custom_assert(c8->rpl[0xF] == 0xAB, "XO-CHIP: 16 RPL flags");
+
+  // The whole machine survives a save state, which other profiles refuse
+  static uint8_t state[SAVESTATE_MAX_SIZE];
+  uint64_t hash = machine_hash_full(c8);
+  custom_assert(save_state(c8, state) == SAVESTATE_MAX_SIZE &&
+                    save_state_size(c8) == SAVESTATE_MAX_SIZE,
+                "XO-CHIP: Save state size");
+  Chip8 *classic = initialize();
+  custom_assert(classic != NULL &&
+                    load_state(classic, state, sizeof(state)) == ERR,
+                "XO-CHIP: Save state loaded under another profile");
+  destroy(classic);
+  reset(c8);
+  custom_assert(load_state(c8, state, sizeof(state)) == SUCCESS &&
+                    machine_hash(c8) == hash && c8->pitch == 0x70 &&
+                    c8->memory[0xE002] == 0x33,
+                "XO-CHIP: Save state");
+
+  // Back to 4 KB, the second plane and the extra flags are dropped
+  memset(c8->rpl, 0, sizeof(c8->rpl));
+  c8->buffer[DISPLAY_WORDS] = 1;
+  set_quirks(c8, QUIRKS_DEFAULT);
+  custom_assert(c8->memory == c8->classic_memory &&
+                    c8->memory_size == MEMORY_SIZE &&
+                    c8->buffer[DISPLAY_WORDS] == 0 &&
+                    c8->memory[LARGE_FONT_MEM] == 0 &&
+                    machine_hash(c8) == machine_hash_full(c8),
+                "XO-CHIP: Switching back to 4 KB");
+  reset(c8);
 }
\ No newline at end of file